@@ -29,6 +29,7 @@
 
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 #include <libgen.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -58,14 +59,22 @@ global_config_t gconfig = {
     .http_addrs = NULL,
     .username = DEF_USERNAME,
     .chaos = NULL,
+    .minimal_zones = NULL,
+    .any_mode_zones = NULL,
+    .any_full_sources = NULL,
     .include_optional_ns = false,
     .realtime_stats = false,
     .lock_mem = false,
     .disable_text_autosplit = false,
     .edns_client_subnet = true,
+    .addr_fast_path = true,
+    .minimal_responses = false,
     .zones_strict_data = false,
+    .zones_name_index = true,
+    .zones_intern = false,
     .zones_strict_startup = true,
     .zones_rfc1035_auto = true,
+    .zones_rfc1035_fast_scan = false,
     .chaos_len = 0,
      // legal values are -20 to 20, so -21
      //  is really just an indicator that the user
@@ -85,9 +94,18 @@ global_config_t gconfig = {
     .max_response = 16384U,
     .max_cname_depth = 16U,
     .max_addtl_rrsets = 64U,
+    .num_minimal_zones = 0U,
+    .num_any_mode_zones = 0U,
+    .num_any_full_sources = 0U,
+    .any_mode = ANY_MODE_FULL,
+    .zones_hugepages = LTA_HUGEPAGES_NONE,
     .zones_rfc1035_auto_interval = 31U,
+    .zones_rfc1035_threads = 0U,
+    .zones_profile_slowest = 10U,
     .zones_rfc1035_quiesce = 5.0,
     .zones_rfc1035_min_quiesce = 0.0,
+    .zones_rfc1035_batch = 0.2,
+    .zones_rfc1035_batch_max = 2.0,
 };
 
 F_NONNULL
@@ -120,6 +138,202 @@ static bool bad_key(const char* key, unsigned klen V_UNUSED, const vscf_data_t*
     log_fatal("Invalid %s key '%s'", (const char*)data, key);
 }
 
+// Converts a zone name key from one of the per-zone option hashes
+//  to a newly-allocated dname
+F_NONNULL F_MALLOC
+static uint8_t* zone_opt_dname(const char* optname, const char* key, const unsigned klen) {
+    dmn_assert(optname); dmn_assert(key);
+
+    uint8_t dname[256];
+    const dname_status_t status = dname_from_string(dname, (const uint8_t*)key, klen);
+    if(status == DNAME_INVALID)
+        log_fatal("Config option %s: zone name '%s' is illegal", optname, key);
+    if(status == DNAME_PARTIAL)
+        dname_terminate(dname);
+
+    uint8_t* rv = malloc(dname[0] + 1U);
+    dname_copy(rv, dname);
+    return rv;
+}
+
+F_NONNULL
+static bool minimal_zone_iter(const char* key, unsigned klen, const vscf_data_t* d, void* data V_UNUSED) {
+    dmn_assert(key); dmn_assert(d);
+
+    bool minimal;
+    if(!vscf_is_simple(d) || !vscf_simple_get_as_bool(d, &minimal))
+        log_fatal("Config option minimal_responses_zones: Value for zone '%s' must be 'true' or 'false'", key);
+
+    zone_minimal_t* zm = &gconfig.minimal_zones[gconfig.num_minimal_zones++];
+    zm->dname = zone_opt_dname("minimal_responses_zones", key, klen);
+    zm->minimal_responses = minimal;
+
+    return true;
+}
+
+static void process_minimal_zones(const vscf_data_t* mz_opt) {
+    if(!vscf_is_hash(mz_opt))
+        log_fatal("Config option minimal_responses_zones: must be a hash of zone names to 'true' or 'false'");
+    const unsigned count = vscf_hash_get_len(mz_opt);
+    if(count) {
+        gconfig.minimal_zones = malloc(count * sizeof(zone_minimal_t));
+        vscf_hash_iterate(mz_opt, false, minimal_zone_iter, NULL);
+    }
+}
+
+bool conf_zone_minimal_responses(const uint8_t* zone_dname) {
+    dmn_assert(zone_dname);
+
+    for(unsigned i = 0; i < gconfig.num_minimal_zones; i++)
+        if(!dname_cmp(gconfig.minimal_zones[i].dname, zone_dname))
+            return gconfig.minimal_zones[i].minimal_responses;
+
+    return gconfig.minimal_responses;
+}
+
+F_NONNULL
+static any_mode_t any_mode_from_str(const char* optname, const char* str) {
+    dmn_assert(optname); dmn_assert(str);
+
+    any_mode_t rv = ANY_MODE_FULL;
+    if(!strcmp(str, "full"))
+        rv = ANY_MODE_FULL;
+    else if(!strcmp(str, "hinfo"))
+        rv = ANY_MODE_HINFO;
+    else if(!strcmp(str, "rrset"))
+        rv = ANY_MODE_RRSET;
+    else
+        log_fatal("Config option %s: '%s' is not one of 'full', 'hinfo', or 'rrset'", optname, str);
+
+    return rv;
+}
+
+F_NONNULL
+static lta_hugepages_t zones_hugepages_from_str(const char* str) {
+    dmn_assert(str);
+
+    lta_hugepages_t rv = LTA_HUGEPAGES_NONE;
+    if(!strcmp(str, "none"))
+        rv = LTA_HUGEPAGES_NONE;
+    else if(!strcmp(str, "thp"))
+        rv = LTA_HUGEPAGES_THP;
+    else if(!strcmp(str, "hugetlb"))
+        rv = LTA_HUGEPAGES_HUGETLB;
+    else
+        log_fatal("Config option zones_hugepages: '%s' is not one of 'none', 'thp', or 'hugetlb'", str);
+
+    return rv;
+}
+
+F_NONNULL
+static bool any_mode_zone_iter(const char* key, unsigned klen, const vscf_data_t* d, void* data V_UNUSED) {
+    dmn_assert(key); dmn_assert(d);
+
+    if(!vscf_is_simple(d))
+        log_fatal("Config option any_mode_zones: Value for zone '%s' must be a string", key);
+
+    zone_any_mode_t* za = &gconfig.any_mode_zones[gconfig.num_any_mode_zones++];
+    za->dname = zone_opt_dname("any_mode_zones", key, klen);
+    za->any_mode = any_mode_from_str("any_mode_zones", vscf_simple_get_data(d));
+
+    return true;
+}
+
+static void process_any_mode_zones(const vscf_data_t* az_opt) {
+    if(!vscf_is_hash(az_opt))
+        log_fatal("Config option any_mode_zones: must be a hash of zone names to 'full', 'hinfo', or 'rrset'");
+    const unsigned count = vscf_hash_get_len(az_opt);
+    if(count) {
+        gconfig.any_mode_zones = malloc(count * sizeof(zone_any_mode_t));
+        vscf_hash_iterate(az_opt, false, any_mode_zone_iter, NULL);
+    }
+}
+
+any_mode_t conf_zone_any_mode(const uint8_t* zone_dname) {
+    dmn_assert(zone_dname);
+
+    for(unsigned i = 0; i < gconfig.num_any_mode_zones; i++)
+        if(!dname_cmp(gconfig.any_mode_zones[i].dname, zone_dname))
+            return gconfig.any_mode_zones[i].any_mode;
+
+    return gconfig.any_mode;
+}
+
+// Parses "addr/bits" into a source netmask for any_full_sources
+F_NONNULL
+static void make_any_source(const char* spec, any_source_t* out) {
+    dmn_assert(spec); dmn_assert(out);
+
+    const char* slash = strchr(spec, '/');
+    const unsigned addr_len = slash ? (unsigned)(slash - spec) : strlen(spec);
+    char addr_txt[addr_len + 1];
+    memcpy(addr_txt, spec, addr_len);
+    addr_txt[addr_len] = '\0';
+
+    dmn_anysin_t asin;
+    const int addr_err = dmn_anysin_getaddrinfo(addr_txt, NULL, &asin, true);
+    if(addr_err)
+        log_fatal("Config option any_full_sources: Could not parse address in '%s': %s", spec, gai_strerror(addr_err));
+
+    const bool is_v6 = (asin.sa.sa_family == AF_INET6);
+    const unsigned max_bits = is_v6 ? 128U : 32U;
+    unsigned long bits = max_bits;
+    if(slash) {
+        char* endptr;
+        errno = 0;
+        bits = strtoul(slash + 1, &endptr, 10);
+        if(errno || !slash[1] || *endptr || bits > max_bits)
+            log_fatal("Config option any_full_sources: Invalid mask length in '%s'", spec);
+    }
+
+    memset(out->addr, 0, 16);
+    if(is_v6)
+        memcpy(out->addr, asin.sin6.sin6_addr.s6_addr, 16);
+    else
+        memcpy(out->addr, &asin.sin.sin_addr.s_addr, 4);
+    out->is_v6 = is_v6;
+    out->bits = bits;
+}
+
+static void process_any_full_sources(const vscf_data_t* afs_opt) {
+    const unsigned count = vscf_array_get_len(afs_opt);
+    gconfig.any_full_sources = malloc(count * sizeof(any_source_t));
+    gconfig.num_any_full_sources = count;
+    for(unsigned i = 0; i < count; i++) {
+        const vscf_data_t* spec = vscf_array_get_data(afs_opt, i);
+        if(!vscf_is_simple(spec))
+            log_fatal("Config option any_full_sources: must be an array of 'address/mask' strings");
+        make_any_source(vscf_simple_get_data(spec), &gconfig.any_full_sources[i]);
+    }
+}
+
+bool conf_any_full_source(const dmn_anysin_t* asin) {
+    dmn_assert(asin);
+
+    const bool is_v6 = (asin->sa.sa_family == AF_INET6);
+    const uint8_t* addr = is_v6
+        ? asin->sin6.sin6_addr.s6_addr
+        : (const uint8_t*)&asin->sin.sin_addr.s_addr;
+
+    for(unsigned i = 0; i < gconfig.num_any_full_sources; i++) {
+        const any_source_t* src = &gconfig.any_full_sources[i];
+        if(src->is_v6 != is_v6)
+            continue;
+        const unsigned full_bytes = src->bits >> 3;
+        const unsigned rem_bits = src->bits & 7;
+        if(memcmp(addr, src->addr, full_bytes))
+            continue;
+        if(rem_bits) {
+            const uint8_t mask = (uint8_t)(0xFF << (8 - rem_bits));
+            if((addr[full_bytes] & mask) != (src->addr[full_bytes] & mask))
+                continue;
+        }
+        return true;
+    }
+
+    return false;
+}
+
 static void make_addr(const char* lspec_txt, const unsigned def_port, dmn_anysin_t* result) {
     dmn_assert(result);
     const int addr_err = gdnsd_anysin_fromstr(lspec_txt, def_port, result);
@@ -540,6 +754,8 @@ void conf_load(const char* cfg_dir, const bool force_zss, const bool force_zsd,
         CFG_OPT_BOOL(options, lock_mem);
         CFG_OPT_BOOL(options, disable_text_autosplit);
         CFG_OPT_BOOL(options, edns_client_subnet);
+        CFG_OPT_BOOL(options, addr_fast_path);
+        CFG_OPT_BOOL(options, minimal_responses);
         CFG_OPT_UINT(options, log_stats, 1LU, 2147483647LU);
         CFG_OPT_UINT(options, max_http_clients, 1LU, 65535LU);
         CFG_OPT_UINT(options, http_timeout, 3LU, 60LU);
@@ -581,19 +797,43 @@ void conf_load(const char* cfg_dir, const bool force_zss, const bool force_zsd,
         CFG_OPT_UINT(options, max_cname_depth, 4LU, 24LU);
         CFG_OPT_UINT(options, max_addtl_rrsets, 16LU, 256LU);
         CFG_OPT_BOOL(options, zones_strict_data);
+        CFG_OPT_BOOL(options, zones_name_index);
+        CFG_OPT_BOOL(options, zones_intern);
         CFG_OPT_BOOL(options, zones_strict_startup);
         CFG_OPT_BOOL(options, zones_rfc1035_auto);
+        CFG_OPT_BOOL(options, zones_rfc1035_fast_scan);
 
         // it's important that auto_interval is never lower than 2s, or it could cause
         //   us to miss fast events on filesystems with 1-second mtime resolution.
         CFG_OPT_UINT(options, zones_rfc1035_auto_interval, 10LU, 600LU);
         CFG_OPT_DBL(options, zones_rfc1035_min_quiesce, 0.0, 5.0);
         CFG_OPT_DBL(options, zones_rfc1035_quiesce, 0.0, 60.0);
+        CFG_OPT_DBL(options, zones_rfc1035_batch, 0.0, 10.0);
+        CFG_OPT_DBL(options, zones_rfc1035_batch_max, 0.0, 60.0);
+        CFG_OPT_UINT(options, zones_rfc1035_threads, 0LU, 1024LU);
+        CFG_OPT_UINT(options, zones_profile_slowest, 0LU, 100LU);
         CFG_OPT_STR(options, username);
         CFG_OPT_STR_NOCOPY(options, chaos_response, chaos_data);
         listen_opt = vscf_hash_get_data_byconstkey(options, "listen", true);
         http_listen_opt = vscf_hash_get_data_byconstkey(options, "http_listen", true);
         psearch_array = vscf_hash_get_data_byconstkey(options, "plugin_search_path", true);
+        const vscf_data_t* mz_opt = vscf_hash_get_data_byconstkey(options, "minimal_responses_zones", true);
+        if(mz_opt)
+            process_minimal_zones(mz_opt);
+        const char* any_mode_str = NULL;
+        CFG_OPT_STR_NOCOPY(options, any_mode, any_mode_str);
+        if(any_mode_str)
+            gconfig.any_mode = any_mode_from_str("any_mode", any_mode_str);
+        const char* zones_hugepages_str = NULL;
+        CFG_OPT_STR_NOCOPY(options, zones_hugepages, zones_hugepages_str);
+        if(zones_hugepages_str)
+            gconfig.zones_hugepages = zones_hugepages_from_str(zones_hugepages_str);
+        const vscf_data_t* az_opt = vscf_hash_get_data_byconstkey(options, "any_mode_zones", true);
+        if(az_opt)
+            process_any_mode_zones(az_opt);
+        const vscf_data_t* afs_opt = vscf_hash_get_data_byconstkey(options, "any_full_sources", true);
+        if(afs_opt)
+            process_any_full_sources(afs_opt);
         vscf_hash_iterate(options, true, bad_key, (void*)"options");
     }
 
@@ -603,6 +843,12 @@ void conf_load(const char* cfg_dir, const bool force_zss, const bool force_zsd,
     if(force_zsd)
         gconfig.zones_strict_data = true;
 
+    // zero means one zonefile parsing thread per online CPU
+    if(!gconfig.zones_rfc1035_threads) {
+        const long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        gconfig.zones_rfc1035_threads = (ncpus > 0 && ncpus <= 1024) ? (unsigned)ncpus : 1U;
+    }
+
     // set response string for CHAOS queries
     set_chaos(chaos_data);
 
@@ -48,21 +48,50 @@ typedef struct {
     bool bind_success;
 } dns_thread_t;
 
+// per-zone override of gconfig.minimal_responses
+typedef struct {
+    uint8_t* dname;
+    bool minimal_responses;
+} zone_minimal_t;
+
+// per-zone override of gconfig.any_mode
+typedef struct {
+    uint8_t* dname;
+    any_mode_t any_mode;
+} zone_any_mode_t;
+
+// network from any_full_sources
+typedef struct {
+    uint8_t addr[16];
+    unsigned bits;
+    bool is_v6;
+} any_source_t;
+
 typedef struct {
     dns_addr_t*    dns_addrs;
     dns_thread_t*  dns_threads;
     dmn_anysin_t*  http_addrs;
     const char*    username;
     const uint8_t* chaos;
+    zone_minimal_t* minimal_zones;
+    zone_any_mode_t* any_mode_zones;
+    any_source_t* any_full_sources;
     bool     include_optional_ns;
     bool     realtime_stats;
     bool     lock_mem;
     bool     disable_text_autosplit;
     bool     edns_client_subnet;
+    bool     addr_fast_path;
+    bool     minimal_responses;
     bool     zones_strict_data;
+    bool     zones_name_index;
+    bool     zones_intern;
     bool     zones_strict_startup;
     bool     zones_rfc1035_auto;
+    bool     zones_rfc1035_fast_scan;
     int      priority;
+    any_mode_t any_mode;
+    lta_hugepages_t zones_hugepages;
     unsigned chaos_len;
     unsigned zones_default_ttl;
     unsigned max_ncache_ttl;
@@ -77,9 +106,16 @@ typedef struct {
     unsigned max_response;
     unsigned max_cname_depth;
     unsigned max_addtl_rrsets;
+    unsigned num_minimal_zones;
+    unsigned num_any_mode_zones;
+    unsigned num_any_full_sources;
     unsigned zones_rfc1035_auto_interval;
+    unsigned zones_rfc1035_threads;
+    unsigned zones_profile_slowest;
     double zones_rfc1035_min_quiesce;
     double zones_rfc1035_quiesce;
+    double zones_rfc1035_batch;
+    double zones_rfc1035_batch_max;
 } global_config_t;
 
 extern global_config_t gconfig;
@@ -94,4 +130,17 @@ void conf_load(const char* cfg_file, const bool force_zss, const bool force_zsd,
 
 void dns_lsock_init(void);
 
+// Whether the zone with the given name should use minimal responses,
+//  from the per-zone minimal_responses_zones or the global default.
+F_NONNULL F_PURE
+bool conf_zone_minimal_responses(const uint8_t* zone_dname);
+
+// As above, for the qtype=ANY answer mode
+F_NONNULL F_PURE
+any_mode_t conf_zone_any_mode(const uint8_t* zone_dname);
+
+// Whether a query source is in any_full_sources
+F_NONNULL F_PURE
+bool conf_any_full_source(const dmn_anysin_t* asin);
+
 #endif // GDNSD_CONF_H
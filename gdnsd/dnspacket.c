@@ -84,8 +84,16 @@ dnspacket_context_t* dnspacket_context_new(const unsigned int this_threadnum, co
     retval->is_udp = is_udp;
     retval->threadnum = this_threadnum;
     retval->addtl_rrsets = malloc(gconfig.max_addtl_rrsets * sizeof(addtl_rrset_t));
+    unsigned set_size = 1;
+    while(set_size < (gconfig.max_addtl_rrsets << 1))
+        set_size <<= 1;
+    retval->addtl_set = calloc(set_size, sizeof(addtl_slot_t));
+    retval->addtl_set_mask = set_size - 1;
     retval->comptargets = malloc(COMPTARGETS_MAX * sizeof(comptarget_t));
-    retval->dync_store = malloc(gconfig.max_cname_depth * 256);
+    retval->dync_cname = malloc(sizeof(ltree_frrset_cname_t) + (gconfig.max_cname_depth * 256));
+    retval->dync_store = (uint8_t*)&retval->dync_cname[1];
+    retval->dync_addr = malloc(sizeof(ltree_frrset_addr_t) + gdnsd_result_get_alloc());
+    retval->tmpl_store = malloc((COMPTARGETS_MAX + 3) * 256);
     retval->addtl_store = malloc(gconfig.max_response);
     retval->dyn = malloc(gdnsd_result_get_alloc());
 
@@ -99,6 +107,13 @@ static void reset_context(dnspacket_context_t* c) {
         &c->answer_addr_rrset, 0,
         sizeof(dnspacket_context_t) - offsetof(dnspacket_context_t, answer_addr_rrset)
     );
+
+    // Invalidate all addtl_set entries from the previous request.  Only
+    //  on wraparound does the table need an actual clear.
+    if(unlikely(!++c->addtl_gen)) {
+        memset(c->addtl_set, 0, (c->addtl_set_mask + 1) * sizeof(addtl_slot_t));
+        c->addtl_gen = 1;
+    }
 }
 
 // "buf" points to the question section of an input packet.
@@ -412,11 +427,95 @@ static rcode_rv_t decode_query(dnspacket_context_t* c, uint8_t* lqname, unsigned
     return rcode;
 }
 
+// Fast-path variant of decode_query() for the dominant query shape: a single
+//  IN-class A or AAAA question, optionally followed by a bare EDNS0 OPT RR
+//  with no options.  Anything else (including every error case) returns false,
+//  and the caller must then fall back to decode_query() from scratch.
+F_NONNULL
+static bool decode_query_fast(dnspacket_context_t* c, uint8_t* lqname, unsigned* question_len_ptr, const unsigned int packet_len) {
+    dmn_assert(c); dmn_assert(c->packet); dmn_assert(lqname); dmn_assert(question_len_ptr);
+
+    uint8_t* packet = c->packet;
+    const wire_dns_header_t* hdr = (const wire_dns_header_t*)packet;
+
+    // QR, TC, and OPCODE must all be zero, and only QD/AR counts allowed
+    if(unlikely(packet_len < (sizeof(wire_dns_header_t) + 5)
+        || (hdr->flags1 & 0xFA)
+        || DNSH_GET_QDCOUNT(hdr) != 1
+        || hdr->ancount || hdr->nscount
+        || DNSH_GET_ARCOUNT(hdr) > 1))
+        return false;
+
+    unsigned offset = sizeof(wire_dns_header_t);
+    const unsigned question_len = parse_question(c, lqname, &packet[offset], packet_len - offset);
+    if(unlikely(!question_len))
+        return false;
+    if(c->qtype != DNS_TYPE_A && c->qtype != DNS_TYPE_AAAA)
+        return false;
+    offset += question_len;
+    if(ntohs(gdnsd_get_una16(&packet[offset - 2])) != 1U) // class IN
+        return false;
+
+    if(DNSH_GET_ARCOUNT(hdr)) {
+        const wire_dns_rr_opt_t* opt = (const wire_dns_rr_opt_t*)&packet[offset + 1];
+        if(unlikely(packet_len < (offset + sizeof_optrr + 1)
+            || packet[offset] != '\0'
+            || DNS_OPTRR_GET_TYPE(opt) != DNS_TYPE_OPT
+            || DNS_OPTRR_GET_VERSION(opt) != 0
+            || gdnsd_get_una16(&opt->rdlen)))
+            return false;
+        c->use_edns = true;
+        stats_own_inc(&c->stats->edns);
+        if(likely(c->is_udp))
+            c->this_max_response = min_unsigned(max_unsigned(DNS_OPTRR_GET_MAXSIZE(opt), 512U), gconfig.max_response) - 11;
+        else
+            c->this_max_response = gconfig.max_response - 11;
+    }
+    else if(likely(c->is_udp)) {
+        c->this_max_response = 512;
+    }
+    else {
+        c->this_max_response = gconfig.max_response;
+    }
+
+    *question_len_ptr = question_len;
+    return true;
+}
+
+// tmpl_store slots beyond those for comptargets: the qname of an
+//  in-zone CNAME chase, and the origin passed to a DYNC plugin
+#define TMPL_SLOT_QNAME (COMPTARGETS_MAX + 1)
+#define TMPL_SLOT_ORIGIN (COMPTARGETS_MAX + 2)
+
+// For zones attached to a template, rewrites a dname under the template
+//  placeholder origin into the query zone, using the given slot of
+//  c->tmpl_store (which must outlive any comptarget referencing it).
+//  Any other dname is returned as-is.
+F_NONNULL
+static const uint8_t* tmpl_dname(dnspacket_context_t* c, const uint8_t* dn, const unsigned slot) {
+    dmn_assert(c); dmn_assert(dn);
+    dmn_assert(slot <= TMPL_SLOT_ORIGIN);
+
+    if(likely(!c->tmpl_dname) || !dname_isinzone(ZONE_TMPL_ORIGIN, dn))
+        return dn;
+
+    // zone_new_attached() guarantees the result fits
+    const unsigned plen = *dn - *ZONE_TMPL_ORIGIN;
+    uint8_t* out = &c->tmpl_store[slot * 256];
+    dmn_assert(plen + *c->tmpl_dname < 256);
+    out[0] = plen + *c->tmpl_dname;
+    memcpy(&out[1], &dn[1], plen);
+    memcpy(&out[1 + plen], &c->tmpl_dname[1], *c->tmpl_dname);
+    return out;
+}
+
 // is_addtl refers to where we're storing to
 F_NONNULL
 static unsigned int store_dname_nocomp(dnspacket_context_t* c, const unsigned int pkt_dname_offset, const uint8_t* dn) {
     dmn_assert(c); dmn_assert(pkt_dname_offset); dmn_assert(dn);
 
+    dn = tmpl_dname(c, dn, c->comptarget_count);
+
     if(*dn != 1 && likely(pkt_dname_offset < 16384) && likely(c->comptarget_count < COMPTARGETS_MAX)) {
         comptarget_t* new_ctarg = &(c->comptargets[c->comptarget_count++]);
         new_ctarg->original = dn;
@@ -437,6 +536,8 @@ static unsigned int store_dname(dnspacket_context_t* c, const unsigned int pkt_d
 
     uint8_t* packet = is_addtl ? c->addtl_store : c->packet;
 
+    dn = tmpl_dname(c, dn, c->comptarget_count);
+
     // Deal with the root case, which should never be compressed, or compressed against
     if(*dn == 1) {
        dmn_assert(dn[1] == '\0');
@@ -594,7 +695,7 @@ static unsigned int repeat_name(dnspacket_context_t* c, unsigned int store_at_of
     }
 
 F_NONNULL
-static unsigned int enc_a_static(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_addr_t* rrset, const unsigned int nameptr, const bool is_addtl) {
+static unsigned int enc_a_static(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_addr_t* rrset, const unsigned int nameptr, const bool is_addtl) {
     dmn_assert(c); dmn_assert(rrset);
     dmn_assert(rrset->gen.count);
 
@@ -605,9 +706,6 @@ static unsigned int enc_a_static(dnspacket_context_t* c, unsigned int offset, co
     else
         c->ancount += rrset->limit_v4;
 
-    const uint32_t* addr_ptr = (!rrset->count_v6 && rrset->gen.count <= LTREE_V4A_SIZE)
-        ? &rrset->v4a[0]
-        : rrset->addrs.v4;
     OFFSET_LOOP_START(rrset->gen.count, rrset->limit_v4)
         offset += repeat_name(c, offset, nameptr, is_addtl);
         gdnsd_put_una32(DNS_RRFIXED_A, &packet[offset]);
@@ -616,14 +714,14 @@ static unsigned int enc_a_static(dnspacket_context_t* c, unsigned int offset, co
         offset += 4;
         gdnsd_put_una16(htons(4), &packet[offset]);
         offset += 2;
-        gdnsd_put_una32(addr_ptr[i], &packet[offset]);
+        gdnsd_put_una32(rrset->addrs[i], &packet[offset]);
         offset += 4;
     OFFSET_LOOP_END
     return offset;
 }
 
 F_NONNULL
-static unsigned int enc_aaaa_static(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_addr_t* rrset, const unsigned int nameptr, const bool is_addtl) {
+static unsigned int enc_aaaa_static(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_addr_t* rrset, const unsigned int nameptr, const bool is_addtl) {
     dmn_assert(c); dmn_assert(rrset);
     dmn_assert(rrset->count_v6);
 
@@ -634,6 +732,7 @@ static unsigned int enc_aaaa_static(dnspacket_context_t* c, unsigned int offset,
     else
         c->ancount += rrset->limit_v6;
 
+    const uint8_t* v6 = (const uint8_t*)&rrset->addrs[rrset->gen.count];
     OFFSET_LOOP_START(rrset->count_v6, rrset->limit_v6)
         offset += repeat_name(c, offset, nameptr, is_addtl);
         gdnsd_put_una32(DNS_RRFIXED_AAAA, &packet[offset]);
@@ -642,14 +741,14 @@ static unsigned int enc_aaaa_static(dnspacket_context_t* c, unsigned int offset,
         offset += 4;
         gdnsd_put_una16(htons(16), &packet[offset]);
         offset += 2;
-        memcpy(&packet[offset], rrset->addrs.v6 + (i << 4), 16);
+        memcpy(&packet[offset], v6 + (i << 4), 16);
         offset += 16;
     OFFSET_LOOP_END
     return offset;
 }
 
 F_NONNULL
-static unsigned int enc_a_dynamic(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_addr_t* rrset, const unsigned int nameptr, const bool is_addtl, const unsigned ttl) {
+static unsigned int enc_a_dynamic(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_addr_t* rrset, const unsigned int nameptr, const bool is_addtl, const unsigned ttl) {
     dmn_assert(c); dmn_assert(c->packet);
 
     uint8_t* packet = is_addtl ? c->addtl_store : c->packet;
@@ -681,7 +780,7 @@ static unsigned int enc_a_dynamic(dnspacket_context_t* c, unsigned int offset, c
 }
 
 F_NONNULL
-static unsigned int enc_aaaa_dynamic(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_addr_t* rrset, const unsigned int nameptr, const bool is_addtl, const unsigned ttl) {
+static unsigned int enc_aaaa_dynamic(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_addr_t* rrset, const unsigned int nameptr, const bool is_addtl, const unsigned ttl) {
     dmn_assert(c); dmn_assert(c->packet);
 
     uint8_t* packet = is_addtl ? c->addtl_store : c->packet;
@@ -737,7 +836,7 @@ static unsigned do_dyn_callback(dnspacket_context_t* c, gdnsd_resolve_cb_t func,
 }
 
 F_NONNULL
-static unsigned int encode_rrs_anyaddr(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_addr_t* rrset, const unsigned int nameptr, const bool is_addtl) {
+static unsigned int encode_rrs_anyaddr(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_addr_t* rrset, const unsigned int nameptr, const bool is_addtl) {
     dmn_assert(c); dmn_assert(rrset);
 
     // This is to prevent duplicating the answer AAAA+A
@@ -763,38 +862,53 @@ static unsigned int encode_rrs_anyaddr(dnspacket_context_t* c, unsigned int offs
     return offset;
 }
 
+// Returns the addtl_set slot which either already holds rrset for
+//  this request, or is the empty slot where it should be inserted.
+F_NONNULL F_PURE
+static addtl_slot_t* addtl_set_slot(const dnspacket_context_t* c, const ltree_frrset_addr_t* rrset) {
+    dmn_assert(c); dmn_assert(rrset);
+
+    const unsigned mask = c->addtl_set_mask;
+    unsigned slotnum = ((unsigned)((uintptr_t)rrset >> 4) * 2654435761U) & mask;
+    unsigned jmpby = 1;
+    addtl_slot_t* slot = &c->addtl_set[slotnum];
+    while(slot->gen == c->addtl_gen && slot->rrset != rrset) {
+        slotnum = (slotnum + jmpby++) & mask;
+        slot = &c->addtl_set[slotnum];
+    }
+
+    return slot;
+}
+
 // retval indicates whether to actually add it or not
 F_NONNULL
-static bool add_addtl_rrset_check(const dnspacket_context_t* c, const ltree_rrset_addr_t* rrset) {
+static bool add_addtl_rrset_check(const dnspacket_context_t* c, const ltree_frrset_addr_t* rrset) {
     dmn_assert(c); dmn_assert(rrset);
 
-    bool rv = true;
-
     // gconfig.max_addtl_rrsets unique addtl rrsets
-    if(unlikely(c->addtl_count == gconfig.max_addtl_rrsets)) {
-        rv = false;
-    }
-    else {
-        for(unsigned int i = 0; i < c->addtl_count; i++) {
-            if(unlikely(c->addtl_rrsets[i].rrset == rrset)) {
-                rv = false;
-                break;
-            }
-        }
-    }
+    if(unlikely(c->addtl_count == gconfig.max_addtl_rrsets))
+        return false;
 
-    return rv;
+    return addtl_set_slot(c, rrset)->gen != c->addtl_gen;
 }
 
 F_NONNULL
-static void track_addtl_rrset_unwind(dnspacket_context_t* c, const ltree_rrset_addr_t* rrset) {
+static void track_addtl_rrset_unwind(dnspacket_context_t* c, const ltree_frrset_addr_t* rrset) {
     dmn_assert(c); dmn_assert(rrset);
 
     // arcount and addtl_offset should be zero when first additional is added...
     dmn_assert(c->addtl_count || !c->addtl_offset);
     dmn_assert(c->addtl_count || !c->arcount);
+    dmn_assert(c->addtl_count < gconfig.max_addtl_rrsets);
 
-    // store info for unwinding if we run out of space for additionals
+    // mark it present for add_addtl_rrset_check()
+    addtl_slot_t* slot = addtl_set_slot(c, rrset);
+    slot->rrset = rrset;
+    slot->gen = c->addtl_gen;
+
+    // store info for unwinding if we run out of space for additionals.
+    //  Unwinding only happens after the response is complete, so the
+    //  set itself never needs to be unwound.
     addtl_rrset_t* arrset = &c->addtl_rrsets[c->addtl_count++];
     arrset->rrset = rrset;
     arrset->prev_offset = c->addtl_offset;
@@ -802,7 +916,7 @@ static void track_addtl_rrset_unwind(dnspacket_context_t* c, const ltree_rrset_a
 }
 
 F_NONNULL
-static void add_addtl_rrset(dnspacket_context_t* c, const ltree_rrset_addr_t* rrset, const unsigned int nameptr) {
+static void add_addtl_rrset(dnspacket_context_t* c, const ltree_frrset_addr_t* rrset, const unsigned int nameptr) {
     dmn_assert(c); dmn_assert(rrset);
 
     if(rrset != c->answer_addr_rrset && add_addtl_rrset_check(c, rrset)) {
@@ -816,7 +930,7 @@ static void add_addtl_rrset(dnspacket_context_t* c, const ltree_rrset_addr_t* rr
 //  are asserted to only be called for direct A/AAAA queries, so
 //  it's impossible for the check to fail.
 F_NONNULL
-static unsigned int encode_rrs_a(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_addr_t* rrset, const bool answer V_UNUSED) {
+static unsigned int encode_rrs_a(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_addr_t* rrset, const bool answer V_UNUSED) {
     dmn_assert(c); dmn_assert(offset); dmn_assert(rrset);
     dmn_assert(c->qtype == DNS_TYPE_A);
 
@@ -827,7 +941,7 @@ static unsigned int encode_rrs_a(dnspacket_context_t* c, unsigned int offset, co
     if(rrset->gen.count | rrset->count_v6) {
         if(rrset->gen.count)
             offset = enc_a_static(c, offset, rrset, c->qname_comp, false);
-        if(rrset->count_v6) {
+        if(rrset->count_v6 && !c->minimal) {
             track_addtl_rrset_unwind(c, rrset);
             c->addtl_offset = enc_aaaa_static(c, c->addtl_offset, rrset, c->qname_comp, true);
         }
@@ -837,7 +951,7 @@ static unsigned int encode_rrs_a(dnspacket_context_t* c, unsigned int offset, co
         dmn_assert(!c->dyn->is_cname);
         if(c->dyn->count_v4)
             offset = enc_a_dynamic(c, offset, rrset, c->qname_comp, false, ttl);
-        if(c->dyn->count_v6) {
+        if(c->dyn->count_v6 && !c->minimal) {
             track_addtl_rrset_unwind(c, rrset);
             c->addtl_offset = enc_aaaa_dynamic(c, c->addtl_offset, rrset, c->qname_comp, true, ttl);
         }
@@ -847,7 +961,7 @@ static unsigned int encode_rrs_a(dnspacket_context_t* c, unsigned int offset, co
 }
 
 F_NONNULL
-static unsigned int encode_rrs_aaaa(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_addr_t* rrset, const bool answer V_UNUSED) {
+static unsigned int encode_rrs_aaaa(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_addr_t* rrset, const bool answer V_UNUSED) {
     dmn_assert(c); dmn_assert(offset); dmn_assert(rrset);
     dmn_assert(c->qtype == DNS_TYPE_AAAA);
 
@@ -858,7 +972,7 @@ static unsigned int encode_rrs_aaaa(dnspacket_context_t* c, unsigned int offset,
     if(rrset->gen.count | rrset->count_v6) {
         if(rrset->count_v6)
             offset = enc_aaaa_static(c, offset, rrset, c->qname_comp, false);
-        if(rrset->gen.count) {
+        if(rrset->gen.count && !c->minimal) {
             track_addtl_rrset_unwind(c, rrset);
             c->addtl_offset = enc_a_static(c, c->addtl_offset, rrset, c->qname_comp, true);
         }
@@ -868,7 +982,7 @@ static unsigned int encode_rrs_aaaa(dnspacket_context_t* c, unsigned int offset,
         dmn_assert(!c->dyn->is_cname);
         if(c->dyn->count_v6)
             offset = enc_aaaa_dynamic(c, offset, rrset, c->qname_comp, false, ttl);
-        if(c->dyn->count_v4) {
+        if(c->dyn->count_v4 && !c->minimal) {
             track_addtl_rrset_unwind(c, rrset);
             c->addtl_offset = enc_a_dynamic(c, c->addtl_offset, rrset, c->qname_comp, true, ttl);
         }
@@ -878,11 +992,12 @@ static unsigned int encode_rrs_aaaa(dnspacket_context_t* c, unsigned int offset,
 }
 
 F_NONNULL
-static unsigned int encode_rrs_ns(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_ns_t* rrset, const bool answer) {
+static unsigned int encode_rrs_ns(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_ns_t* rrset, const bool answer) {
     dmn_assert(c); dmn_assert(c->packet); dmn_assert(offset); dmn_assert(rrset);
     dmn_assert(rrset->gen.count); // we never call encode_rrs_ns without an NS record present
 
     uint8_t* packet = c->packet;
+    const ltree_frdata_ns_t* rdata = ltree_fbody(&rrset->body);
 
     OFFSET_LOOP_START(rrset->gen.count, rrset->gen.count)
         offset += repeat_name(c, offset, c->auth_comp, false);
@@ -890,15 +1005,15 @@ static unsigned int encode_rrs_ns(dnspacket_context_t* c, unsigned int offset, c
         offset += 4;
         gdnsd_put_una32(rrset->gen.ttl, &packet[offset]);
         offset += 6;
-        const unsigned int newlen = store_dname(c, offset, rrset->rdata[i].dname, false);
+        const unsigned int newlen = store_dname(c, offset, ltree_dref(&rdata[i].dname), false);
         gdnsd_put_una16(htons(newlen), &packet[offset - 2]);
-        if(rrset->rdata[i].ad) {
-            if(AD_IS_GLUE(rrset->rdata[i].ad)) {
+        if(rdata[i].ad) {
+            if(LTREE_AD_IS_GLUE(rdata[i].ad)) {
                 c->addtl_has_glue = true;
-                add_addtl_rrset(c, AD_GET_PTR(rrset->rdata[i].ad), offset);
+                add_addtl_rrset(c, ltree_ad(&rdata[i].ad), offset);
             }
-            else {
-                add_addtl_rrset(c, rrset->rdata[i].ad, offset);
+            else if(!c->minimal) {
+                add_addtl_rrset(c, ltree_ad(&rdata[i].ad), offset);
             }
         }
         offset += newlen;
@@ -913,10 +1028,11 @@ static unsigned int encode_rrs_ns(dnspacket_context_t* c, unsigned int offset, c
 }
 
 F_NONNULL
-static unsigned int encode_rrs_ptr(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_ptr_t* rrset, const bool answer V_UNUSED) {
+static unsigned int encode_rrs_ptr(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_ptr_t* rrset, const bool answer V_UNUSED) {
     dmn_assert(c); dmn_assert(c->packet); dmn_assert(offset); dmn_assert(rrset);
 
     uint8_t* packet = c->packet;
+    const ltree_frdata_ptr_t* rdata = ltree_fbody(&rrset->body);
 
     const unsigned rrct = rrset->gen.count;
     c->ancount += rrct;
@@ -926,7 +1042,7 @@ static unsigned int encode_rrs_ptr(dnspacket_context_t* c, unsigned int offset,
         offset += 4;
         gdnsd_put_una32(rrset->gen.ttl, &packet[offset]);
         offset += 6;
-        const unsigned int newlen = store_dname(c, offset, rrset->rdata[i].dname, false);
+        const unsigned int newlen = store_dname(c, offset, ltree_dref(&rdata[i].dname), false);
         gdnsd_put_una16(htons(newlen), &packet[offset - 2]);
         offset += newlen;
     }
@@ -935,10 +1051,11 @@ static unsigned int encode_rrs_ptr(dnspacket_context_t* c, unsigned int offset,
 }
 
 F_NONNULL
-static unsigned int encode_rrs_mx(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_mx_t* rrset, const bool answer V_UNUSED) {
+static unsigned int encode_rrs_mx(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_mx_t* rrset, const bool answer V_UNUSED) {
     dmn_assert(c); dmn_assert(c->packet); dmn_assert(offset); dmn_assert(rrset);
 
     uint8_t* packet = c->packet;
+    const ltree_frdata_mx_t* rdata = ltree_fbody(&rrset->body);
 
     const unsigned rrct = rrset->gen.count;
     c->ancount += rrct;
@@ -948,13 +1065,13 @@ static unsigned int encode_rrs_mx(dnspacket_context_t* c, unsigned int offset, c
         offset += 4;
         gdnsd_put_una32(rrset->gen.ttl, &packet[offset]);
         offset += 6;
-        const ltree_rdata_mx_t* rd = &rrset->rdata[i];
+        const ltree_frdata_mx_t* rd = &rdata[i];
         gdnsd_put_una16(rd->pref, &packet[offset]);
         offset += 2;
-        const unsigned int newlen = store_dname(c, offset, rd->dname, false);
+        const unsigned int newlen = store_dname(c, offset, ltree_dref(&rd->dname), false);
         gdnsd_put_una16(htons(newlen + 2), &packet[offset - 4]);
-        if(rd->ad)
-            add_addtl_rrset(c, rd->ad, offset);
+        if(rd->ad && !c->minimal)
+            add_addtl_rrset(c, ltree_ad(&rd->ad), offset);
         offset += newlen;
     }
 
@@ -962,10 +1079,11 @@ static unsigned int encode_rrs_mx(dnspacket_context_t* c, unsigned int offset, c
 }
 
 F_NONNULL
-static unsigned int encode_rrs_srv(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_srv_t* rrset, const bool answer V_UNUSED) {
+static unsigned int encode_rrs_srv(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_srv_t* rrset, const bool answer V_UNUSED) {
     dmn_assert(c); dmn_assert(c->packet); dmn_assert(rrset);
 
     uint8_t* packet = c->packet;
+    const ltree_frdata_srv_t* rdata = ltree_fbody(&rrset->body);
 
     const unsigned rrct = rrset->gen.count;
     c->ancount += rrct;
@@ -975,7 +1093,7 @@ static unsigned int encode_rrs_srv(dnspacket_context_t* c, unsigned int offset,
         offset += 4;
         gdnsd_put_una32(rrset->gen.ttl, &packet[offset]);
         offset += 6;
-        const ltree_rdata_srv_t* rd = &rrset->rdata[i];
+        const ltree_frdata_srv_t* rd = &rdata[i];
         gdnsd_put_una16(rd->priority, &packet[offset]);
         offset += 2;
         gdnsd_put_una16(rd->weight, &packet[offset]);
@@ -983,10 +1101,10 @@ static unsigned int encode_rrs_srv(dnspacket_context_t* c, unsigned int offset,
         gdnsd_put_una16(rd->port, &packet[offset]);
         offset += 2;
         // SRV target can't be compressed
-        const unsigned int newlen = store_dname_nocomp(c, offset, rd->dname);
+        const unsigned int newlen = store_dname_nocomp(c, offset, ltree_dref(&rd->dname));
         gdnsd_put_una16(htons(newlen + 6), &packet[offset - 8]);
-        if(rd->ad)
-            add_addtl_rrset(c, rd->ad, offset);
+        if(rd->ad && !c->minimal)
+            add_addtl_rrset(c, ltree_ad(&rd->ad), offset);
         offset += newlen;
     }
 
@@ -994,10 +1112,11 @@ static unsigned int encode_rrs_srv(dnspacket_context_t* c, unsigned int offset,
 }
 
 F_NONNULL
-static unsigned int encode_rrs_naptr(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_naptr_t* rrset, const bool answer V_UNUSED) {
+static unsigned int encode_rrs_naptr(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_naptr_t* rrset, const bool answer V_UNUSED) {
     dmn_assert(c); dmn_assert(c->packet); dmn_assert(offset); dmn_assert(rrset);
 
     uint8_t* packet = c->packet;
+    const ltree_frdata_naptr_t* rdata = ltree_fbody(&rrset->body);
 
     const unsigned rrct = rrset->gen.count;
     c->ancount += rrct;
@@ -1008,7 +1127,7 @@ static unsigned int encode_rrs_naptr(dnspacket_context_t* c, unsigned int offset
         gdnsd_put_una32(rrset->gen.ttl, &packet[offset]);
         offset += 6;
         const unsigned int rdata_offset = offset;
-        const ltree_rdata_naptr_t* rd = &rrset->rdata[i];
+        const ltree_frdata_naptr_t* rd = &rdata[i];
         gdnsd_put_una16(rd->order, &packet[offset]);
         offset += 2;
         gdnsd_put_una16(rd->pref, &packet[offset]);
@@ -1016,17 +1135,17 @@ static unsigned int encode_rrs_naptr(dnspacket_context_t* c, unsigned int offset
 
         // flags, services, regexp
         for(unsigned j = 0; j < 3; j++) {
-            const uint8_t* this_txt = rd->texts[j];
+            const uint8_t* this_txt = ltree_dref(&rd->texts[j]);
             const unsigned int oal = *this_txt + 1; // oal is the encoded len value + 1 for the len byte itself
             memcpy(&packet[offset], this_txt, oal);
             offset += oal;
         }
 
         // NAPTR target can't be compressed
-        const unsigned newlen = store_dname_nocomp(c, offset, rd->dname);
+        const unsigned newlen = store_dname_nocomp(c, offset, ltree_dref(&rd->dname));
         gdnsd_put_una16(htons(offset - rdata_offset + newlen), &packet[rdata_offset - 2]);
-        if(rd->ad)
-            add_addtl_rrset(c, rd->ad, offset);
+        if(rd->ad && !c->minimal)
+            add_addtl_rrset(c, ltree_ad(&rd->ad), offset);
         offset += newlen;
     }
 
@@ -1034,10 +1153,11 @@ static unsigned int encode_rrs_naptr(dnspacket_context_t* c, unsigned int offset
 }
 
 F_NONNULL
-static unsigned int encode_rrs_txt(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_txt_t* rrset, const bool answer V_UNUSED) {
+static unsigned int encode_rrs_txt(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_txt_t* rrset, const bool answer V_UNUSED) {
     dmn_assert(c); dmn_assert(c->packet); dmn_assert(offset); dmn_assert(rrset);
 
     uint8_t* packet = c->packet;
+    const ltree_ref_t* rdata = ltree_fbody(&rrset->body);
 
     const unsigned rrct = rrset->gen.count;
     c->ancount += rrct;
@@ -1050,10 +1170,9 @@ static unsigned int encode_rrs_txt(dnspacket_context_t* c, unsigned int offset,
 
         const unsigned int rdata_offset = offset;
         unsigned int rdata_len = 0;
-        const uint8_t* restrict bs;
-        unsigned int j = 0;
-        const ltree_rdata_txt_t rd = rrset->rdata[i];
-        while((bs = rd[j++])) {
+        const ltree_ref_t* rd = ltree_ref(&rdata[i]);
+        while(*rd) {
+            const uint8_t* restrict bs = ltree_dref(rd++);
             const unsigned int oal = *bs + 1; // oal is the encoded len value + 1 for the len byte itself
             memcpy(&packet[offset], bs, oal);
             offset += oal;
@@ -1070,7 +1189,7 @@ static unsigned int encode_rrs_txt(dnspacket_context_t* c, unsigned int offset,
 //   here it means true: 'direct CNAME query', false: 'chaining through for a non-CNAME query'
 //    (and in either case, it's going into the answer section)
 F_NONNULL
-static unsigned int encode_rr_cname(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_cname_t* rd, const bool answer) {
+static unsigned int encode_rr_cname(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_cname_t* rd, const bool answer) {
     dmn_assert(c); dmn_assert(c->packet); dmn_assert(offset); dmn_assert(rd);
 
     uint8_t* packet = c->packet;
@@ -1084,7 +1203,7 @@ static unsigned int encode_rr_cname(dnspacket_context_t* c, unsigned int offset,
     offset += 6;
 
     const unsigned int rdata_offset = offset;
-    offset += store_dname(c, offset, rd->dname, false);
+    offset += store_dname(c, offset, ltree_dref(&rd->dname), false);
 
     // set rdata_len
     gdnsd_put_una16(htons(offset - rdata_offset), &packet[rdata_offset - 2]);
@@ -1101,21 +1220,22 @@ static unsigned int encode_rr_cname(dnspacket_context_t* c, unsigned int offset,
 }
 
 F_NONNULL
-static unsigned int encode_rr_soa_common(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_soa_t* rdata, const bool answer, const bool negative) {
-    dmn_assert(c); dmn_assert(c->packet); dmn_assert(offset); dmn_assert(rdata);
+static unsigned int encode_rr_soa_common(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_soa_t* rrset, const bool answer, const bool negative) {
+    dmn_assert(c); dmn_assert(c->packet); dmn_assert(offset); dmn_assert(rrset);
 
     uint8_t* packet = c->packet;
+    const ltree_frdata_soa_t* rdata = ltree_fbody(&rrset->body);
 
     offset += repeat_name(c, offset, c->auth_comp, false);
     gdnsd_put_una32(DNS_RRFIXED_SOA, &packet[offset]);
     offset += 4;
-    gdnsd_put_una32(negative ? rdata->neg_ttl : rdata->gen.ttl, &packet[offset]);
+    gdnsd_put_una32(negative ? rdata->neg_ttl : rrset->gen.ttl, &packet[offset]);
     offset += 6;
 
     // fill in the rdata
     const unsigned int rdata_offset = offset;
-    offset += store_dname(c, offset, rdata->master, false);
-    offset += store_dname(c, offset, rdata->email, false);
+    offset += store_dname(c, offset, ltree_dref(&rdata->master), false);
+    offset += store_dname(c, offset, ltree_dref(&rdata->email), false);
     memcpy(&packet[offset], &rdata->times, 20);
     offset += 20; // 5x 32-bits
 
@@ -1131,16 +1251,16 @@ static unsigned int encode_rr_soa_common(dnspacket_context_t* c, unsigned int of
 }
 
 F_NONNULL
-static unsigned int encode_rr_soa(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_soa_t* rdata, const bool answer) {
-    return encode_rr_soa_common(c, offset, rdata, answer, false);
+static unsigned int encode_rr_soa(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_soa_t* rrset, const bool answer) {
+    return encode_rr_soa_common(c, offset, rrset, answer, false);
 }
 
 F_NONNULL
-static unsigned int encode_rr_soa_negative(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_soa_t* rdata) {
-    return encode_rr_soa_common(c, offset, rdata, false, true);
+static unsigned int encode_rr_soa_negative(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_soa_t* rrset) {
+    return encode_rr_soa_common(c, offset, rrset, false, true);
 }
 
-static unsigned int encode_rrs_rfc3597(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_rfc3597_t* rrset, const bool answer V_UNUSED) {
+static unsigned int encode_rrs_rfc3597(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_rfc3597_t* rrset, const bool answer V_UNUSED) {
     dmn_assert(c); dmn_assert(c->packet); dmn_assert(offset); dmn_assert(rrset);
 
     // assert that DYNC (which is technically in the range
@@ -1150,6 +1270,7 @@ static unsigned int encode_rrs_rfc3597(dnspacket_context_t* c, unsigned int offs
     dmn_assert(rrset->gen.type != DNS_TYPE_DYNC);
 
     uint8_t* packet = c->packet;
+    const ltree_frdata_rfc3597_t* rdata = ltree_fbody(&rrset->body);
 
     const unsigned rrct = rrset->gen.count;
     c->ancount += rrct;
@@ -1161,85 +1282,128 @@ static unsigned int encode_rrs_rfc3597(dnspacket_context_t* c, unsigned int offs
         offset += 2;
         gdnsd_put_una32(rrset->gen.ttl, &packet[offset]);
         offset += 4;
-        gdnsd_put_una16(htons(rrset->rdata[i].rdlen), &packet[offset]);
+        gdnsd_put_una16(htons(rdata[i].rdlen), &packet[offset]);
         offset += 2;
-        memcpy(&packet[offset], rrset->rdata[i].rd, rrset->rdata[i].rdlen);
-        offset += rrset->rdata[i].rdlen;
+        memcpy(&packet[offset], ltree_dref(&rdata[i].rd), rdata[i].rdlen);
+        offset += rdata[i].rdlen;
+    }
+
+    return offset;
+}
+
+F_NONNULL
+static unsigned int encode_any_rrset(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_t* rrset) {
+    dmn_assert(c); dmn_assert(rrset);
+
+    switch(rrset->gen.type) {
+        case DNS_TYPE_A:
+            offset = encode_rrs_anyaddr(c, offset, (const void*)rrset, c->qname_comp, false);
+            break;
+        case DNS_TYPE_SOA:
+            offset = encode_rr_soa(c, offset, (const void*)rrset, true);
+            break;
+        case DNS_TYPE_CNAME:
+            offset = encode_rr_cname(c, offset, (const void*)rrset, true);
+            break;
+        case DNS_TYPE_NS:
+            offset = encode_rrs_ns(c, offset, (const void*)rrset, true);
+            break;
+        case DNS_TYPE_PTR:
+            offset = encode_rrs_ptr(c, offset, (const void*)rrset, true);
+            break;
+        case DNS_TYPE_MX:
+            offset = encode_rrs_mx(c, offset, (const void*)rrset, true);
+            break;
+        case DNS_TYPE_SRV:
+            offset = encode_rrs_srv(c, offset, (const void*)rrset, true);
+            break;
+        case DNS_TYPE_NAPTR:
+            offset = encode_rrs_naptr(c, offset, (const void*)rrset, true);
+            break;
+        case DNS_TYPE_TXT:
+            offset = encode_rrs_txt(c, offset, (const void*)rrset, true);
+            break;
+        case DNS_TYPE_DYNC:;
+            dmn_assert(0); // DYNC should never make it to here
+        default:
+            offset = encode_rrs_rfc3597(c, offset, (const void*)rrset, true);
+            break;
     }
 
     return offset;
 }
 
 F_NONNULLX(1)
-static unsigned int encode_rrs_any(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_t* res_rrsets) {
+static unsigned int encode_rrs_any(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_t* res_rrsets) {
     dmn_assert(c);
 
     // Address rrsets have to be processed first outside of the main loop,
     //   so that c->answer_addr_rrset gets set before any other RR-types
     //   try to add duplicate addr records to the addtl section
-    const ltree_rrset_t* rrset = res_rrsets;
+    const ltree_frrset_t* rrset = res_rrsets;
     while(rrset) {
         if(rrset->gen.type == DNS_TYPE_A)
-            offset = encode_rrs_anyaddr(c, offset, (const void*)rrset, c->qname_comp, false);
-        rrset = rrset->gen.next;
+            offset = encode_any_rrset(c, offset, rrset);
+        rrset = ltree_frrset_next(rrset);
     }
 
     rrset = res_rrsets;
     while(rrset) {
-        switch(rrset->gen.type) {
-            case DNS_TYPE_A:
-                // handled above
-                break;
-            case DNS_TYPE_SOA:
-                offset = encode_rr_soa(c, offset, (const void*)rrset, true);
-                break;
-            case DNS_TYPE_CNAME:
-                offset = encode_rr_cname(c, offset, (const void*)rrset, true);
-                break;
-            case DNS_TYPE_NS:
-                offset = encode_rrs_ns(c, offset, (const void*)rrset, true);
-                break;
-            case DNS_TYPE_PTR:
-                offset = encode_rrs_ptr(c, offset, (const void*)rrset, true);
-                break;
-            case DNS_TYPE_MX:
-                offset = encode_rrs_mx(c, offset, (const void*)rrset, true);
-                break;
-            case DNS_TYPE_SRV:
-                offset = encode_rrs_srv(c, offset, (const void*)rrset, true);
-                break;
-            case DNS_TYPE_NAPTR:
-                offset = encode_rrs_naptr(c, offset, (const void*)rrset, true);
-                break;
-            case DNS_TYPE_TXT:
-                offset = encode_rrs_txt(c, offset, (const void*)rrset, true);
-                break;
-            case DNS_TYPE_DYNC:;
-                dmn_assert(0); // DYNC should never make it to here
-            default:
-                offset = encode_rrs_rfc3597(c, offset, (const void*)rrset, true);
-                break;
-        }
-        rrset = rrset->gen.next;
+        if(rrset->gen.type != DNS_TYPE_A) // handled above
+            offset = encode_any_rrset(c, offset, rrset);
+        rrset = ltree_frrset_next(rrset);
     }
 
     return offset;
 }
 
+// RFC 8482 4.2: a single synthesized HINFO with CPU "RFC8482" and an
+//  empty OS, using the TTL of the first real rrset at the node.
+F_NONNULL
+static unsigned int encode_rr_hinfo_rfc8482(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_t* res_rrsets) {
+    dmn_assert(c); dmn_assert(offset); dmn_assert(res_rrsets);
+
+    static const uint8_t hinfo_rdata[] = "\007RFC8482\000";
+    static const unsigned hinfo_rdlen = sizeof(hinfo_rdata) - 1;
+
+    uint8_t* packet = c->packet;
+    offset += repeat_name(c, offset, c->qname_comp, false);
+    gdnsd_put_una32(DNS_RRFIXED_HINFO, &packet[offset]);
+    offset += 4;
+    gdnsd_put_una32(res_rrsets->gen.ttl, &packet[offset]);
+    offset += 4;
+    gdnsd_put_una16(htons(hinfo_rdlen), &packet[offset]);
+    offset += 2;
+    memcpy(&packet[offset], hinfo_rdata, hinfo_rdlen);
+    offset += hinfo_rdlen;
+    c->ancount++;
+
+    return offset;
+}
+
+// RFC 8482 4.1: a single representative rrset, preferring the
+//  address rrset (which covers both A and AAAA) if one exists.
+F_NONNULL
+static unsigned int encode_rrs_any_one(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_t* res_rrsets) {
+    dmn_assert(c); dmn_assert(offset); dmn_assert(res_rrsets);
+
+    const ltree_frrset_t* rrset = res_rrsets;
+    while(rrset && rrset->gen.type != DNS_TYPE_A)
+        rrset = ltree_frrset_next(rrset);
+
+    return encode_any_rrset(c, offset, rrset ? rrset : res_rrsets);
+}
+
 // These have no test for falling out with a NULL if we reach the end
 //  of the list because ltree already validated at startup that in all
 //  cases where we call these, the given RRset exists.
 #define MK_RRSET_GET(_typ, _nam, _dtyp) \
 F_NONNULL F_PURE \
-static const ltree_rrset_ ## _typ ## _t* ltree_node_get_rrset_ ## _nam (const ltree_node_t* node) {\
+static const ltree_frrset_ ## _typ ## _t* ltree_node_get_rrset_ ## _nam (const ltree_fnode_t* node) {\
     dmn_assert(node);\
-    const ltree_rrset_t* rrsets = node->rrsets;\
-    dmn_assert(rrsets);\
-    while(rrsets->gen.type != _dtyp) {\
-        rrsets = rrsets->gen.next;\
-        dmn_assert(rrsets);\
-    }\
-    return &rrsets-> _typ;\
+    const ltree_frrset_t* rrset = ltree_fnode_get_rrset(node, _dtyp);\
+    dmn_assert(rrset);\
+    return &rrset-> _typ;\
 }
 MK_RRSET_GET(soa, soa, DNS_TYPE_SOA)
 MK_RRSET_GET(ns, ns, DNS_TYPE_NS)
@@ -1506,34 +1670,58 @@ static unsigned int (*encode_funcptrs[256])(dnspacket_context_t*, unsigned int,
     NULL,                  // 255 - ANY
 };
 
-F_NONNULLX(1, 4)
-static unsigned int construct_normal_response(dnspacket_context_t* c, unsigned int offset, const ltree_rrset_t* res_rrsets, const ltree_node_t* authdom, const bool res_is_auth) {
+// "resnode" is the node whose own rrsets are "res_rrsets", for directory
+//  lookups, or NULL if they were synthesized from DYNC.
+F_NONNULLX(1, 5)
+static unsigned int construct_normal_response(dnspacket_context_t* c, unsigned int offset, const ltree_frrset_t* res_rrsets, const ltree_fnode_t* resnode, const ltree_fnode_t* authdom, const bool res_is_auth) {
     dmn_assert(c); dmn_assert(authdom);
 
     if(c->qtype == DNS_TYPE_ANY) {
-        offset = encode_rrs_any(c, offset, res_rrsets);
+        if(res_rrsets) {
+            switch(c->any_mode) {
+                case ANY_MODE_HINFO:
+                    offset = encode_rr_hinfo_rfc8482(c, offset, res_rrsets);
+                    stats_own_inc(&c->stats->any_hinfo);
+                    break;
+                case ANY_MODE_RRSET:
+                    offset = encode_rrs_any_one(c, offset, res_rrsets);
+                    stats_own_inc(&c->stats->any_rrset);
+                    break;
+                default:
+                    dmn_assert(c->any_mode == ANY_MODE_FULL);
+                    offset = encode_rrs_any(c, offset, res_rrsets);
+                    stats_own_inc(&c->stats->any_full);
+                    break;
+            }
+        }
     }
     else if(res_rrsets) {
-        const ltree_rrset_t* node_rrset = res_rrsets;
         unsigned etype = c->qtype;
         // rrset_addr is stored as type DNS_TYPE_A for both A and AAAA
         if(etype == DNS_TYPE_AAAA) etype = DNS_TYPE_A;
-        while(node_rrset) {
-            if(node_rrset->gen.type == etype) {
-                if(unlikely(etype & 0xFF00))
-                    offset = encode_rrs_rfc3597(c, offset, (const void*)node_rrset, true);
-                else
-                    offset = encode_funcptrs[c->qtype](c, offset, (const void*)node_rrset, true);
-                break;
-            }
-            node_rrset = node_rrset->gen.next;
+        const ltree_frrset_t* node_rrset;
+        if(resnode) {
+            node_rrset = ltree_fnode_get_rrset(resnode, etype);
+        }
+        else {
+            node_rrset = res_rrsets;
+            while(node_rrset && node_rrset->gen.type != etype)
+                node_rrset = ltree_frrset_next(node_rrset);
+        }
+        if(node_rrset) {
+            if(unlikely(etype & 0xFF00))
+                offset = encode_rrs_rfc3597(c, offset, (const void*)node_rrset, true);
+            else
+                offset = encode_funcptrs[c->qtype](c, offset, (const void*)node_rrset, true);
         }
     }
 
+    // In minimal mode the optional authority NS is never encoded at all, and
+    //  the encoders above have already skipped non-glue additional data
     if(!c->ancount)
         offset = encode_rr_soa_negative(c, offset, ltree_node_get_rrset_soa(authdom));
-    else if(gconfig.include_optional_ns && c->qtype != DNS_TYPE_NS
-        && (c->qtype != DNS_TYPE_ANY || !res_is_auth))
+    else if(!c->minimal && gconfig.include_optional_ns && c->qtype != DNS_TYPE_NS
+        && (c->qtype != DNS_TYPE_ANY || c->any_mode != ANY_MODE_FULL || !res_is_auth))
             offset = encode_rrs_ns(c, offset, ltree_node_get_rrset_ns(authdom), false);
 
     return offset;
@@ -1568,22 +1756,34 @@ static unsigned chase_auth_ptr(const uint8_t* packet, unsigned offset, unsigned
 }
 
 F_NONNULL
-static ltree_dname_status_t search_zone_for_dname(const uint8_t* dname, const zone_t* zone, const ltree_node_t** node_out, unsigned* auth_deleg_mod) {
+static ltree_dname_status_t search_zone_for_dname(const uint8_t* dname, const zone_t* zone, const ltree_fnode_t** node_out, unsigned* auth_deleg_mod) {
     dmn_assert(dname); dmn_assert(zone); dmn_assert(node_out);
     dmn_assert(*dname != 0); dmn_assert(*dname != 2); // these are always illegal dnames
     dmn_assert(dname_isinzone(zone->dname, dname));
 
     ltree_dname_status_t rval = DNAME_AUTH;
-    ltree_node_t* rv_node = NULL;
+    const ltree_fnode_t* rv_node = NULL;
     uint8_t local_dname[256];
     gdnsd_dname_copy(local_dname, dname);
     gdnsd_dname_drop_zone(local_dname, zone->dname);
 
+    const ltree_fnode_t* froot = zone->froot;
+
+    // An exact hit in the full-name index is always plain DNAME_AUTH,
+    //  anything else takes the label-by-label descent below
+    if(zone->nindex) {
+        const ltree_fnode_t* exact = ltree_nindex_find(zone->nindex, froot, local_dname);
+        if(exact) {
+            *node_out = exact;
+            return DNAME_AUTH;
+        }
+    }
+
     // construct label ptr stack
     const uint8_t* lstack[127];
     unsigned lcount = dname_to_lstack(local_dname, lstack);
 
-    ltree_node_t* current = zone->root;
+    const ltree_fnode_t* current = froot;
     unsigned deleg_mod = 0;
 
     do {
@@ -1595,7 +1795,7 @@ static ltree_dname_status_t search_zone_for_dname(const uint8_t* dname, const zo
             break;
         }
 
-        if(!lcount || !current->child_table) {
+        if(!lcount || !current->child_mask) {
             if(!lcount) rv_node = current;
             break;
         }
@@ -1604,28 +1804,17 @@ static ltree_dname_status_t search_zone_for_dname(const uint8_t* dname, const zo
         const uint8_t* child_label = lstack[lcount];
         deleg_mod += *child_label;
         deleg_mod++;
-        ltree_node_t* entry = current->child_table[label_djb_hash(child_label, current->child_hash_mask)];
-
-        while(entry) {
-            if(!gdnsd_label_cmp(entry->label, child_label)) {
-                current = entry;
-                goto top_loop;
-            }
-            entry = entry->next;
+        const ltree_fnode_t* entry = ltree_fnode_find_child(froot, current, child_label);
+        if(entry) {
+            current = entry;
+            goto top_loop;
         }
     } while(0);
 
-    //  If in auth space with no match, and we still have a child_table, check for wildcard
-    if(!rv_node && current->child_table) {
+    //  If in auth space with no match, and we still have child slots, check for wildcard
+    if(!rv_node && current->child_mask) {
         dmn_assert(rval == DNAME_AUTH);
-        ltree_node_t* entry = current->child_table[label_djb_hash((const uint8_t*)"\001*", current->child_hash_mask)];
-        while(entry) {
-            if(entry->label[0] == '\001' && entry->label[1] == '*') {
-                rv_node = entry;
-                break;
-            }
-            entry = entry->next;
-        }
+        rv_node = ltree_fnode_find_child(froot, current, (const uint8_t*)"\001*");
     }
 
     *node_out = rv_node;
@@ -1636,13 +1825,14 @@ static ltree_dname_status_t search_zone_for_dname(const uint8_t* dname, const zo
 //   a new rrset (possibly NULL) via the plugin, using context
 //   storage.
 F_NONNULL
-static const ltree_rrset_t* process_dync(dnspacket_context_t* c, const ltree_rrset_dync_t* rd) {
+static const ltree_frrset_t* process_dync(dnspacket_context_t* c, const ltree_frrset_dync_t* rd) {
     dmn_assert(rd);
     dmn_assert(!rd->gen.next); // DYNC does not co-exist with other rrsets
 
-    const ltree_rrset_t* rv = NULL;
+    const ltree_frrset_t* rv = NULL;
 
-    const unsigned ttl = do_dyn_callback(c, rd->func, rd->origin, rd->resource, rd->gen.ttl, rd->ttl_min);
+    const uint8_t* origin = tmpl_dname(c, ltree_dref(&rd->origin), TMPL_SLOT_ORIGIN);
+    const unsigned ttl = do_dyn_callback(c, rd->func, origin, rd->resource, rd->gen.ttl, rd->ttl_min);
     dyn_result_t* dr = c->dyn;
 
     if(dr->is_cname) {
@@ -1650,11 +1840,14 @@ static const ltree_rrset_t* process_dync(dnspacket_context_t* c, const ltree_rrs
         dmn_assert(c->dync_count < gconfig.max_cname_depth);
         uint8_t* cn_store = &c->dync_store[c->dync_count++ * 256];
         dname_copy(cn_store, dr->storage);
-        c->dync_cname.gen.type = DNS_TYPE_CNAME;
-        c->dync_cname.gen.count = 1;
-        c->dync_cname.gen.ttl = ttl;
-        c->dync_cname.dname = cn_store;
-        rv = (const ltree_rrset_t*)&c->dync_cname;
+        ltree_frrset_cname_t* cn = c->dync_cname;
+        cn->gen.next = 0;
+        cn->gen.type = DNS_TYPE_CNAME;
+        cn->gen.count = 1;
+        cn->gen.ttl = ttl;
+        cn->dname = (ltree_ref_t)(cn_store - (uint8_t*)&cn->dname);
+        cn->chain = 0;
+        rv = (const ltree_frrset_t*)cn;
     }
     else if(dr->count_v4 + dr->count_v6) {
         // ^ If both counts are zero, must represent this as
@@ -1668,20 +1861,17 @@ static const ltree_rrset_t* process_dync(dnspacket_context_t* c, const ltree_rrs
         if(!lv6 || lv6 > dr->count_v6)
             lv6 = dr->count_v6;
 
-        c->dync_addr.gen.type = DNS_TYPE_A;
-        c->dync_addr.gen.ttl = ttl;
-        c->dync_addr.count_v6 = dr->count_v6;
-        c->dync_addr.gen.count = dr->count_v4;
-        if(!dr->count_v6 && dr->count_v4 <= LTREE_V4A_SIZE) {
-            memcpy(c->dync_addr.v4a, dr->v4, sizeof(uint32_t) * dr->count_v4);
-        }
-        else {
-            c->dync_addr.addrs.v4 = dr->v4;
-            c->dync_addr.addrs.v6 = &dr->storage[result_v6_offset];
-        }
-        c->dync_addr.limit_v4 = lv4;
-        c->dync_addr.limit_v6 = lv6;
-        rv = (const ltree_rrset_t*)&c->dync_addr;
+        ltree_frrset_addr_t* addr = c->dync_addr;
+        addr->gen.next = 0;
+        addr->gen.type = DNS_TYPE_A;
+        addr->gen.ttl = ttl;
+        addr->gen.count = dr->count_v4;
+        addr->count_v6 = dr->count_v6;
+        memcpy(addr->addrs, dr->v4, sizeof(uint32_t) * dr->count_v4);
+        memcpy(&addr->addrs[dr->count_v4], &dr->storage[result_v6_offset], 16U * dr->count_v6);
+        addr->limit_v4 = lv4;
+        addr->limit_v6 = lv6;
+        rv = (const ltree_frrset_t*)addr;
     }
 
     return rv;
@@ -1694,9 +1884,10 @@ static unsigned int answer_from_db(dnspacket_context_t* c, const uint8_t* qname,
     const unsigned first_offset = offset;
     bool via_cname = false;
     unsigned cname_depth = 0;
-    const ltree_node_t* resdom = NULL;
-    const ltree_node_t* resauth = NULL;
-    const ltree_rrset_t* res_rrsets = NULL;
+    const ltree_fnode_t* resdom = NULL;
+    const ltree_fnode_t* resnode = NULL; // resdom, unless res_rrsets came from DYNC
+    const ltree_fnode_t* resauth = NULL;
+    const ltree_frrset_t* res_rrsets = NULL;
     wire_dns_header_t* res_hdr = (wire_dns_header_t*)c->packet;
 
     ltree_dname_status_t status = DNAME_NOAUTH;
@@ -1704,10 +1895,26 @@ static unsigned int answer_from_db(dnspacket_context_t* c, const uint8_t* qname,
 
     gdnsd_prcu_rdr_lock();
 
-    zone_t* query_zone = ztree_find_zone_for(qname, &auth_depth);
+    bool filtered;
+    zone_t* query_zone = ztree_find_zone_for(qname, &auth_depth, &filtered);
+    if(!query_zone) {
+        if(filtered)
+            stats_own_inc(&c->stats->zfilter_rejects);
+        else
+            stats_own_inc(&c->stats->zfilter_fp);
+    }
 
     if(query_zone) { // matches auth space somewhere
-        resauth = query_zone->root;
+        resauth = query_zone->froot;
+        c->minimal = query_zone->minimal_responses;
+        c->tmpl_dname = query_zone->tmpl ? query_zone->dname : NULL;
+
+        // RFC 8482 ANY minimization only applies to UDP, and never to
+        //   sources listed in any_full_sources
+        if(c->qtype == DNS_TYPE_ANY && c->is_udp
+            && query_zone->any_mode != ANY_MODE_FULL
+            && !conf_any_full_source(&c->client_info.dns_source))
+            c->any_mode = query_zone->any_mode;
 
         bool iterating_for_cname = false;
 
@@ -1726,16 +1933,19 @@ static unsigned int answer_from_db(dnspacket_context_t* c, const uint8_t* qname,
 
             iterating_for_cname = false;
 
-            res_rrsets = resdom ? resdom->rrsets : NULL;
-            if(res_rrsets && res_rrsets->gen.type == DNS_TYPE_DYNC)
+            resnode = resdom;
+            res_rrsets = resdom ? ltree_fnode_rrsets(resdom) : NULL;
+            if(resdom && (resdom->type_bits & LTREE_TBIT_DYNC)) {
                 res_rrsets = process_dync(c, &res_rrsets->dync);
+                resnode = NULL;
+            }
 
             // Indirect-CNAME-lookup (CNAME data for a non-CNAME(/ANY) query):
             // Fills in 1+ CNAME RRs and then alters status/resdom/via_cname
-            //  for the normal response handling code below.  The explicit check of the first
-            //  rrsets entry works because if CNAME exists at all, by definition it is the only
-            //  type of rrset at this node.
-            if(res_rrsets && res_rrsets->gen.type == DNS_TYPE_CNAME
+            //  for the normal response handling code below.  For DYNC results, the
+            //  explicit check of the first rrsets entry works because if CNAME exists
+            //  at all, by definition it is the only type of rrset at this node.
+            if(res_rrsets && (resnode ? (resnode->type_bits & LTREE_TBIT_CNAME) : res_rrsets->gen.type == DNS_TYPE_CNAME)
                 && c->qtype != DNS_TYPE_CNAME
                 && c->qtype != DNS_TYPE_ANY) {
 
@@ -1749,6 +1959,7 @@ static unsigned int answer_from_db(dnspacket_context_t* c, const uint8_t* qname,
                     log_err("Query for '%s' leads to a CNAME chain longer than %u (max_cname_depth)! This is a DYNC plugin configuration problem, and gdnsd will respond with NXDOMAIN protect against infinite client<->server CNAME-chasing loops!", logf_dname(qname), gconfig.max_cname_depth);
                     // wipe state back to an empty NXDOMAIN response
                     resdom = NULL;
+                    resnode = NULL;
                     res_rrsets = NULL;
                     offset = first_offset;
                     c->ancount = 0;
@@ -1756,19 +1967,43 @@ static unsigned int answer_from_db(dnspacket_context_t* c, const uint8_t* qname,
                     break;
                 }
 
-                const ltree_rrset_cname_t* cname = &res_rrsets->cname;
+                const ltree_frrset_cname_t* cname = &res_rrsets->cname;
                 offset = encode_rr_cname(c, offset, cname, false);
 
-                if(dname_isinzone(query_zone->dname, cname->dname)) {
+                // Static chains precomputed by ltree postproc: emit the
+                //   remaining hops and take the final result directly
+                const ltree_fcname_chain_t* chain = ltree_ref(&cname->chain);
+                if(chain && (cname_depth + chain->len) <= gconfig.max_cname_depth) {
+                    for(unsigned i = 0; i < chain->len; i++) {
+                        cname = ltree_ref(&chain->hops[i]);
+                        offset = encode_rr_cname(c, offset, cname, false);
+                    }
+                    cname_depth += chain->len;
+                    if(chain->noauth) {
+                        status = DNAME_NOAUTH;
+                    }
+                    else {
+                        qname = tmpl_dname(c, ltree_dref(&cname->dname), TMPL_SLOT_QNAME);
+                        auth_depth = *qname - *query_zone->dname;
+                        c->auth_comp = chase_auth_ptr(c->packet, c->qname_comp, auth_depth);
+                        resdom = ltree_ref(&chain->fnode);
+                        resnode = resdom;
+                        res_rrsets = resdom ? ltree_fnode_rrsets(resdom) : NULL;
+                    }
+                }
+                else {
                     // if the RHS of the CNAME is still in-zone, we're going
                     //   to reset some initial parameters (qname, auth_depth)
                     //   and loop back up via the do/while...
-                    qname = cname->dname;
-                    auth_depth = *qname - *query_zone->dname;
-                    iterating_for_cname = true;
-                }
-                else {
-                    status = DNAME_NOAUTH;
+                    const uint8_t* target = tmpl_dname(c, ltree_dref(&cname->dname), TMPL_SLOT_QNAME);
+                    if(dname_isinzone(query_zone->dname, target)) {
+                        qname = target;
+                        auth_depth = *qname - *query_zone->dname;
+                        iterating_for_cname = true;
+                    }
+                    else {
+                        status = DNAME_NOAUTH;
+                    }
                 }
             } // indirect-CNAME-lookup block
         } while(iterating_for_cname); // recurse into CNAME chain
@@ -1778,10 +2013,10 @@ static unsigned int answer_from_db(dnspacket_context_t* c, const uint8_t* qname,
         dmn_assert(resauth);
         res_hdr->flags1 |= 4; // AA bit
         if(likely(resdom)) {
-            offset = construct_normal_response(c, offset, res_rrsets, resauth, (resdom == resauth));
+            offset = construct_normal_response(c, offset, res_rrsets, resnode, resauth, (resdom == resauth));
         }
         else {
-            const ltree_rrset_soa_t* soa = ltree_node_get_rrset_soa(resauth);
+            const ltree_frrset_soa_t* soa = ltree_node_get_rrset_soa(resauth);
             dmn_assert(soa);
             res_hdr->flags2 = DNS_RCODE_NXDOMAIN;
             offset = encode_rr_soa_negative(c, offset, soa);
@@ -1790,7 +2025,7 @@ static unsigned int answer_from_db(dnspacket_context_t* c, const uint8_t* qname,
     }
     else if(status == DNAME_DELEG) {
         dmn_assert(resdom);
-        const ltree_rrset_ns_t* ns = ltree_node_get_rrset_ns(resdom);
+        const ltree_frrset_ns_t* ns = ltree_node_get_rrset_ns(resdom);
         dmn_assert(ns);
         offset = encode_rrs_ns(c, offset, ns, false);
     }
@@ -1807,14 +2042,58 @@ static unsigned int answer_from_db(dnspacket_context_t* c, const uint8_t* qname,
     return offset;
 }
 
+// Fast-path variant of answer_from_db() for A/AAAA queries whose name lands
+//  directly on a static address rrset with data for the queried family.
+//  Anything else (no zone, delegation, NXDOMAIN, CNAME, DYNA/DYNC, nodata)
+//  returns zero without having touched the context or the response, and
+//  the caller must fall back to answer_from_db().
 F_NONNULL
-static unsigned int answer_from_db_outer(dnspacket_context_t* c, uint8_t* qname, unsigned int offset) {
+static unsigned int answer_addr_fast(dnspacket_context_t* c, const uint8_t* qname, const unsigned int offset) {
     dmn_assert(c); dmn_assert(qname); dmn_assert(offset);
+    dmn_assert(c->qtype == DNS_TYPE_A || c->qtype == DNS_TYPE_AAAA);
 
-    const unsigned full_trunc_offset = offset;
+    unsigned rv = 0;
+    unsigned auth_depth;
+    bool filtered;
+    const ltree_fnode_t* resdom = NULL;
+
+    gdnsd_prcu_rdr_lock();
+
+    const zone_t* query_zone = ztree_find_zone_for(qname, &auth_depth, &filtered);
+    if(likely(query_zone)
+        && likely(search_zone_for_dname(qname, query_zone, &resdom, &auth_depth) == DNAME_AUTH)
+        && likely(resdom)) {
+        const ltree_frrset_t* rrset = ltree_fnode_get_rrset(resdom, DNS_TYPE_A);
+        // static addr rrsets always have a non-zero count for at least
+        //  one family, dynamic ones have zero for both.
+        if(rrset && (c->qtype == DNS_TYPE_A ? rrset->addr.gen.count : rrset->addr.count_v6)) {
+            wire_dns_header_t* res_hdr = (wire_dns_header_t*)c->packet;
+            res_hdr->flags1 |= 4; // AA bit
+            c->auth_comp = c->qname_comp + auth_depth;
+            c->minimal = query_zone->minimal_responses;
+            c->tmpl_dname = query_zone->tmpl ? query_zone->dname : NULL;
+            if(c->qtype == DNS_TYPE_A)
+                rv = encode_rrs_a(c, offset, &rrset->addr, true);
+            else
+                rv = encode_rrs_aaaa(c, offset, &rrset->addr, true);
+            dmn_assert(c->ancount);
+            if(gconfig.include_optional_ns && !c->minimal)
+                rv = encode_rrs_ns(c, rv, ltree_node_get_rrset_ns(query_zone->froot), false);
+        }
+    }
+
+    gdnsd_prcu_rdr_unlock();
+
+    return rv;
+}
+
+// Final TC-bit check, additional section trimming, and copy of the
+//  additional section into the packet, for both answer paths above.
+F_NONNULL
+static unsigned int answer_finish(dnspacket_context_t* c, unsigned int offset, const unsigned int full_trunc_offset) {
+    dmn_assert(c); dmn_assert(offset); dmn_assert(full_trunc_offset);
 
     wire_dns_header_t* res_hdr = (wire_dns_header_t*)c->packet;
-    offset = answer_from_db(c, qname, offset);
 
     // Check for TC-bit (overflow w/ just ans, auth, and glue)
     if(unlikely(offset + (c->addtl_has_glue ? c->addtl_offset : 0) > c->this_max_response)) {
@@ -1845,6 +2124,15 @@ static unsigned int answer_from_db_outer(dnspacket_context_t* c, uint8_t* qname,
     return offset;
 }
 
+F_NONNULL
+static unsigned int answer_from_db_outer(dnspacket_context_t* c, uint8_t* qname, unsigned int offset) {
+    dmn_assert(c); dmn_assert(qname); dmn_assert(offset);
+
+    const unsigned full_trunc_offset = offset;
+    offset = answer_from_db(c, qname, offset);
+    return answer_finish(c, offset, full_trunc_offset);
+}
+
 unsigned int process_dns_query(dnspacket_context_t* c, const dmn_anysin_t* asin, uint8_t* packet, const unsigned int packet_len) {
     dmn_assert(c && asin && packet);
 
@@ -1865,7 +2153,13 @@ unsigned int process_dns_query(dnspacket_context_t* c, const dmn_anysin_t* asin,
     uint8_t lqname[256];
     unsigned question_len = 0;
 
-    const rcode_rv_t status = decode_query(c, lqname, &question_len, packet_len, asin);
+    // Plain A/AAAA queries get a cheaper decode and answer, with any
+    //  deviation from the expected shape falling back to the general code
+    rcode_rv_t status = DECODE_OK;
+    const bool fast = gconfig.addr_fast_path
+        && decode_query_fast(c, lqname, &question_len, packet_len);
+    if(!fast)
+        status = decode_query(c, lqname, &question_len, packet_len, asin);
 
     if(status == DECODE_IGNORE) {
         stats_own_inc(&c->stats->dropped);
@@ -1902,7 +2196,13 @@ unsigned int process_dns_query(dnspacket_context_t* c, const dmn_anysin_t* asin,
 
         if(likely(!c->chaos)) {
             memcpy(&c->client_info.dns_source, asin, sizeof(dmn_anysin_t));
-            res_offset = answer_from_db_outer(c, lqname, res_offset);
+            if(c->qtype == DNS_TYPE_ANY)
+                stats_own_inc(&c->stats->any);
+            const unsigned fast_offset = fast ? answer_addr_fast(c, lqname, res_offset) : 0;
+            if(fast_offset)
+                res_offset = answer_finish(c, fast_offset, res_offset);
+            else
+                res_offset = answer_from_db_outer(c, lqname, res_offset);
         }
         else {
             c->ancount = 1;
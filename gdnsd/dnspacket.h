@@ -68,6 +68,19 @@ typedef struct {
 
   // A percentage of "edns" above:
   stats_t edns_clientsub;
+
+  // Zone apex filter: "rejects" are names refused without a
+  //   ztree search, "fp" are names which passed the filter but
+  //   turned out not to be in any zone.
+  stats_t zfilter_rejects;
+  stats_t zfilter_fp;
+
+  // qtype=ANY queries outside of class CH ("any"), and how the
+  //   ones which found a node with data were answered (RFC 8482)
+  stats_t any;
+  stats_t any_full;
+  stats_t any_hinfo;
+  stats_t any_rrset;
 } dnspacket_stats_t;
 
 typedef struct {
@@ -77,11 +90,19 @@ typedef struct {
 } comptarget_t;
 
 typedef struct {
-    const ltree_rrset_addr_t* rrset;
+    const ltree_frrset_addr_t* rrset;
     unsigned prev_offset; // offset into c->addtl_store before this rrset was added
     unsigned prev_arcount; // c->arcount before this rrset was added
 } addtl_rrset_t;
 
+// Slot in the open-addressed set of rrsets already in the addtl section.
+//  A slot is only occupied for the current request if its gen matches
+//  the context's addtl_gen.
+typedef struct {
+    const ltree_frrset_addr_t* rrset;
+    unsigned gen;
+} addtl_slot_t;
+
 // DNS request context.  You must have a unique
 //  one of these for each thread that might call
 //  into process_dns_query().
@@ -104,6 +125,13 @@ typedef struct {
     // Stores information about each additional rrset processed
     addtl_rrset_t* addtl_rrsets;
 
+    // Pointer set mirroring addtl_rrsets for duplicate checks, sized to a
+    //  power of two at least twice gconfig.max_addtl_rrsets.  It is reset
+    //  per-request by bumping addtl_gen rather than by clearing it.
+    addtl_slot_t* addtl_set;
+    unsigned addtl_set_mask;
+    unsigned addtl_gen;
+
     // Compression offsets, these are one per domainname in the whole
     //  packet.  Fully compressed names are not added, so this is really
     //  the number of unique domainnames in a response packet, so 255
@@ -116,9 +144,20 @@ typedef struct {
     // used to pseudo-randomly rotate some RRsets (A, AAAA, NS, PTR)
     gdnsd_rstate_t* rand_state;
 
-    // Allocated at dnspacket startup, needs room for gconfig.max_cname_depth * 256
+    // Synthetic rrsets for DYNC results, allocated at dnspacket startup.
+    //  dync_store (room for gconfig.max_cname_depth * 256) follows
+    //  dync_cname in the same allocation, as the rrset's dname reference
+    //  points into it, and dync_addr has room for the addresses of a
+    //  full dyn_result_t.  Only one is used at a time.
+    ltree_frrset_cname_t* dync_cname;
+    ltree_frrset_addr_t* dync_addr;
     uint8_t* dync_store;
 
+    // Allocated at dnspacket startup, room for (COMPTARGETS_MAX + 3) * 256.
+    //  Holds RHS dnames of template zones rewritten to the query zone name:
+    //  one per comptarget slot, the current CNAME-chased qname, and a DYNC origin.
+    uint8_t* tmpl_store;
+
     // This is sized the same as the main packet buffer (gconfig.max_response), and
     //  used as temporary space for building Additional section records
     uint8_t* addtl_store;
@@ -132,7 +171,7 @@ typedef struct {
 // From this point (answer_addr_rrset) on, all of this gets reset to zero
 //  at the start of each request...
 
-    const ltree_rrset_addr_t* answer_addr_rrset;
+    const ltree_frrset_addr_t* answer_addr_rrset;
     client_info_t client_info; // dns source IP + optional EDNS client subnet info for plugins
     unsigned int comptarget_count; // unique domainnames stored to the packet, including the original question
     unsigned int dync_count; // how many results have been stored to dync_store so far
@@ -144,12 +183,6 @@ typedef struct {
     unsigned int arcount;
     unsigned int cname_ancount;
 
-    // synthetic rrsets for DYNC (only one can be used at a time)
-    union {
-        ltree_rrset_cname_t dync_cname;
-        ltree_rrset_addr_t dync_addr;
-    };
-
     // EDNS Client Subnet response mask.
     // Not valid/useful unless use_edns_client_subnet is true below.
     // For static responses, this is set to zero by dnspacket.c
@@ -160,6 +193,16 @@ typedef struct {
     // Whether additional section contains glue (can't be silently truncated)
     bool addtl_has_glue;
 
+    // Minimal responses for the query zone: only glue may be added to
+    //  the additional section, and no optional authority NS.
+    bool minimal;
+
+    // How to answer qtype=ANY for this query
+    any_mode_t any_mode;
+
+    // Name of the query zone if it is attached to a template, else NULL
+    const uint8_t* tmpl_dname;
+
     // Whether this request had a valid EDNS0 optrr
     bool use_edns;
 
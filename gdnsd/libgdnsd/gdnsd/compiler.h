@@ -39,6 +39,7 @@
 #  define F_NONNULL       __attribute__((__nonnull__))
 #  define F_WUNUSED       __attribute__((__warn_unused_result__))
 #  define HAVE_BUILTIN_CLZ 1
+#  define HAVE_BUILTIN_POPCOUNT 1
 #else // Other C99+ compilers...
 #  define likely(x)       (!!(x))
 #  define unlikely(x)     (!!(x))
@@ -23,7 +23,30 @@
 #include "gdnsd/compiler.h"
 #include "gdnsd/misc.h"
 
+#include <setjmp.h>
+
 // Globally initialize meta-prng at daemon startup
 void gdnsd_rand_meta_init(void);
 
+// Maps the whole of the open regular file "fd" read-only for a single
+//   sequential scan, setting *len_out to the file's length.  At least one
+//   NUL byte is always readable just past the end of the file data.
+//   Returns NULL if the file can't be mapped (not a regular file, empty,
+//   or mmap() failure), in which case the caller should use read().
+F_NONNULL F_WUNUSED
+const char* gdnsd_map_file(const int fd, size_t* len_out);
+
+// Unmaps the result of gdnsd_map_file()
+F_NONNULL
+void gdnsd_unmap_file(const char* addr, const size_t len);
+
+// A mapped file that's truncated while it's being scanned raises
+//   SIGBUS on access to the vanished pages.  While a guard is set
+//   with gdnsd_map_guard(&jb) (after sigsetjmp(jb, 0)), a SIGBUS in
+//   the calling thread does siglongjmp(jb, GDNSD_MAP_FAULT) instead
+//   of killing the process.  gdnsd_map_guard(NULL) clears it, and
+//   must be called on every path out of the scan.
+#define GDNSD_MAP_FAULT 2
+void gdnsd_map_guard(sigjmp_buf* jb);
+
 #endif // GDNSD_MISC_PRIV_H
@@ -40,6 +40,8 @@
 #define gdnsd_prcu_upd_lock() do { } while(0)
 #define gdnsd_prcu_upd_assign(d,s) rcu_assign_pointer((d),(s))
 #define gdnsd_prcu_upd_unlock() synchronize_rcu()
+#define gdnsd_prcu_upd_unlock_nosync() do { } while(0)
+#define gdnsd_prcu_synchronize() synchronize_rcu()
 #define gdnsd_prcu_destroy_lock() do { } while(0)
 
 #else // !HAVE_QSBR
@@ -60,6 +62,11 @@ void gdnsd_prcu_setup_lock(void);
 #define gdnsd_prcu_upd_lock() pthread_rwlock_wrlock(&gdnsd_prcu_rwlock)
 #define gdnsd_prcu_upd_assign(d,s) (d) = (s)
 #define gdnsd_prcu_upd_unlock() pthread_rwlock_unlock(&gdnsd_prcu_rwlock)
+#define gdnsd_prcu_upd_unlock_nosync() pthread_rwlock_unlock(&gdnsd_prcu_rwlock)
+#define gdnsd_prcu_synchronize() do { \
+    pthread_rwlock_wrlock(&gdnsd_prcu_rwlock); \
+    pthread_rwlock_unlock(&gdnsd_prcu_rwlock); \
+} while(0)
 void gdnsd_prcu_destroy_lock(void);
 
 #endif // HAVE_QSBR
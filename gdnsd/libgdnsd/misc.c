@@ -35,6 +35,11 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include <setjmp.h>
 
 #ifdef HAVE_PTHREAD_NP_H
 #  include <pthread_np.h>
@@ -148,6 +153,87 @@ void gdnsd_thread_setname(const char* n V_UNUSED) {
     #endif
 }
 
+// Length of the whole mapping for a file of "len" bytes, which always
+//   extends at least one byte into the following page.
+static size_t map_file_len(const size_t len) {
+    const size_t pgsz = (size_t)sysconf(_SC_PAGESIZE);
+    return ((len / pgsz) + 1U) * pgsz;
+}
+
+const char* gdnsd_map_file(const int fd, size_t* len_out) {
+    dmn_assert(fd >= 0); dmn_assert(len_out);
+
+    struct stat st;
+    if(fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0)
+        return NULL;
+    const size_t len = (size_t)st.st_size;
+    const size_t maplen = map_file_len(len);
+
+    // Reserve the full length with anonymous zero pages first, then map
+    //   the file over the start.  The bytes past EOF in the file's final
+    //   page read as zero, and when the file ends exactly on a page
+    //   boundary, the trailing anonymous page provides the terminator.
+    void* base = mmap(NULL, maplen, PROT_READ, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED)
+        return NULL;
+
+    int flags = MAP_PRIVATE|MAP_FIXED;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    void* m = mmap(base, len, PROT_READ, flags, fd, 0);
+    if(m == MAP_FAILED) {
+        munmap(base, maplen);
+        return NULL;
+    }
+
+#ifdef POSIX_MADV_SEQUENTIAL
+    (void)posix_madvise(m, len, POSIX_MADV_SEQUENTIAL);
+#endif
+
+    *len_out = len;
+    return m;
+}
+
+void gdnsd_unmap_file(const char* addr, const size_t len) {
+    dmn_assert(addr);
+    munmap((void*)addr, map_file_len(len));
+}
+
+// The SIGBUS handler is process-wide, but the fault is delivered to
+//   the faulting thread, so each scanning thread has its own target.
+static __thread sigjmp_buf* map_guard_jb = NULL;
+static pthread_once_t map_guard_once = PTHREAD_ONCE_INIT;
+
+static void map_guard_sigbus(int sig V_UNUSED) {
+    sigjmp_buf* jb = map_guard_jb;
+    if(jb) {
+        map_guard_jb = NULL;
+        siglongjmp(*jb, GDNSD_MAP_FAULT);
+    }
+    // Not from a guarded scan: restore the default action, and the
+    //   faulting access will raise it again on return
+    signal(SIGBUS, SIG_DFL);
+}
+
+static void map_guard_install(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = map_guard_sigbus;
+    // the guarded sigsetjmp() doesn't save the signal mask, so
+    //   SIGBUS must not be left blocked after the siglongjmp()
+    sa.sa_flags = SA_NODEFER;
+    if(sigaction(SIGBUS, &sa, NULL))
+        log_fatal("sigaction() for SIGBUS failed: %s", dmn_logf_errno());
+}
+
+void gdnsd_map_guard(sigjmp_buf* jb) {
+    if(jb)
+        pthread_once(&map_guard_once, map_guard_install);
+    map_guard_jb = jb;
+}
+
 /***************
  * This Public-Domain JLKISS64 PRNG implementation is from:
  * http://www.cs.ucl.ac.uk/staff/d.jones/GoodPracticeRNG.pdf
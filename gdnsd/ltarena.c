@@ -18,26 +18,50 @@
  */
 
 #include "ltarena.h"
+#include "conf.h"
 #include "gdnsd/compiler.h"
 #include "gdnsd/dname.h"
+#include "gdnsd/log.h"
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 
-// ltarena: used for dname/label strings only, pooled to
+// ltarena: used for dname/label/text strings, pooled to
 //   reduce the per-alloc overhead of malloc aligning and
 //   tracking every single one needlessly.
-// Each pool is normally POOL_SIZE, non-growing to preserve
-//   *some* amount of locality-of-reference to the related
-//   objects referencing the strings.
+// The first pool is POOL_SIZE, and each new pool doubles in
+//   size up to POOL_SIZE_MAX, so that tiny zones stay tiny while
+//   zones with millions of strings (e.g. TXT data) don't pay for
+//   an allocation every few records.  Pools never grow in place,
+//   which preserves *some* amount of locality-of-reference to the
+//   related objects referencing the strings.
 // We initially reserve room in the ltarena object to track
 //   8 pools, which expands by doubling to support far more
 //   pools than needed by even the largest zones in existence.
 #define POOL_SIZE 512U // *must* be >= (256 + (red_size*2)),
                        //    && multiple of 4
+#define POOL_SIZE_MAX 65536U // *must* be POOL_SIZE * 2^n
 #define INIT_POOLS_ALLOC 4U // *must* be 2^n && > 0
 
+// Data too large for a pool (see lta_datadup()) is malloc()'d
+//   individually instead, and tracked in the "bigs" array so that it's
+//   freed along with the pools.
+
+// When gconfig.zones_hugepages is enabled, blocks from lta_block() of
+//   at least REGION_MIN bytes (the frozen data of large zones) are
+//   instead carved in order from anonymous mappings of (multiples of)
+//   REGION_SIZE, aligned to REGION_SIZE so that each can be backed by
+//   huge pages.  Smaller blocks are carved there too if they fit in the
+//   rest of the current mapping, and otherwise are posix_memalign()'d
+//   as usual, so that small zones don't each pay for a whole 2MB
+//   mapping.  The regions array tracks blocks and mappings alike.
+#define REGION_SIZE 0x200000U // 2MB, *must* be 2^n
+#define REGION_MIN (REGION_SIZE >> 1U)
+#define BLOCK_ALIGN 64U // *must* be 2^n
+
 // Normally, our pools are initialized to all-zeros for us
 //   by calloc(), and no red zones are employed.  In debug
 //   builds, we initialize a whole pool to 0xDEADBEEF,
@@ -113,34 +137,132 @@ static void dnhash_grow(dnhash_t* dnhash) {
 }
 
 
+typedef struct {
+    void* addr;
+    size_t size;
+    bool mapped; // from region_map() rather than posix_memalign()
+} region_t;
+
 struct _ltarena {
     void** pools;
     unsigned pool;
     unsigned poffs;
     unsigned palloc;
+    unsigned psize;  // size of the current pool
+    size_t pbytes;   // total size of all pools
+    void** bigs;     // individual large data allocations
+    unsigned num_bigs;
+    size_t bbytes;   // total size of all bigs
     dnhash_t* dnhash;
+    region_t* regions;
+    unsigned num_regions;
+    uint8_t* rcur; // the current mapped region, hugepage mode only
+    size_t rsize;  // size of rcur
+    size_t roffs;  // used bytes of rcur
+    lta_hugepages_t hugepages;
 };
 
-static void* make_pool(void) {
+// Maps a new REGION_SIZE-aligned region of "size" bytes
+F_MALLOC F_WUNUSED
+static void* region_map(const lta_hugepages_t hugepages, const size_t size) {
+    dmn_assert(hugepages != LTA_HUGEPAGES_NONE);
+    dmn_assert(!(size & (REGION_SIZE - 1U)));
+
+#ifdef MAP_HUGETLB
+    if(hugepages == LTA_HUGEPAGES_HUGETLB) {
+        void* p = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+        if(p != MAP_FAILED)
+            return p;
+        // parse worker threads map regions concurrently, so the
+        //   once-only flag must be claimed atomically
+        static unsigned warned = 0;
+        if(__sync_bool_compare_and_swap(&warned, 0, 1))
+            log_warn("zones_hugepages: MAP_HUGETLB mapping of %lu bytes failed (%s), using transparent hugepages instead", (unsigned long)size, dmn_logf_errno());
+    }
+#endif
+
+    // Over-map by one region and trim, to align the start
+    uint8_t* p = mmap(NULL, size + REGION_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(p == MAP_FAILED)
+        log_fatal("mmap() of %lu bytes for zone data failed: %s", (unsigned long)(size + REGION_SIZE), dmn_logf_errno());
+    uint8_t* aligned = (uint8_t*)(((uintptr_t)p + REGION_SIZE - 1U) & ~((uintptr_t)REGION_SIZE - 1U));
+    const size_t head = (size_t)(aligned - p);
+    if(head)
+        munmap(p, head);
+    if(REGION_SIZE - head)
+        munmap(aligned + size, REGION_SIZE - head);
+
+#ifdef MADV_HUGEPAGE
+    if(madvise(aligned, size, MADV_HUGEPAGE)) {
+        static unsigned warned = 0;
+        if(__sync_bool_compare_and_swap(&warned, 0, 1))
+            log_warn("zones_hugepages: madvise(MADV_HUGEPAGE) failed: %s", dmn_logf_errno());
+    }
+#endif
+
+    return aligned;
+}
+
+F_NONNULL
+static void region_track(ltarena_t* lta, void* addr, const size_t size, const bool mapped) {
+    dmn_assert(lta); dmn_assert(addr);
+
+    // grows by doubling whenever the count hits a power of two
+    if(!(lta->num_regions & (lta->num_regions - 1U)))
+        lta->regions = realloc(lta->regions, (lta->num_regions ? lta->num_regions << 1U : 1U) * sizeof(region_t));
+    lta->regions[lta->num_regions].addr = addr;
+    lta->regions[lta->num_regions].size = size;
+    lta->regions[lta->num_regions].mapped = mapped;
+    lta->num_regions++;
+}
+
+// Carve a BLOCK_ALIGN-aligned "size" bytes from the current region,
+//   mapping a new one if it doesn't fit, or if "size" is under REGION_MIN
+//   and doesn't fit, return NULL.  Memory is pre-zeroed by mmap().
+F_WUNUSED F_NONNULL
+static void* region_alloc(ltarena_t* lta, const size_t size) {
+    dmn_assert(lta); dmn_assert(lta->hugepages != LTA_HUGEPAGES_NONE);
+    dmn_assert(size);
+
+    size_t offs = (lta->roffs + BLOCK_ALIGN - 1U) & ~((size_t)BLOCK_ALIGN - 1U);
+    if(!lta->rcur || offs + size > lta->rsize) {
+        if(size < REGION_MIN)
+            return NULL;
+        lta->rsize = (size + REGION_SIZE - 1U) & ~((size_t)REGION_SIZE - 1U);
+        lta->rcur = region_map(lta->hugepages, lta->rsize);
+        region_track(lta, lta->rcur, lta->rsize, true);
+        offs = 0;
+    }
+
+    lta->roffs = offs + size;
+    return lta->rcur + offs;
+}
+
+F_NONNULL
+static void* make_pool(ltarena_t* lta) {
+    dmn_assert(lta);
     dmn_assert(!(POOL_SIZE & 3U)); // multiple of four
 
+    const unsigned psize = lta->psize;
+    lta->pbytes += psize;
+
     void* p;
     if(RED_SIZE) {
         // malloc + fill in deadbeef if using redzones
-        p = malloc(POOL_SIZE);
+        p = malloc(psize);
         uint32_t* p32 = (uint32_t*)p;
-        unsigned idx = POOL_SIZE >> 2U;
+        unsigned idx = psize >> 2U;
         while(idx--)
             p32[idx] = 0xDEADBEEF;
     }
     else {
         // get mem from calloc
-        p = calloc(1, POOL_SIZE);
+        p = calloc(1, psize);
     }
 
     // let valgrind know what's going on, if running
     //   and we're a debug build
-    NOWARN_VALGRIND_MAKE_MEM_NOACCESS(p, POOL_SIZE);
+    NOWARN_VALGRIND_MAKE_MEM_NOACCESS(p, psize);
     NOWARN_VALGRIND_CREATE_MEMPOOL(p, RED_SIZE, 1U);
 
     return p;
@@ -148,9 +270,11 @@ static void* make_pool(void) {
 
 ltarena_t* lta_new(void) {
     ltarena_t* rv = calloc(1, sizeof(ltarena_t));
+    rv->hugepages = gconfig.zones_hugepages;
     rv->palloc = INIT_POOLS_ALLOC;
+    rv->psize = POOL_SIZE;
     rv->pools = malloc(INIT_POOLS_ALLOC * sizeof(void*));
-    rv->pools[0] = make_pool();
+    rv->pools[0] = make_pool(rv);
     rv->dnhash = dnhash_new();
     return rv;
 }
@@ -163,24 +287,90 @@ void lta_close(ltarena_t* lta) {
     }
 }
 
-void lta_destroy(ltarena_t* lta) {
-    lta_close(lta);
+// Frees the pools, if they haven't been already
+F_NONNULL
+static void pools_free(ltarena_t* lta) {
+    dmn_assert(lta);
+    if(!lta->pools)
+        return;
     unsigned whichp = lta->pool + 1U;
     while(whichp--) {
         NOWARN_VALGRIND_DESTROY_MEMPOOL(lta->pools[whichp]);
         free(lta->pools[whichp]);
     }
     free(lta->pools);
+    lta->pools = NULL;
+}
+
+// Frees the large data allocations, if any
+F_NONNULL
+static void bigs_free(ltarena_t* lta) {
+    dmn_assert(lta);
+    for(unsigned i = 0; i < lta->num_bigs; i++)
+        free(lta->bigs[i]);
+    free(lta->bigs);
+    lta->bigs = NULL;
+    lta->num_bigs = 0;
+    lta->bbytes = 0;
+}
+
+void lta_free_strings(ltarena_t* lta) {
+    dmn_assert(lta);
+    dmn_assert(!lta->dnhash); // closed
+    bigs_free(lta);
+    pools_free(lta);
+    lta->pbytes = 0;
+}
+
+void lta_destroy(ltarena_t* lta) {
+    lta_close(lta);
+    pools_free(lta);
+    bigs_free(lta);
+    for(unsigned i = 0; i < lta->num_regions; i++) {
+        if(lta->regions[i].mapped)
+            munmap(lta->regions[i].addr, lta->regions[i].size);
+        else
+            free(lta->regions[i].addr);
+    }
+    free(lta->regions);
     free(lta);
 }
 
+size_t lta_size(const ltarena_t* lta) {
+    dmn_assert(lta);
+
+    size_t rv = lta->pbytes + lta->bbytes;
+    for(unsigned i = 0; i < lta->num_regions; i++)
+        rv += lta->regions[i].size;
+    return rv;
+}
+
+void* lta_block(ltarena_t* lta, const size_t size) {
+    dmn_assert(lta); dmn_assert(size);
+
+    if(lta->hugepages != LTA_HUGEPAGES_NONE) {
+        void* rblock = region_alloc(lta, size);
+        if(rblock)
+            return rblock;
+    }
+
+    void* block;
+    const int pm_err = posix_memalign(&block, BLOCK_ALIGN, size);
+    if(unlikely(pm_err))
+        log_fatal("posix_memalign(%u, %lu) failed: %s", BLOCK_ALIGN, (unsigned long)size, dmn_logf_strerror(pm_err));
+    memset(block, 0, size);
+    region_track(lta, block, size, false);
+    return block;
+}
+
 F_MALLOC F_WUNUSED F_NONNULL
 static void* lta_malloc(ltarena_t* lta, const unsigned size) {
     dmn_assert(lta); dmn_assert(size);
     dmn_assert(lta->dnhash); // not closed
 
     // Currently, all allocations obey this assertion.
-    // Only labels + dnames are stored here, which max out at 256
+    // Only labels, dnames, and small rdata (see lta_datadup())
+    //   are stored here, which max out at 256
     dmn_assert(size <= 256);
 
     // the requested size + redzones on either end, giving the total
@@ -195,12 +385,14 @@ static void* lta_malloc(ltarena_t* lta, const unsigned size) {
 
     // handle pool switch if we're out of room
     //   + take care to extend the pools array if necc.
-    if(unlikely((lta->poffs + size_plus_red > POOL_SIZE))) {
+    if(unlikely((lta->poffs + size_plus_red > lta->psize))) {
+        if(lta->psize < POOL_SIZE_MAX)
+            lta->psize <<= 1U;
         if(unlikely(++lta->pool == lta->palloc)) {
             lta->palloc <<= 1U;
             lta->pools = realloc(lta->pools, lta->palloc * sizeof(void*));
         }
-        lta->pools[lta->pool] = make_pool();
+        lta->pools[lta->pool] = make_pool(lta);
         lta->poffs = 0;
     }
 
@@ -252,3 +444,22 @@ const uint8_t* lta_dnamedup(ltarena_t* lta, const uint8_t* dname) {
 
     return retval;
 }
+
+uint8_t* lta_datadup(ltarena_t* lta, const uint8_t* data, const unsigned len) {
+    dmn_assert(lta); dmn_assert(data); dmn_assert(len);
+    dmn_assert(lta->dnhash); // not closed
+
+    if(len <= 256U) {
+        uint8_t* rv = lta_malloc(lta, len);
+        memcpy(rv, data, len);
+        return rv;
+    }
+
+    // grows by doubling whenever the count hits a power of two
+    if(!(lta->num_bigs & (lta->num_bigs - 1U)))
+        lta->bigs = realloc(lta->bigs, (lta->num_bigs ? lta->num_bigs << 1U : 1U) * sizeof(void*));
+    uint8_t* rv = lta->bigs[lta->num_bigs++] = malloc(len);
+    lta->bbytes += len;
+    memcpy(rv, data, len);
+    return rv;
+}
@@ -27,11 +27,19 @@
 
 /******************************************************************\
 * ltarena is arena storage for ltree string data, it allocates
-*   unaligned string data in giant pools with no overhead.
+*   unaligned string data in giant pools with no overhead.  It
+*   also owns the large per-zone blocks of frozen ltree data.
 \******************************************************************/
 
 typedef struct _ltarena ltarena_t;
 
+// Backing memory for arena data, from gconfig.zones_hugepages
+typedef enum {
+    LTA_HUGEPAGES_NONE = 0, // malloc-family allocations
+    LTA_HUGEPAGES_THP,      // 2MB-aligned mmap regions + MADV_HUGEPAGE
+    LTA_HUGEPAGES_HUGETLB,  // MAP_HUGETLB regions, falling back to THP
+} lta_hugepages_t;
+
 // Allocate a new arena
 F_MALLOC F_WUNUSED
 ltarena_t* lta_new(void);
@@ -50,11 +58,34 @@ uint8_t* lta_labeldup(ltarena_t* lta, const uint8_t* label);
 F_WUNUSED F_NONNULL
 const uint8_t* lta_dnamedup(ltarena_t* lta, const uint8_t* dname);
 
-// Close an arena to further allocations, idempotent.
-// After this call, the only valid operations are _close()/_destroy()
+// Copies "len" (non-zero) bytes of arbitrary rdata (TXT strings,
+//  RFC3597 data) into the arena, with the same lifetime rules as
+//  the above.  Data larger than a label is malloc()'d separately, but
+//  is still freed with the pools.
+F_MALLOC F_WUNUSED F_NONNULL
+uint8_t* lta_datadup(ltarena_t* lta, const uint8_t* data, const unsigned len);
+
+// Allocate a zeroed, cache-line-aligned block of zone data that lives
+//  until lta_destroy().  Unlike the string allocators above, this remains
+//  valid after lta_close().  With hugepages enabled, large blocks are
+//  carved from 2MB-aligned regions instead.
+F_MALLOC F_WUNUSED F_NONNULL
+void* lta_block(ltarena_t* lta, const size_t size);
+
+// Close an arena to further string allocations, idempotent.
+// After this call, the only valid operations are _block()/_close()/_destroy()
 F_NONNULL
 void lta_close(ltarena_t* lta);
 
+// Frees the string pools of a closed arena, once nothing references the
+//  labels, dnames, and data allocated from them.  Blocks are unaffected.
+F_NONNULL
+void lta_free_strings(ltarena_t* lta);
+
+// Total bytes of pool and block storage held by an arena
+F_NONNULL F_PURE
+size_t lta_size(const ltarena_t* lta);
+
 // Destroy an arena, freeing all storage associated with it
 F_NONNULL
 void lta_destroy(ltarena_t* lta);
@@ -0,0 +1,202 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ltintern.h"
+#include "gdnsd/compiler.h"
+#include "gdnsd/log.h"
+#include "gdnsd/misc.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// INIT_MASK + 1 is the initial number of hash buckets, which
+//   grows by doubling whenever the count of distinct objects
+//   exceeds the bucket count.  Objects are chained per-bucket,
+//   so that a release can unlink its object directly.
+#define INIT_MASK 1023U // *must* be 2^n-1 && > 0
+
+typedef struct _lti_ent_struct lti_ent_t;
+struct _lti_ent_struct {
+    lti_ent_t* next;
+    uint32_t hash;
+    uint32_t refcount;
+    uint32_t len;
+    uint32_t handle;
+    uintptr_t data[];
+};
+
+static pthread_mutex_t lti_lock = PTHREAD_MUTEX_INITIALIZER;
+static lti_ent_t** lti_table = NULL;
+static unsigned lti_mask = 0;
+static unsigned lti_count = 0;
+static uint64_t lti_bytes = 0;
+
+// Handles are assigned from lti_next_handle (zero is never used), or
+//   recycled from the stack of those released
+const void** lti_chunks[LTI_CHUNKS];
+static unsigned lti_num_chunks = 0;
+static uint32_t lti_next_handle = 1;
+static uint32_t* lti_free_handles = NULL;
+static unsigned lti_free_count = 0;
+static unsigned lti_free_alloc = 0;
+
+F_NONNULL
+static lti_ent_t* lti_ent_of(const void* interned) {
+    dmn_assert(interned);
+    return (lti_ent_t*)((uintptr_t)interned - offsetof(lti_ent_t, data));
+}
+
+// Assigns a handle for a new object, under lti_lock
+F_NONNULL
+static void lti_handle_assign(lti_ent_t* ent) {
+    dmn_assert(ent);
+
+    uint32_t handle;
+    if(lti_free_count) {
+        handle = lti_free_handles[--lti_free_count];
+    }
+    else {
+        handle = lti_next_handle++;
+        const unsigned chunk = handle >> LTI_CHUNK_BITS;
+        if(unlikely(chunk == LTI_CHUNKS))
+            log_fatal("Interned zone data exceeds %u distinct objects", (LTI_CHUNKS << LTI_CHUNK_BITS) - 1U);
+        if(chunk == lti_num_chunks) {
+            lti_chunks[chunk] = malloc(LTI_CHUNK_SIZE * sizeof(void*));
+            lti_num_chunks++;
+        }
+    }
+
+    ent->handle = handle;
+    lti_chunks[handle >> LTI_CHUNK_BITS][handle & (LTI_CHUNK_SIZE - 1U)] = ent->data;
+}
+
+static void lti_grow(void) {
+    const unsigned old_mask = lti_mask;
+    const unsigned new_mask = (old_mask << 1U) | 1U;
+    lti_ent_t** new_table = calloc(new_mask + 1U, sizeof(lti_ent_t*));
+    for(unsigned i = 0; i <= old_mask; i++) {
+        lti_ent_t* ent = lti_table[i];
+        while(ent) {
+            lti_ent_t* next = ent->next;
+            lti_ent_t** slot = &new_table[ent->hash & new_mask];
+            ent->next = *slot;
+            *slot = ent;
+            ent = next;
+        }
+    }
+    free(lti_table);
+    lti_table = new_table;
+    lti_mask = new_mask;
+}
+
+// Interns one object, under lti_lock
+F_NONNULL
+static void lti_intern_one(lti_obj_t* obj) {
+    dmn_assert(obj); dmn_assert(obj->data);
+
+    const unsigned len = obj->len;
+    const uint32_t hash = gdnsd_lookup2((const char*)obj->data, len);
+
+    lti_ent_t* ent = lti_table[hash & lti_mask];
+    while(ent) {
+        if(ent->hash == hash && ent->len == len && !memcmp(ent->data, obj->data, len)) {
+            ent->refcount++;
+            obj->handle = ent->handle;
+            return;
+        }
+        ent = ent->next;
+    }
+
+    ent = malloc(sizeof(lti_ent_t) + len);
+    ent->hash = hash;
+    ent->refcount = 1;
+    ent->len = len;
+    memcpy(ent->data, obj->data, len);
+    lti_handle_assign(ent);
+    lti_ent_t** slot = &lti_table[hash & lti_mask];
+    ent->next = *slot;
+    *slot = ent;
+    lti_bytes += sizeof(lti_ent_t) + len;
+    if(++lti_count > lti_mask)
+        lti_grow();
+    obj->handle = ent->handle;
+}
+
+void lti_intern(lti_obj_t* objs, const unsigned count) {
+    dmn_assert(objs);
+
+    pthread_mutex_lock(&lti_lock);
+
+    if(!lti_table) {
+        lti_mask = INIT_MASK;
+        lti_table = calloc(INIT_MASK + 1U, sizeof(lti_ent_t*));
+    }
+
+    for(unsigned i = 0; i < count; i++)
+        lti_intern_one(&objs[i]);
+
+    pthread_mutex_unlock(&lti_lock);
+}
+
+// Drops one reference to an object, under lti_lock
+static void lti_release_one(const uint32_t handle) {
+    lti_ent_t* ent = lti_ent_of(lti_handle_ptr(handle));
+    dmn_assert(ent->handle == handle);
+    dmn_assert(ent->refcount);
+
+    if(!--ent->refcount) {
+        lti_ent_t** slot = &lti_table[ent->hash & lti_mask];
+        while(*slot != ent) {
+            dmn_assert(*slot);
+            slot = &(*slot)->next;
+        }
+        *slot = ent->next;
+        lti_count--;
+        lti_bytes -= sizeof(lti_ent_t) + ent->len;
+        if(lti_free_count == lti_free_alloc) {
+            lti_free_alloc = lti_free_alloc ? lti_free_alloc << 1U : 1024U;
+            lti_free_handles = realloc(lti_free_handles, lti_free_alloc * sizeof(uint32_t));
+        }
+        lti_free_handles[lti_free_count++] = handle;
+        free(ent);
+    }
+}
+
+void lti_release(const uint32_t* handles, const unsigned count) {
+    dmn_assert(handles);
+
+    pthread_mutex_lock(&lti_lock);
+    for(unsigned i = 0; i < count; i++)
+        lti_release_one(handles[i]);
+    pthread_mutex_unlock(&lti_lock);
+}
+
+unsigned lti_stats(uint64_t* bytes_out) {
+    dmn_assert(bytes_out);
+    pthread_mutex_lock(&lti_lock);
+    const unsigned rv = lti_count;
+    *bytes_out = lti_bytes + (lti_table ? (lti_mask + 1U) * sizeof(lti_ent_t*) : 0)
+        + ((uint64_t)lti_num_chunks * LTI_CHUNK_SIZE * sizeof(void*))
+        + (lti_free_alloc * sizeof(uint32_t));
+    pthread_mutex_unlock(&lti_lock);
+    return rv;
+}
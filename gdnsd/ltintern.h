@@ -0,0 +1,82 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GDNSD_LTINTERN_H
+#define GDNSD_LTINTERN_H
+
+#include "config.h"
+#include "gdnsd/compiler.h"
+#include "gdnsd/log.h"
+#include <inttypes.h>
+
+/******************************************************************\
+* ltintern is a process-wide, refcounted intern table for immutable
+*   zone data (the rdata "bodies" of frozen rrsets, see ltree.h),
+*   keyed by content, so that identical data across all zones is
+*   stored only once.  It is used by ltree when the config option
+*   zones_intern is set, and is safe to call from any thread.
+* Interned objects are referred to by small integer handles, stable
+*   for their lifetimes, so that frozen zone data can refer to them
+*   with 31 bits rather than a pointer.  Objects are interned and
+*   released in batches, which take the table's lock only once.
+* Interned data must never be modified, and every reference taken
+*   must eventually be dropped via lti_release().
+\******************************************************************/
+
+// The handle table is a fixed array of lazily-allocated chunks, which
+//   are never moved or freed, so handle lookups need no locking.
+#define LTI_CHUNK_BITS 16U
+#define LTI_CHUNK_SIZE (1U << LTI_CHUNK_BITS)
+#define LTI_CHUNKS (1U << 15U) // handles are < 2^31
+
+extern const void** lti_chunks[LTI_CHUNKS];
+
+// One object to intern: "len" bytes at "data" ("len" may be zero).
+//   lti_intern() sets "handle" to that of the shared copy.
+typedef struct {
+    const void* data;
+    unsigned len;
+    uint32_t handle;
+} lti_obj_t;
+
+// Interns "count" objects, adding one reference to each.  The
+//   interned copies are 8-byte aligned.
+F_NONNULL
+void lti_intern(lti_obj_t* objs, const unsigned count);
+
+// Drops one reference to each of "count" handles from lti_intern(),
+//   freeing the objects whose last reference is dropped.  Handles of
+//   freed objects are recycled.
+F_NONNULL
+void lti_release(const uint32_t* handles, const unsigned count);
+
+// The data for a handle from lti_intern(), for as long as a
+//   reference to it is held.
+F_PURE F_UNUSED
+static inline const void* lti_handle_ptr(const uint32_t handle) {
+    dmn_assert(handle); dmn_assert(handle < (LTI_CHUNKS << LTI_CHUNK_BITS));
+    return lti_chunks[handle >> LTI_CHUNK_BITS][handle & (LTI_CHUNK_SIZE - 1U)];
+}
+
+// Returns the count of distinct interned objects and (via "bytes_out")
+//   the bytes they use, including per-object overhead.
+F_NONNULL
+unsigned lti_stats(uint64_t* bytes_out);
+
+#endif // GDNSD_LTINTERN_H
@@ -24,10 +24,12 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <limits.h>
+#include <pthread.h>
 
 #include "conf.h"
 #include "dnspacket.h"
 #include "ltarena.h"
+#include "ltintern.h"
 #include "gdnsd/dname.h"
 #include "gdnsd/log.h"
 
@@ -398,6 +400,19 @@ bool ltree_add_rec_aaaa(const zone_t* zone, const uint8_t* dname, const uint8_t*
     return false;
 }
 
+// Zones may be parsed concurrently by zone source worker threads, but
+//   plugins' map_res() callbacks were never required to be thread-safe.
+static pthread_mutex_t map_res_lock = PTHREAD_MUTEX_INITIALIZER;
+
+F_NONNULLX(1)
+static int ltree_map_res(const plugin_t* p, const char* resname, const uint8_t* origin) {
+    dmn_assert(p); dmn_assert(p->map_res);
+    pthread_mutex_lock(&map_res_lock);
+    const int rv = p->map_res(resname, origin);
+    pthread_mutex_unlock(&map_res_lock);
+    return rv;
+}
+
 bool ltree_add_rec_dynaddr(const zone_t* zone, const uint8_t* dname, const uint8_t* rhs, unsigned ttl, unsigned ttl_min, const unsigned limit_v4, const unsigned limit_v6, const bool ooz) {
     dmn_assert(zone); dmn_assert(dname); dmn_assert(rhs);
 
@@ -447,7 +462,7 @@ bool ltree_add_rec_dynaddr(const zone_t* zone, const uint8_t* dname, const uint8
         rrset->dyn.func = p->resolve;
         rrset->dyn.resource = 0;
         if(p->map_res) {
-            const int res = p->map_res(resource_name, NULL);
+            const int res = ltree_map_res(p, resource_name, NULL);
             if(res < 0)
                 log_zfatal("Name '%s%s': resolver plugin '%s' rejected resource name '%s'", logf_dname(dname), logf_dname(zone->dname), plugin_name, resource_name);
             else
@@ -508,11 +523,11 @@ bool ltree_add_rec_dync(const zone_t* zone, const uint8_t* dname, const uint8_t*
         log_zfatal("Name '%s%s': DYNC RR refers to a non-resolver plugin", logf_dname(dname), logf_dname(zone->dname));
     rrset->func = p->resolve;
 
-    // we pass rrset->origin instead of origin here, in case the plugin author saves the pointer
-    //  (which he probably shouldn't, but can't hurt to make life easier)
+    // The origin passed here is only valid for the duration of the call,
+    //  as the mutable tree's dnames are freed once the zone is frozen
     rrset->resource = 0;
     if(p->map_res) {
-        const int res = p->map_res(resource_name, rrset->origin);
+        const int res = ltree_map_res(p, resource_name, rrset->origin);
         if(res < 0)
             log_zfatal("Name '%s%s': plugin '%s' rejected DYNC resource '%s' at origin '%s'", logf_dname(dname), logf_dname(zone->dname), plugin_name, resource_name, rrset->origin);
         rrset->resource = (unsigned)res;
@@ -644,7 +659,7 @@ static bool naptr_validate_flags(const uint8_t* zone_dname, const uint8_t* dname
     return false;
 }
 
-bool ltree_add_rec_naptr(const zone_t* zone, const uint8_t* dname, const uint8_t* rhs, unsigned ttl, const unsigned order, const unsigned pref, const unsigned num_texts V_UNUSED, uint8_t** texts) {
+bool ltree_add_rec_naptr(const zone_t* zone, const uint8_t* dname, const uint8_t* rhs, unsigned ttl, const unsigned order, const unsigned pref, const unsigned num_texts V_UNUSED, const uint8_t* const* texts) {
     dmn_assert(zone); dmn_assert(dname); dmn_assert(rhs); dmn_assert(texts); dmn_assert(num_texts == 3);
 
     if(unlikely(order > 65535U))
@@ -663,22 +678,24 @@ bool ltree_add_rec_naptr(const zone_t* zone, const uint8_t* dname, const uint8_t
     new_rdata->dname = lta_dnamedup(zone->arena, rhs);
     new_rdata->order = htons(order);
     new_rdata->pref = htons(pref);
-    memcpy(new_rdata->texts, texts, sizeof(new_rdata->texts));
+    for(unsigned i = 0; i < 3; i++)
+        new_rdata->texts[i] = texts[i] ? lta_datadup(zone->arena, texts[i], *texts[i] + 1U) : NULL;
     new_rdata->ad = NULL;
     return false;
 }
 
-// We copy the array of pointers, but alias the actual data (which is malloc'd for
-//   us per call in the parser).
-bool ltree_add_rec_txt(const zone_t* zone, const uint8_t* dname, const unsigned num_texts, uint8_t** texts, unsigned ttl) {
+// We copy the array of pointers, and copy the actual data (which the parser
+//   only lends us for the call) into the arena.
+bool ltree_add_rec_txt(const zone_t* zone, const uint8_t* dname, const unsigned num_texts, const uint8_t* const* texts, unsigned ttl) {
     dmn_assert(zone); dmn_assert(dname); dmn_assert(texts); dmn_assert(num_texts);
 
     ltree_node_t* node = ltree_find_or_add_dname(zone, dname);
 
     INSERT_NEXT_RR(txt, txt, "TXT", 1)
     ltree_rdata_txt_t new_rd = *new_rdata = malloc((num_texts + 1) * sizeof(uint8_t*));
-    for(unsigned i = 0; i <= num_texts; i++)
-        new_rd[i] = texts[i];
+    for(unsigned i = 0; i < num_texts; i++)
+        new_rd[i] = lta_datadup(zone->arena, texts[i], *texts[i] + 1U);
+    new_rd[num_texts] = NULL;
     return false;
 }
 
@@ -741,7 +758,7 @@ static ltree_rrset_rfc3597_t* ltree_node_add_rrset_rfc3597(ltree_node_t* node, c
 }
 
 
-bool ltree_add_rec_rfc3597(const zone_t* zone, const uint8_t* dname, const unsigned rrtype, unsigned ttl, const unsigned rdlen, uint8_t* rd) {
+bool ltree_add_rec_rfc3597(const zone_t* zone, const uint8_t* dname, const unsigned rrtype, unsigned ttl, const unsigned rdlen, const uint8_t* rd) {
     dmn_assert(zone); dmn_assert(dname);
 
     ltree_node_t* node = ltree_find_or_add_dname(zone, dname);
@@ -784,7 +801,7 @@ bool ltree_add_rec_rfc3597(const zone_t* zone, const uint8_t* dname, const unsig
     }
 
     new_rdata->rdlen = rdlen;
-    new_rdata->rd = rd;
+    new_rdata->rd = (rd && rdlen) ? lta_datadup(zone->arena, rd, rdlen) : NULL;
     return false;
 }
 
@@ -890,8 +907,11 @@ static void fix_addr_limits(ltree_rrset_addr_t* node_addr) {
             node_addr->limit_v6 = node_addr->count_v6;
 }
 
+// Besides validation, this records the whole chain in node_cname->chain
+//   whenever its outcome is fully static, so that dnspacket.c can emit it
+//   without re-searching the tree at each hop.
 F_WUNUSED F_NONNULL
-static bool p1_proc_cname(const zone_t* zone, const ltree_rrset_cname_t* node_cname, const uint8_t** lstack, const unsigned depth) {
+static bool p1_proc_cname(const zone_t* zone, ltree_rrset_cname_t* node_cname, const uint8_t** lstack, const unsigned depth) {
     dmn_assert(zone); dmn_assert(node_cname); dmn_assert(lstack);
 
     ltree_node_t* cn_target;
@@ -907,6 +927,7 @@ static bool p1_proc_cname(const zone_t* zone, const ltree_rrset_cname_t* node_cn
         }
     }
 
+    const ltree_rrset_cname_t* hops[gconfig.max_cname_depth];
     unsigned cn_depth = 1;
     while(cn_target && cnstat == DNAME_AUTH && cn_target->rrsets && cn_target->rrsets->gen.type == DNS_TYPE_CNAME) {
         if(unlikely(++cn_depth > gconfig.max_cname_depth)) {
@@ -914,9 +935,22 @@ static bool p1_proc_cname(const zone_t* zone, const ltree_rrset_cname_t* node_cn
             break;
         }
         ltree_rrset_cname_t* cur_cname = &cn_target->rrsets->cname;
+        hops[cn_depth - 2] = cur_cname;
         cnstat = ltree_search_dname_zone(cur_cname->dname, zone, &cn_target);
     }
 
+    // DELEG and DYNC outcomes are left to the runtime code
+    if(cnstat == DNAME_NOAUTH || (cnstat == DNAME_AUTH
+      && !(cn_target && cn_target->rrsets && cn_target->rrsets->gen.type == DNS_TYPE_DYNC))) {
+        const unsigned nhops = cn_depth - 1;
+        ltree_cname_chain_t* chain = malloc(sizeof(ltree_cname_chain_t) + (nhops * sizeof(ltree_rrset_cname_t*)));
+        chain->node = (cnstat == DNAME_AUTH) ? cn_target : NULL;
+        chain->noauth = (cnstat == DNAME_NOAUTH);
+        chain->len = nhops;
+        memcpy(chain->hops, hops, nhops * sizeof(ltree_rrset_cname_t*));
+        node_cname->chain = chain;
+    }
+
     return false;
 }
 
@@ -1221,12 +1255,1023 @@ static void ltree_fix_masks(ltree_node_t* node) {
     }
 }
 
+// Frozen-layout construction, see ltree_fnode_t in ltree.h.
+// One of these per node, in breadth-first order.
+typedef struct {
+    ltree_node_t* node;
+    unsigned parent;      // index of this node's parent
+    unsigned first_child; // index of this node's first child
+    unsigned num_child;
+    unsigned first_rrset; // index of this node's first rrset in ltree_freeze()
+    unsigned num_rrsets;
+    unsigned dname_len;   // first byte of the name relative to the zone
+    bool indexed;         // goes in the full-name index
+    size_t rrsets_bytes;  // space for the node's rrsets
+    size_t offset;        // of the frozen node within the block
+} freeze_ent_t;
+
+// The dnames, strings, and RFC3597 rdata which are copied to the end of
+//  the frozen block, each only once, keyed on the address of the
+//  original (an open-addressed table which is doubled at half full).
+typedef struct {
+    uint32_t offset; // from freeze_data_t.base
+    uint32_t len;
+} freeze_dslot_t;
+
+typedef struct {
+    const uint8_t** keys;
+    freeze_dslot_t* slots;
+    uint32_t mask;
+    unsigned count;
+    size_t bytes;      // total so far
+    uint8_t* base;     // start of the data within the frozen block
+} freeze_data_t;
+
+#define FNODE_ALIGN4(_x) (((_x) + 3U) & ~((size_t)3U))
+#define FNODE_ALIGN8(_x) (((_x) + 7U) & ~((size_t)7U))
+// Frozen rrsets are pointer-aligned (as ltree_frrset_t is, for the plugin
+//  callbacks of some types), within the 8-byte aligned rrsets of a node
+#define FNODE_ALIGNP(_x) (((_x) + sizeof(void*) - 1U) & ~(sizeof(void*) - 1U))
+
+F_CONST
+static uint32_t fdata_hash(const uint8_t* data) {
+    uintptr_t x = (uintptr_t)data;
+    x ^= x >> 17U;
+    const uint32_t h = (uint32_t)x * 0x9E3779B1U;
+    return h ^ (h >> 15U);
+}
+
+F_NONNULL F_PURE
+static uint32_t fdata_slot(const freeze_data_t* fd, const uint8_t* data) {
+    dmn_assert(fd); dmn_assert(data);
+    uint32_t slot = fdata_hash(data) & fd->mask;
+    while(fd->keys[slot] && fd->keys[slot] != data)
+        slot = (slot + 1U) & fd->mask;
+    return slot;
+}
+
+// Accounts for a data item of "len" bytes at "data", if not NULL
+F_NONNULLX(1)
+static void fdata_add(freeze_data_t* fd, const uint8_t* data, const unsigned len) {
+    dmn_assert(fd);
+
+    if(!data)
+        return;
+
+    uint32_t slot = fdata_slot(fd, data);
+    if(fd->keys[slot])
+        return;
+
+    if(fd->count >= (fd->mask >> 1U)) {
+        const uint32_t old_mask = fd->mask;
+        const uint8_t** old_keys = fd->keys;
+        freeze_dslot_t* old_slots = fd->slots;
+        fd->mask = (old_mask << 1U) | 1U;
+        fd->keys = calloc(fd->mask + 1U, sizeof(*fd->keys));
+        fd->slots = malloc((fd->mask + 1U) * sizeof(*fd->slots));
+        for(uint32_t i = 0; i <= old_mask; i++) {
+            if(old_keys[i]) {
+                const uint32_t new_slot = fdata_slot(fd, old_keys[i]);
+                fd->keys[new_slot] = old_keys[i];
+                fd->slots[new_slot] = old_slots[i];
+            }
+        }
+        free(old_keys);
+        free(old_slots);
+        slot = fdata_slot(fd, data);
+    }
+
+    fd->keys[slot] = data;
+    fd->slots[slot].offset = (uint32_t)fd->bytes;
+    fd->slots[slot].len = len;
+    fd->count++;
+    fd->bytes += len;
+}
+
+// Copies all of the data accounted for above into place at fd->base
+F_NONNULL
+static void fdata_copy(const freeze_data_t* fd) {
+    dmn_assert(fd); dmn_assert(fd->base);
+    for(uint32_t i = 0; i <= fd->mask; i++)
+        if(fd->keys[i])
+            memcpy(fd->base + fd->slots[i].offset, fd->keys[i], fd->slots[i].len);
+}
+
+// A reference at "ref" to a data item accounted for above, or 0 for NULL
+F_NONNULLX(1, 2)
+static ltree_ref_t fdata_ref(const freeze_data_t* fd, const ltree_ref_t* ref, const uint8_t* data) {
+    dmn_assert(fd); dmn_assert(ref);
+    if(!data)
+        return 0;
+    const uint32_t slot = fdata_slot(fd, data);
+    dmn_assert(fd->keys[slot] == data);
+    return (ltree_ref_t)((fd->base + fd->slots[slot].offset) - (const uint8_t*)ref);
+}
+
+// A reference at "ref" to "target" within the frozen block, or 0 for NULL
+F_NONNULLX(1)
+static ltree_ref_t fnode_ref(const ltree_ref_t* ref, const void* target) {
+    dmn_assert(ref);
+    return target ? (ltree_ref_t)((const uint8_t*)target - (const uint8_t*)ref) : 0;
+}
+
+// The rrset bodies to be interned with zones_intern (see ltree.h), which
+//  are built in one buffer and then all interned at once, so that a zone
+//  only takes the intern table's lock once.
+typedef struct {
+    size_t offset;    // within "buf"
+    unsigned len;
+    ltree_ref_t* ref; // the rrset's body reference
+} freeze_ibody_t;
+
+typedef struct {
+    uint8_t* buf;
+    size_t bytes;
+    size_t alloc;
+    freeze_ibody_t* bodies;
+    unsigned count;
+    unsigned alloc_bodies;
+} freeze_intern_t;
+
+// Reserves "len" zeroed bytes in "fi" for a body to be interned and
+//  referenced from "ref", valid until the next call
+F_NONNULL
+static uint8_t* fintern_add(freeze_intern_t* fi, ltree_ref_t* ref, const unsigned len) {
+    dmn_assert(fi); dmn_assert(ref);
+
+    const size_t offset = (fi->bytes + 7U) & ~((size_t)7U);
+    if(offset + len > fi->alloc) {
+        fi->alloc = (offset + len) << 1U;
+        fi->buf = realloc(fi->buf, fi->alloc);
+    }
+    memset(fi->buf + offset, 0, len);
+    fi->bytes = offset + len;
+
+    if(fi->count == fi->alloc_bodies) {
+        fi->alloc_bodies = fi->alloc_bodies ? fi->alloc_bodies << 1U : 8U;
+        fi->bodies = realloc(fi->bodies, fi->alloc_bodies * sizeof(*fi->bodies));
+    }
+    freeze_ibody_t* ib = &fi->bodies[fi->count++];
+    ib->offset = offset;
+    ib->len = len;
+    ib->ref = ref;
+    return fi->buf + offset;
+}
+
+// Interns all of the bodies in "fi" and sets their references to the
+//  handles, then frees "fi"'s storage
+F_NONNULL
+static void fintern_finish(freeze_intern_t* fi) {
+    dmn_assert(fi);
+
+    if(fi->count) {
+        lti_obj_t* objs = malloc(fi->count * sizeof(*objs));
+        for(unsigned i = 0; i < fi->count; i++) {
+            objs[i].data = fi->buf + fi->bodies[i].offset;
+            objs[i].len = fi->bodies[i].len;
+        }
+        lti_intern(objs, fi->count);
+        for(unsigned i = 0; i < fi->count; i++)
+            *fi->bodies[i].ref = -(ltree_ref_t)objs[i].handle;
+        free(objs);
+    }
+
+    free(fi->bodies);
+    free(fi->buf);
+}
+
+// Smallest power-of-two slot count (as a mask) keeping
+//  the load factor below 2/3, zero for no children.
+F_CONST
+static uint32_t fnode_slot_mask(const unsigned num_child) {
+    return num_child ? count2mask(num_child + (num_child >> 1)) : 0;
+}
+
+// Offset of a frozen node's rrsets from the node
+F_CONST
+static size_t fnode_rrsets_offset(const unsigned label_len, const unsigned num_rrsets, const uint32_t slot_mask) {
+    size_t size = LTREE_FNODE_SLOTS_OFFSET(label_len, num_rrsets);
+    if(slot_mask)
+        size += (slot_mask + 1U) * sizeof(ltree_fslot_t);
+    return FNODE_ALIGN8(size);
+}
+
+// The IPv4 addresses of a mutable address rrset, see ltree.h
+F_NONNULL F_PURE
+static const uint32_t* ltree_addr_v4(const ltree_rrset_addr_t* rrset) {
+    dmn_assert(rrset);
+    return (!rrset->count_v6 && rrset->gen.count <= LTREE_V4A_SIZE)
+        ? rrset->v4a
+        : rrset->addrs.v4;
+}
+
+// Whether frozen rrsets of a type have a body, see ltree.h
+F_CONST
+static bool fnode_has_body(const unsigned rrtype) {
+    return rrtype != DNS_TYPE_A && rrtype != DNS_TYPE_CNAME && rrtype != DNS_TYPE_DYNC;
+}
+
+// Whether the body of a mutable rrset at the node with breadth-first
+//  index "ent_idx" is to be interned: with zones_intern, those of the
+//  zone apex (where rrsets identical across zones are to be found)
+//  are, unless they hold "ad" references into the zone.
+F_NONNULL F_PURE
+static bool fnode_interns(const ltree_rrset_t* rrset, const unsigned ent_idx) {
+    dmn_assert(rrset);
+
+    if(!gconfig.zones_intern || ent_idx || !fnode_has_body(rrset->gen.type))
+        return false;
+
+    const unsigned count = rrset->gen.count;
+    switch(rrset->gen.type) {
+        case DNS_TYPE_NS:
+            for(unsigned i = 0; i < count; i++)
+                if(rrset->ns.rdata[i].ad)
+                    return false;
+            break;
+        case DNS_TYPE_MX:
+            for(unsigned i = 0; i < count; i++)
+                if(rrset->mx.rdata[i].ad)
+                    return false;
+            break;
+        case DNS_TYPE_SRV:
+            for(unsigned i = 0; i < count; i++)
+                if(rrset->srv.rdata[i].ad)
+                    return false;
+            break;
+        case DNS_TYPE_NAPTR:
+            for(unsigned i = 0; i < count; i++)
+                if(rrset->naptr.rdata[i].ad)
+                    return false;
+            break;
+        default:
+            break;
+    }
+
+    return true;
+}
+
+// Size of the body of a mutable rrset with one (see ltree.h), other
+//  than the data it refers to.  That data (dnames and strings) is
+//  accounted for in "fd" unless it's NULL, and its total size is added
+//  to *data_bytes.
+F_NONNULLX(1, 3)
+static size_t fbody_size(const ltree_rrset_t* rrset, freeze_data_t* fd, size_t* data_bytes) {
+    dmn_assert(rrset); dmn_assert(data_bytes);
+
+#   define BODY_DATA(_data, _len) do {\
+        if(_data) {\
+            if(fd)\
+                fdata_add(fd, (_data), (_len));\
+            *data_bytes += (_len);\
+        }\
+    } while(0)
+#   define BODY_STR(_str) BODY_DATA((_str), (_str) ? *(_str) + 1U : 0)
+
+    const unsigned count = rrset->gen.count;
+
+    switch(rrset->gen.type) {
+        case DNS_TYPE_SOA:
+            BODY_STR(rrset->soa.email);
+            BODY_STR(rrset->soa.master);
+            return sizeof(ltree_frdata_soa_t);
+        case DNS_TYPE_NS:
+            for(unsigned i = 0; i < count; i++)
+                BODY_STR(rrset->ns.rdata[i].dname);
+            return count * sizeof(ltree_frdata_ns_t);
+        case DNS_TYPE_PTR:
+            for(unsigned i = 0; i < count; i++)
+                BODY_STR(rrset->ptr.rdata[i].dname);
+            return count * sizeof(ltree_frdata_ptr_t);
+        case DNS_TYPE_MX:
+            for(unsigned i = 0; i < count; i++)
+                BODY_STR(rrset->mx.rdata[i].dname);
+            return count * sizeof(ltree_frdata_mx_t);
+        case DNS_TYPE_SRV:
+            for(unsigned i = 0; i < count; i++)
+                BODY_STR(rrset->srv.rdata[i].dname);
+            return count * sizeof(ltree_frdata_srv_t);
+        case DNS_TYPE_NAPTR:
+            for(unsigned i = 0; i < count; i++) {
+                const ltree_rdata_naptr_t* rd = &rrset->naptr.rdata[i];
+                BODY_STR(rd->dname);
+                for(unsigned j = 0; j < 3; j++)
+                    BODY_STR(rd->texts[j]);
+            }
+            return count * sizeof(ltree_frdata_naptr_t);
+        case DNS_TYPE_TXT: {
+            // the record references, then their string lists
+            size_t size = count * sizeof(ltree_ref_t);
+            for(unsigned i = 0; i < count; i++) {
+                unsigned num_texts = 0;
+                for(const uint8_t* t; (t = rrset->txt.rdata[i][num_texts]); num_texts++)
+                    BODY_STR(t);
+                size += (num_texts + 1U) * sizeof(ltree_ref_t);
+            }
+            return size;
+        }
+        default:
+            dmn_assert(fnode_has_body(rrset->gen.type));
+            for(unsigned i = 0; i < count; i++)
+                BODY_DATA(rrset->rfc3597.rdata[i].rd, rrset->rfc3597.rdata[i].rdlen);
+            return count * sizeof(ltree_frdata_rfc3597_t);
+    }
+
+#   undef BODY_STR
+#   undef BODY_DATA
+}
+
+// Sizes of the frozen form of a mutable rrset: returns the size of the
+//  rrset itself (including its body if inline, per "interned"), adds
+//  the size of its CNAME chain to *aux_bytes, and its dnames and strings
+//  (unless interned) to "fd".  Also adds the size of the mutable rrset
+//  and its rdata to *old_bytes.
+F_NONNULL
+static size_t fnode_size_rrset(freeze_data_t* fd, const ltree_rrset_t* rrset, const bool interned, size_t* aux_bytes, size_t* old_bytes) {
+    dmn_assert(fd); dmn_assert(rrset); dmn_assert(aux_bytes); dmn_assert(old_bytes);
+
+    const unsigned count = rrset->gen.count;
+
+    switch(rrset->gen.type) {
+        case DNS_TYPE_A:
+            *old_bytes += sizeof(ltree_rrset_addr_t);
+            if(!rrset->addr.count_v6 && !count)
+                return sizeof(ltree_frrset_addr_t);
+            if(ltree_addr_v4(&rrset->addr) != rrset->addr.v4a)
+                *old_bytes += (count * sizeof(uint32_t)) + (rrset->addr.count_v6 * 16U);
+            return offsetof(ltree_frrset_addr_t, addrs)
+                + (count * sizeof(uint32_t)) + (rrset->addr.count_v6 * 16U);
+        case DNS_TYPE_CNAME:
+            *old_bytes += sizeof(ltree_rrset_cname_t);
+            fdata_add(fd, rrset->cname.dname, *rrset->cname.dname + 1U);
+            if(rrset->cname.chain) {
+                *old_bytes += sizeof(ltree_cname_chain_t) + (rrset->cname.chain->len * sizeof(ltree_rrset_cname_t*));
+                *aux_bytes += sizeof(ltree_fcname_chain_t) + (rrset->cname.chain->len * sizeof(ltree_ref_t));
+            }
+            return sizeof(ltree_frrset_cname_t);
+        case DNS_TYPE_DYNC:
+            *old_bytes += sizeof(ltree_rrset_dync_t);
+            fdata_add(fd, rrset->dync.origin, *rrset->dync.origin + 1U);
+            return sizeof(ltree_frrset_dync_t);
+        case DNS_TYPE_SOA:
+            *old_bytes += sizeof(ltree_rrset_soa_t);
+            break;
+        case DNS_TYPE_NS:
+            *old_bytes += sizeof(ltree_rrset_ns_t) + (count * sizeof(ltree_rdata_ns_t));
+            break;
+        case DNS_TYPE_PTR:
+            *old_bytes += sizeof(ltree_rrset_ptr_t) + (count * sizeof(ltree_rdata_ptr_t));
+            break;
+        case DNS_TYPE_MX:
+            *old_bytes += sizeof(ltree_rrset_mx_t) + (count * sizeof(ltree_rdata_mx_t));
+            break;
+        case DNS_TYPE_SRV:
+            *old_bytes += sizeof(ltree_rrset_srv_t) + (count * sizeof(ltree_rdata_srv_t));
+            break;
+        case DNS_TYPE_NAPTR:
+            *old_bytes += sizeof(ltree_rrset_naptr_t) + (count * sizeof(ltree_rdata_naptr_t));
+            break;
+        case DNS_TYPE_TXT:
+            *old_bytes += sizeof(ltree_rrset_txt_t) + (count * sizeof(ltree_rdata_txt_t));
+            for(unsigned i = 0; i < count; i++) {
+                unsigned num_texts = 0;
+                while(rrset->txt.rdata[i][num_texts])
+                    num_texts++;
+                *old_bytes += (num_texts + 1U) * sizeof(uint8_t*);
+            }
+            break;
+        default:
+            *old_bytes += sizeof(ltree_rrset_rfc3597_t) + (count * sizeof(ltree_rdata_rfc3597_t));
+            break;
+    }
+
+    if(interned)
+        return sizeof(ltree_frrset_body_t);
+    size_t data_bytes = 0;
+    return sizeof(ltree_frrset_body_t) + fbody_size(rrset, fd, &data_bytes);
+}
+
+// The frozen copy of a mutable rrset, which ltree_freeze() stores in the
+//  original's gen.next once all of the copies have been placed
+#define FNODE_COPY(_rrset) ((uint8_t*)(_rrset)->gen.next)
+
+// The "ad" reference at "ref" for a mutable "ad" pointer
+F_NONNULLX(1)
+static ltree_ref_t fnode_ad_ref(const ltree_ref_t* ref, const ltree_rrset_addr_t* ad) {
+    dmn_assert(ref);
+    if(!ad)
+        return 0;
+    const ltree_ref_t rv = fnode_ref(ref, FNODE_COPY(AD_GET_PTR(ad)));
+    dmn_assert(!(rv & 1));
+    return AD_IS_GLUE(ad) ? (rv | 1) : rv;
+}
+
+// Where the data referred to by a body goes as it's written: to the
+//  zone's data area per "fd", or if that's NULL (for a body to be
+//  interned), appended to the body itself at "tail".
+typedef struct {
+    const freeze_data_t* fd;
+    uint8_t* tail;
+} fbody_out_t;
+
+// A reference at "ref" within a body to the "len" bytes at "data", or 0
+//  for NULL
+F_NONNULLX(1, 2)
+static ltree_ref_t fbody_dref(fbody_out_t* out, const ltree_ref_t* ref, const uint8_t* data, const unsigned len) {
+    dmn_assert(out); dmn_assert(ref);
+    if(out->fd)
+        return fdata_ref(out->fd, ref, data);
+    if(!data)
+        return 0;
+    dmn_assert(out->tail);
+    memcpy(out->tail, data, len);
+    const ltree_ref_t rv = (ltree_ref_t)(out->tail - (const uint8_t*)ref);
+    out->tail += len;
+    return rv;
+}
+
+// Writes the body of "rrset" at "body", sized per fbody_size()
+F_NONNULL
+static void fbody_write(fbody_out_t* out, const ltree_rrset_t* rrset, uint8_t* body) {
+    dmn_assert(out); dmn_assert(rrset); dmn_assert(body);
+
+#   define BREF(_field, _data, _len) ((_field) = fbody_dref(out, &(_field), (_data), (_len)))
+#   define BSTR(_field, _str) BREF(_field, (_str), (_str) ? *(_str) + 1U : 0)
+
+    const unsigned count = rrset->gen.count;
+
+    switch(rrset->gen.type) {
+        case DNS_TYPE_SOA: {
+            ltree_frdata_soa_t* frd = (ltree_frdata_soa_t*)body;
+            BSTR(frd->email, rrset->soa.email);
+            BSTR(frd->master, rrset->soa.master);
+            memcpy(frd->times, rrset->soa.times, sizeof(frd->times));
+            frd->neg_ttl = rrset->soa.neg_ttl;
+            break;
+        }
+        case DNS_TYPE_NS: {
+            ltree_frdata_ns_t* frd = (ltree_frdata_ns_t*)body;
+            for(unsigned i = 0; i < count; i++) {
+                BSTR(frd[i].dname, rrset->ns.rdata[i].dname);
+                frd[i].ad = fnode_ad_ref(&frd[i].ad, rrset->ns.rdata[i].ad);
+            }
+            break;
+        }
+        case DNS_TYPE_PTR: {
+            ltree_frdata_ptr_t* frd = (ltree_frdata_ptr_t*)body;
+            for(unsigned i = 0; i < count; i++)
+                BSTR(frd[i].dname, rrset->ptr.rdata[i].dname);
+            break;
+        }
+        case DNS_TYPE_MX: {
+            ltree_frdata_mx_t* frd = (ltree_frdata_mx_t*)body;
+            for(unsigned i = 0; i < count; i++) {
+                BSTR(frd[i].dname, rrset->mx.rdata[i].dname);
+                frd[i].ad = fnode_ad_ref(&frd[i].ad, rrset->mx.rdata[i].ad);
+                frd[i].pref = rrset->mx.rdata[i].pref;
+            }
+            break;
+        }
+        case DNS_TYPE_SRV: {
+            ltree_frdata_srv_t* frd = (ltree_frdata_srv_t*)body;
+            for(unsigned i = 0; i < count; i++) {
+                const ltree_rdata_srv_t* rd = &rrset->srv.rdata[i];
+                BSTR(frd[i].dname, rd->dname);
+                frd[i].ad = fnode_ad_ref(&frd[i].ad, rd->ad);
+                frd[i].priority = rd->priority;
+                frd[i].weight = rd->weight;
+                frd[i].port = rd->port;
+            }
+            break;
+        }
+        case DNS_TYPE_NAPTR: {
+            ltree_frdata_naptr_t* frd = (ltree_frdata_naptr_t*)body;
+            for(unsigned i = 0; i < count; i++) {
+                const ltree_rdata_naptr_t* rd = &rrset->naptr.rdata[i];
+                BSTR(frd[i].dname, rd->dname);
+                frd[i].ad = fnode_ad_ref(&frd[i].ad, rd->ad);
+                for(unsigned j = 0; j < 3; j++)
+                    BSTR(frd[i].texts[j], rd->texts[j]);
+                frd[i].order = rd->order;
+                frd[i].pref = rd->pref;
+            }
+            break;
+        }
+        case DNS_TYPE_TXT: {
+            ltree_ref_t* frd = (ltree_ref_t*)body;
+            ltree_ref_t* ftexts = &frd[count];
+            for(unsigned i = 0; i < count; i++) {
+                frd[i] = fnode_ref(&frd[i], ftexts);
+                unsigned j = 0;
+                for(const uint8_t* t; (t = rrset->txt.rdata[i][j]); j++)
+                    BSTR(ftexts[j], t);
+                ftexts[j] = 0;
+                ftexts += j + 1U;
+            }
+            break;
+        }
+        default: {
+            ltree_frdata_rfc3597_t* frd = (ltree_frdata_rfc3597_t*)body;
+            for(unsigned i = 0; i < count; i++) {
+                BREF(frd[i].rd, rrset->rfc3597.rdata[i].rd, rrset->rfc3597.rdata[i].rdlen);
+                frd[i].rdlen = rrset->rfc3597.rdata[i].rdlen;
+            }
+            break;
+        }
+    }
+
+#   undef BSTR
+#   undef BREF
+}
+
+// Writes the frozen form of "rrset" at its copy address, with "next" as
+//  the next rrset of the node (or NULL).  CNAME chains are carved from
+//  *aux, and "ents" maps their targets.  If "fi" isn't NULL, the body
+//  is added to it to be interned rather than written inline.
+F_NONNULLX(1, 2, 4, 5, 6)
+static void fnode_write_rrset(const freeze_data_t* fd, const ltree_rrset_t* rrset, const void* next, uint8_t** aux, const freeze_ent_t* ents, uint8_t* block, freeze_intern_t* fi) {
+    dmn_assert(fd); dmn_assert(rrset); dmn_assert(aux); dmn_assert(ents); dmn_assert(block);
+
+    ltree_frrset_t* copy = (ltree_frrset_t*)FNODE_COPY(rrset);
+    const unsigned count = rrset->gen.count;
+    copy->gen.next = fnode_ref(&copy->gen.next, next);
+    copy->gen.ttl = rrset->gen.ttl;
+    copy->gen.type = rrset->gen.type;
+    copy->gen.count = count;
+
+    switch(rrset->gen.type) {
+        case DNS_TYPE_A: {
+            const ltree_rrset_addr_t* a = &rrset->addr;
+            ltree_frrset_addr_t* fa = &copy->addr;
+            fa->count_v6 = a->count_v6;
+            fa->limit_v4 = a->limit_v4;
+            fa->limit_v6 = a->limit_v6;
+            if(!count && !a->count_v6) {
+                fa->dyn.func = a->dyn.func;
+                fa->dyn.resource = a->dyn.resource;
+                fa->dyn.ttl_min = a->dyn.ttl_min;
+            }
+            else {
+                if(count)
+                    memcpy(fa->addrs, ltree_addr_v4(a), count * sizeof(uint32_t));
+                if(a->count_v6)
+                    memcpy(&fa->addrs[count], a->addrs.v6, a->count_v6 * 16U);
+            }
+            break;
+        }
+        case DNS_TYPE_CNAME: {
+            copy->cname.dname = fdata_ref(fd, &copy->cname.dname, rrset->cname.dname);
+            const ltree_cname_chain_t* chain = rrset->cname.chain;
+            if(chain) {
+                ltree_fcname_chain_t* fchain = (ltree_fcname_chain_t*)*aux;
+                *aux += sizeof(ltree_fcname_chain_t) + (chain->len * sizeof(ltree_ref_t));
+                // see the use of child_hash_mask in ltree_freeze()
+                fchain->fnode = fnode_ref(&fchain->fnode,
+                    chain->node ? block + ents[chain->node->child_hash_mask].offset : NULL);
+                fchain->len = chain->len;
+                fchain->noauth = chain->noauth;
+                for(unsigned i = 0; i < chain->len; i++)
+                    fchain->hops[i] = fnode_ref(&fchain->hops[i], FNODE_COPY(chain->hops[i]));
+                copy->cname.chain = fnode_ref(&copy->cname.chain, fchain);
+            }
+            break;
+        }
+        case DNS_TYPE_DYNC:
+            copy->dync.origin = fdata_ref(fd, &copy->dync.origin, rrset->dync.origin);
+            copy->dync.func = rrset->dync.func;
+            copy->dync.resource = rrset->dync.resource;
+            copy->dync.ttl_min = rrset->dync.ttl_min;
+            copy->dync.limit_v4 = rrset->dync.limit_v4;
+            copy->dync.limit_v6 = rrset->dync.limit_v6;
+            break;
+        default: {
+            ltree_ref_t* bref = &copy->body.body;
+            if(fi) {
+                size_t data_bytes = 0;
+                const size_t size = fbody_size(rrset, NULL, &data_bytes);
+                uint8_t* body = fintern_add(fi, bref, (unsigned)(size + data_bytes));
+                fbody_out_t out = { NULL, body + size };
+                fbody_write(&out, rrset, body);
+            }
+            else {
+                uint8_t* body = (uint8_t*)copy + sizeof(ltree_frrset_body_t);
+                *bref = fnode_ref(bref, body);
+                fbody_out_t out = { fd, NULL };
+                fbody_write(&out, rrset, body);
+            }
+            break;
+        }
+    }
+}
+
+// qsort() comparator for the rrset directory order, see ltree.h
+F_NONNULL F_PURE
+static int fnode_dir_cmp(const void* a, const void* b) {
+    dmn_assert(a); dmn_assert(b);
+    const unsigned type_a = (*(const ltree_frrset_t* const*)a)->gen.type;
+    const unsigned type_b = (*(const ltree_frrset_t* const*)b)->gen.type;
+    const uint32_t bit_a = ltree_type_bit(type_a);
+    const uint32_t bit_b = ltree_type_bit(type_b);
+    if(bit_a != bit_b)
+        return bit_a < bit_b ? -1 : 1;
+    return (int)type_a - (int)type_b;
+}
+
+// Nodes which fit within a cache line are bumped to the
+//  start of the next one rather than straddling two.
+F_CONST
+static size_t fnode_place(size_t offset, const size_t size) {
+    const size_t cl_mask = LTREE_CACHE_LINE - 1U;
+    if(size <= LTREE_CACHE_LINE && (offset & ~cl_mask) != ((offset + size - 1U) & ~cl_mask))
+        offset = (offset + cl_mask) & ~cl_mask;
+    return offset;
+}
+
+// Bytes of "dn" before the template placeholder origin, or zero if
+//  it doesn't fall under the placeholder.
+F_NONNULL F_PURE
+static unsigned tmpl_prefix_len(const uint8_t* dn) {
+    dmn_assert(dn);
+    return dname_isinzone(ZONE_TMPL_ORIGIN, dn) ? (unsigned)(*dn - *ZONE_TMPL_ORIGIN) : 0;
+}
+
+// Longest template-relative prefix among the RHS dnames of an rrset,
+//  which bounds the names that can attach to a template zone
+F_NONNULL F_PURE
+static unsigned fnode_tmpl_rhs_max(const ltree_rrset_t* rrset) {
+    dmn_assert(rrset);
+
+    unsigned rv = 0;
+
+#   define RHS_MAX(_dn) do {\
+        const unsigned _plen = tmpl_prefix_len(_dn);\
+        if(_plen > rv)\
+            rv = _plen;\
+    } while(0)
+
+    switch(rrset->gen.type) {
+        case DNS_TYPE_NS:
+            for(unsigned i = 0; i < rrset->gen.count; i++)
+                RHS_MAX(rrset->ns.rdata[i].dname);
+            break;
+        case DNS_TYPE_PTR:
+            for(unsigned i = 0; i < rrset->gen.count; i++)
+                RHS_MAX(rrset->ptr.rdata[i].dname);
+            break;
+        case DNS_TYPE_MX:
+            for(unsigned i = 0; i < rrset->gen.count; i++)
+                RHS_MAX(rrset->mx.rdata[i].dname);
+            break;
+        case DNS_TYPE_SRV:
+            for(unsigned i = 0; i < rrset->gen.count; i++)
+                RHS_MAX(rrset->srv.rdata[i].dname);
+            break;
+        case DNS_TYPE_NAPTR:
+            for(unsigned i = 0; i < rrset->gen.count; i++)
+                RHS_MAX(rrset->naptr.rdata[i].dname);
+            break;
+        case DNS_TYPE_CNAME:
+            RHS_MAX(rrset->cname.dname);
+            break;
+        case DNS_TYPE_SOA:
+            RHS_MAX(rrset->soa.master);
+            RHS_MAX(rrset->soa.email);
+            break;
+        case DNS_TYPE_DYNC:
+            RHS_MAX(rrset->dync.origin);
+            break;
+        default:
+            break;
+    }
+
+#   undef RHS_MAX
+
+    return rv;
+}
+
+// Builds zone->nindex from the breadth-first entries of ltree_freeze(),
+//  which must still have the mutable nodes and their frozen offsets.
+F_NONNULL
+static void ltree_build_nindex(zone_t* zone, const freeze_ent_t* ents, const unsigned num_ents) {
+    dmn_assert(zone); dmn_assert(ents); dmn_assert(!zone->nindex);
+
+    unsigned num_names = 0;
+    size_t names_bytes = 0;
+    for(unsigned i = 0; i < num_ents; i++) {
+        if(ents[i].indexed) {
+            num_names++;
+            names_bytes += ents[i].dname_len + 1U;
+        }
+    }
+
+    const uint32_t mask = count2mask(num_names + (num_names >> 1));
+    const size_t names_start = sizeof(ltree_nindex_t) + (mask + 1U) * sizeof(ltree_nslot_t);
+    if(unlikely(names_start + names_bytes > UINT32_MAX)) {
+        log_warn("Zone '%s': too large for a full-name index, lookups will use the tree search only", logf_dname(zone->dname));
+        return;
+    }
+
+    ltree_nindex_t* nindex = lta_block(zone->arena, names_start + names_bytes);
+    nindex->mask = mask;
+    size_t name_off = names_start;
+
+    for(unsigned i = 0; i < num_ents; i++) {
+        if(!ents[i].indexed)
+            continue;
+
+        // Reconstruct the relative name by walking up the parents
+        uint8_t* name = (uint8_t*)nindex + name_off;
+        unsigned pos = 1;
+        for(unsigned j = i; j; j = ents[j].parent) {
+            const uint8_t* label = ents[j].node->label;
+            memcpy(&name[pos], label, *label + 1U);
+            pos += *label + 1U;
+        }
+        name[pos] = 0;
+        name[0] = ents[i].dname_len;
+        dmn_assert(pos == ents[i].dname_len);
+
+        const uint32_t hash = gdnsd_dname_hash(name);
+        uint32_t slot = hash & mask;
+        while(nindex->slots[slot].name)
+            slot = (slot + 1) & mask;
+        nindex->slots[slot].hash = hash;
+        nindex->slots[slot].node = (uint32_t)ents[i].offset;
+        nindex->slots[slot].name = (uint32_t)name_off;
+        name_off += ents[i].dname_len + 1U;
+    }
+
+    zone->nindex = nindex;
+
+    log_debug("Zone '%s': full-name index of %u names uses %u bytes",
+        logf_dname(zone->dname), num_names, (unsigned)(names_start + names_bytes));
+}
+
+// Frees a mutable rrset and its rdata (but not the arena data they
+//  refer to)
+F_NONNULL
+static void ltree_rrset_free(ltree_rrset_t* rrset) {
+    dmn_assert(rrset);
+
+    switch(rrset->gen.type) {
+        case DNS_TYPE_A:
+            if(ltree_addr_v4(&rrset->addr) != rrset->addr.v4a) {
+                free(rrset->addr.addrs.v4);
+                free(rrset->addr.addrs.v6);
+            }
+            break;
+        case DNS_TYPE_NAPTR:
+            free(rrset->naptr.rdata);
+            break;
+        case DNS_TYPE_TXT:
+            for(unsigned i = 0; i < rrset->gen.count; i++)
+                free(rrset->txt.rdata[i]);
+            free(rrset->txt.rdata);
+            break;
+        case DNS_TYPE_NS:
+            free(rrset->ns.rdata);
+            break;
+        case DNS_TYPE_MX:
+            free(rrset->mx.rdata);
+            break;
+        case DNS_TYPE_PTR:
+            free(rrset->ptr.rdata);
+            break;
+        case DNS_TYPE_SRV:
+            free(rrset->srv.rdata);
+            break;
+        case DNS_TYPE_CNAME:
+            free(rrset->cname.chain);
+            break;
+        case DNS_TYPE_SOA:
+        case DNS_TYPE_DYNC:
+            break;
+        default:
+            free(rrset->rfc3597.rdata);
+            break;
+    }
+
+    free(rrset);
+}
+
+// Rewrites the post-processed mutable tree at zone->root into the frozen
+//  form at zone->froot, copying everything the runtime needs (including
+//  the dnames and strings, save for interned bodies) into the frozen
+//  block, and then frees the mutable tree and the arena's string pools.
+F_WUNUSED F_NONNULL
+static bool ltree_freeze(zone_t* zone) {
+    dmn_assert(zone); dmn_assert(zone->root); dmn_assert(!zone->froot);
+
+    unsigned num_ents = 1;
+    unsigned alloc_ents = 64;
+    freeze_ent_t* ents = malloc(alloc_ents * sizeof(freeze_ent_t));
+    ents[0].node = zone->root;
+    ents[0].parent = 0;
+    ents[0].dname_len = 1;
+    ents[0].indexed = true;
+    unsigned total_rrsets = 0;
+    size_t old_bytes = 0;
+    size_t aux_bytes = 0;
+
+    freeze_data_t fd;
+    fd.mask = 255U;
+    fd.keys = calloc(fd.mask + 1U, sizeof(*fd.keys));
+    fd.slots = malloc((fd.mask + 1U) * sizeof(*fd.slots));
+    fd.count = 0;
+    fd.bytes = 0;
+    fd.base = NULL;
+
+    // Breadth-first enumeration, sizing the old form as we go
+    for(unsigned i = 0; i < num_ents; i++) {
+        const ltree_node_t* node = ents[i].node;
+        old_bytes += sizeof(ltree_node_t);
+        if(node->label)
+            old_bytes += *node->label + 1U;
+        ents[i].first_rrset = total_rrsets;
+        ents[i].num_rrsets = 0;
+        ents[i].rrsets_bytes = 0;
+        for(const ltree_rrset_t* rrset = node->rrsets; rrset; rrset = rrset->gen.next) {
+            ents[i].rrsets_bytes = FNODE_ALIGNP(ents[i].rrsets_bytes)
+                + fnode_size_rrset(&fd, rrset, fnode_interns(rrset, i), &aux_bytes, &old_bytes);
+            ents[i].num_rrsets++;
+        }
+        total_rrsets += ents[i].num_rrsets;
+        ents[i].first_child = num_ents;
+        if(node->child_table) {
+            old_bytes += (node->child_hash_mask + 1U) * sizeof(ltree_node_t*);
+            for(uint32_t j = 0; j <= node->child_hash_mask; j++) {
+                ltree_node_t* child = node->child_table[j];
+                while(child) {
+                    if(num_ents == alloc_ents) {
+                        alloc_ents <<= 1U;
+                        ents = realloc(ents, alloc_ents * sizeof(freeze_ent_t));
+                    }
+                    freeze_ent_t* cent = &ents[num_ents++];
+                    cent->node = child;
+                    cent->parent = i;
+                    cent->dname_len = ents[i].dname_len + *child->label + 1U;
+                    cent->indexed = ents[i].indexed
+                        && !(child->flags & LTNFLAG_DELEG)
+                        && (i || *child->label); // not the ooz glue node
+                    child = child->next;
+                }
+            }
+        }
+        ents[i].num_child = num_ents - ents[i].first_child;
+    }
+    old_bytes += fd.bytes;
+
+    // Assign offsets: the nodes, then the aux area, then the data
+    size_t new_bytes = 0;
+    for(unsigned i = 0; i < num_ents; i++) {
+        const ltree_node_t* node = ents[i].node;
+        const size_t size = fnode_rrsets_offset(node->label ? *node->label : 0, ents[i].num_rrsets, fnode_slot_mask(ents[i].num_child))
+            + ents[i].rrsets_bytes;
+        ents[i].offset = fnode_place(FNODE_ALIGN8(new_bytes), size);
+        new_bytes = ents[i].offset + size;
+    }
+    const size_t aux_offset = FNODE_ALIGN4(new_bytes);
+    const size_t data_offset = aux_offset + aux_bytes;
+    new_bytes = data_offset + fd.bytes;
+    new_bytes = (new_bytes + LTREE_CACHE_LINE - 1U) & ~((size_t)LTREE_CACHE_LINE - 1U);
+
+    if(unlikely(new_bytes > INT32_MAX)) {
+        free(fd.slots);
+        free(fd.keys);
+        free(ents);
+        log_zfatal("Zone '%s' is too large (%u nodes)", logf_dname(zone->dname), num_ents);
+    }
+
+    uint8_t* block = lta_block(zone->arena, new_bytes);
+    fd.base = block + data_offset;
+    fdata_copy(&fd);
+
+    if(gconfig.zones_name_index)
+        ltree_build_nindex(zone, ents, num_ents);
+
+    // Place the frozen copies of the rrsets, recording them in the
+    //  gen.next of the originals (see FNODE_COPY()), which are tracked
+    //  in "old_rrsets" from here on instead of by their own lists.
+    ltree_rrset_t** old_rrsets = malloc((total_rrsets ? total_rrsets : 1U) * sizeof(ltree_rrset_t*));
+    for(unsigned i = 0; i < num_ents; i++) {
+        uint8_t* fnode = block + ents[i].offset;
+        size_t rr_off = fnode_rrsets_offset(ents[i].node->label ? *ents[i].node->label : 0, ents[i].num_rrsets, fnode_slot_mask(ents[i].num_child));
+        unsigned rr_idx = ents[i].first_rrset;
+        ltree_rrset_t* rrset = ents[i].node->rrsets;
+        while(rrset) {
+            ltree_rrset_t* next = rrset->gen.next;
+            rr_off = FNODE_ALIGNP(rr_off);
+            old_rrsets[rr_idx++] = rrset;
+            rrset->gen.next = (ltree_rrset_t*)(fnode + rr_off);
+            size_t scratch = 0; // all but the size itself was accounted for above
+            rr_off += fnode_size_rrset(&fd, rrset, fnode_interns(rrset, i), &scratch, &scratch);
+            rrset = next;
+        }
+    }
+
+    // The mutable nodes' child_hash_mask fields are no longer needed,
+    //  and are re-used to map them to their breadth-first indices
+    //  for converting the CNAME chain target pointers.
+    for(unsigned i = 0; i < num_ents; i++)
+        ents[i].node->child_hash_mask = i;
+
+    // Write the frozen nodes and rrsets
+    uint8_t* aux = block + aux_offset;
+    freeze_intern_t fi;
+    memset(&fi, 0, sizeof(fi));
+    for(unsigned i = 0; i < num_ents; i++) {
+        const ltree_node_t* node = ents[i].node;
+        ltree_fnode_t* fnode = (ltree_fnode_t*)(block + ents[i].offset);
+        fnode->flags = node->flags;
+        if(node->label)
+            memcpy(fnode->label, node->label, *node->label + 1U);
+
+        const unsigned num_rrsets = ents[i].num_rrsets;
+        const uint32_t cmask = fnode_slot_mask(ents[i].num_child);
+        fnode->num_rrsets = num_rrsets;
+        fnode->child_mask = cmask;
+
+        if(num_rrsets) {
+            ltree_rrset_t** rrsets = &old_rrsets[ents[i].first_rrset];
+            const ltree_frrset_t* sorted[num_rrsets];
+            fnode->rrsets = (uint32_t)(FNODE_COPY(rrsets[0]) - (uint8_t*)fnode);
+            for(unsigned j = 0; j < num_rrsets; j++) {
+                const uint8_t* next = (j + 1U < num_rrsets) ? FNODE_COPY(rrsets[j + 1U]) : NULL;
+                fnode_write_rrset(&fd, rrsets[j], next, &aux, ents, block,
+                    fnode_interns(rrsets[j], i) ? &fi : NULL);
+                sorted[j] = (const ltree_frrset_t*)FNODE_COPY(rrsets[j]);
+                fnode->type_bits |= ltree_type_bit(sorted[j]->gen.type);
+            }
+
+            qsort(sorted, num_rrsets, sizeof(sorted[0]), fnode_dir_cmp);
+            uint32_t* dir = (uint32_t*)((uint8_t*)fnode + LTREE_FNODE_DIR_OFFSET(fnode->label[0]));
+            for(unsigned j = 0; j < num_rrsets; j++)
+                dir[j] = (uint32_t)((const uint8_t*)sorted[j] - (uint8_t*)fnode);
+        }
+
+        if(cmask) {
+            ltree_fslot_t* slots = (ltree_fslot_t*)((uint8_t*)fnode + LTREE_FNODE_SLOTS_OFFSET(fnode->label[0], num_rrsets));
+            for(unsigned j = 0; j < ents[i].num_child; j++) {
+                const freeze_ent_t* cent = &ents[ents[i].first_child + j];
+                const uint32_t hash = label_djb_hash(cent->node->label, UINT32_MAX);
+                uint32_t slot = hash & cmask;
+                while(slots[slot].offset)
+                    slot = (slot + 1) & cmask;
+                slots[slot].hash = hash;
+                slots[slot].offset = (uint32_t)cent->offset;
+            }
+        }
+    }
+    dmn_assert(aux == block + data_offset);
+    fintern_finish(&fi);
+    free(fd.slots);
+    free(fd.keys);
+
+    const bool is_tmpl = !dname_cmp(zone->dname, ZONE_TMPL_ORIGIN);
+    for(unsigned i = 0; i < total_rrsets; i++) {
+        if(is_tmpl) {
+            const unsigned rhs_max = fnode_tmpl_rhs_max(old_rrsets[i]);
+            if(rhs_max > zone->tmpl_rhs_max)
+                zone->tmpl_rhs_max = rhs_max;
+        }
+        ltree_rrset_free(old_rrsets[i]);
+    }
+    free(old_rrsets);
+
+    for(unsigned i = 0; i < num_ents; i++) {
+        free(ents[i].node->child_table);
+        free(ents[i].node);
+    }
+    free(ents);
+
+    // Nothing refers to the labels, dnames, and strings in the arena now
+    lta_free_strings(zone->arena);
+
+    zone->root = NULL;
+    zone->froot = (ltree_fnode_t*)block;
+
+    log_debug("Zone '%s': froze %u ltree nodes and %u rrsets from %u bytes (%.1f/node) to %u bytes (%.1f/node)",
+        logf_dname(zone->dname), num_ents, total_rrsets, (unsigned)old_bytes, (double)old_bytes / num_ents,
+        (unsigned)new_bytes, (double)new_bytes / num_ents);
+
+    if(gconfig.zones_intern) {
+        uint64_t intern_bytes;
+        const unsigned intern_count = lti_stats(&intern_bytes);
+        log_debug("Interned zone data is now %u objects in %" PRIu64 " bytes", intern_count, intern_bytes);
+    }
+
+    return false;
+}
+
 // common processing for zones
 void ltree_init_zone(zone_t* zone) {
     dmn_assert(zone);
     dmn_assert(zone->dname);
     dmn_assert(zone->arena);
     dmn_assert(!zone->root);
+    dmn_assert(!zone->froot);
+
+    dmn_assert(!zone->nindex);
 
     zone->root = ltree_node_new(zone->arena, NULL, 0);
 }
@@ -1237,6 +2282,9 @@ bool ltree_postproc_zone(zone_t* zone) {
     dmn_assert(zone->arena);
     dmn_assert(zone->root);
 
+    zprof_mark_t mark;
+    zprof_mark(&mark);
+
     ltree_fix_masks(zone->root);
 
     // zroot phase1 is a readonly check of zone basics
@@ -1253,6 +2301,7 @@ bool ltree_postproc_zone(zone_t* zone) {
     //   for local CNAME targets.
     if(unlikely(ltree_postproc(zone, ltree_postproc_phase1)))
         return true;
+    zprof_add(&zone->prof, ZPROF_PHASE1, &mark);
 
     // zroot phase2 checks for unused out-of-zone glue addresses,
     //   and also does the standard address limit>count fixups on them
@@ -1263,70 +2312,23 @@ bool ltree_postproc_zone(zone_t* zone) {
     //   and delegation glue address sets that exceed max_addtl_rrsets
     if(unlikely(ltree_postproc(zone, ltree_postproc_phase2)))
         return true;
+    zprof_add(&zone->prof, ZPROF_PHASE2, &mark);
+
+    // finally, rewrite the tree into its compact runtime form
+    if(unlikely(ltree_freeze(zone)))
+        return true;
+    zprof_add(&zone->prof, ZPROF_FREEZE, &mark);
+    zone->prof.bytes = lta_size(zone->arena);
     return false;
 }
 
 void ltree_destroy(ltree_node_t* node) {
     dmn_assert(node);
+
     ltree_rrset_t* rrset = node->rrsets;
     while(rrset) {
         ltree_rrset_t* next = rrset->gen.next;
-        switch(rrset->gen.type) {
-            case DNS_TYPE_A:
-                if(rrset->addr.count_v6) {
-                    dmn_assert(rrset->addr.addrs.v6);
-                    free(rrset->addr.addrs.v6);
-                    if(rrset->addr.addrs.v4)
-                        free(rrset->addr.addrs.v4);
-                }
-                else if(rrset->gen.count && rrset->gen.count > LTREE_V4A_SIZE) {
-                    dmn_assert(!rrset->addr.addrs.v6);
-                    dmn_assert(rrset->addr.addrs.v4);
-                    free(rrset->addr.addrs.v4);
-                }
-                break;
-
-            case DNS_TYPE_NAPTR:
-                for(unsigned i = 0; i < rrset->gen.count; i++) {
-                    free(rrset->naptr.rdata[i].texts[NAPTR_TEXTS_REGEXP]);
-                    free(rrset->naptr.rdata[i].texts[NAPTR_TEXTS_SERVICES]);
-                    free(rrset->naptr.rdata[i].texts[NAPTR_TEXTS_FLAGS]);
-                }
-                free(rrset->naptr.rdata);
-                break;
-            case DNS_TYPE_TXT:
-                for(unsigned i = 0; i < rrset->gen.count; i++) {
-                    uint8_t** tptr = rrset->txt.rdata[i];
-                    uint8_t* t;
-                    while((t = *tptr++))
-                        free(t);
-                    free(rrset->txt.rdata[i]);
-                }
-                free(rrset->txt.rdata);
-                break;
-            case DNS_TYPE_NS:
-                free(rrset->ns.rdata);
-                break;
-            case DNS_TYPE_MX:
-                free(rrset->mx.rdata);
-                break;
-            case DNS_TYPE_PTR:
-                free(rrset->ptr.rdata);
-                break;
-            case DNS_TYPE_SRV:
-                free(rrset->srv.rdata);
-                break;
-            case DNS_TYPE_SOA:
-            case DNS_TYPE_CNAME:
-            case DNS_TYPE_DYNC:
-                break;
-            default:
-                for(unsigned i = 0; i < rrset->gen.count; i++)
-                   free(rrset->rfc3597.rdata[i].rd);
-                free(rrset->rfc3597.rdata);
-                break;
-        }
-        free(rrset);
+        ltree_rrset_free(rrset);
         rrset = next;
     }
 
@@ -1346,3 +2348,19 @@ void ltree_destroy(ltree_node_t* node) {
     free(node);
 }
 
+void ltree_destroy_frozen(ltree_fnode_t* froot) {
+    dmn_assert(froot);
+
+    // Everything but the interned bodies lives in the frozen block
+    //  itself, and only those of the zone apex are interned
+    const unsigned num_rrsets = froot->num_rrsets;
+    if(num_rrsets) {
+        uint32_t handles[num_rrsets];
+        unsigned num_handles = 0;
+        for(const ltree_frrset_t* rrset = ltree_fnode_rrsets(froot); rrset; rrset = ltree_frrset_next(rrset))
+            if(fnode_has_body(rrset->gen.type) && rrset->body.body < 0)
+                handles[num_handles++] = (uint32_t)-rrset->body.body;
+        if(num_handles)
+            lti_release(handles, num_handles);
+    }
+}
@@ -48,7 +48,12 @@ phases of post-processing where it walks the entire tree, doing many data
 validation checks and setting up inter-node references (such as NS->A glue,
 MX->A additionals, etc).
 
-  At runtime, the dnspacket.c code searches the ltree database directly, using
+  Once post-processing succeeds, the tree is "frozen": it's rewritten into a
+single contiguous block of compact nodes (ltree_fnode_t, below) with inline
+labels and open-addressed child tables, and the mutable nodes are freed.  The
+mutable form described here only exists while a zone is being constructed.
+
+  At runtime, the dnspacket.c code searches the frozen ltree directly, using
 its own local search function that understands the ltree structure.
 
   The child node hash tables within each node are doubled in size every time
@@ -86,15 +91,24 @@ daemon exit time).
 #define GDNSD_LTREE_H
 
 #include "config.h"
+
+#include <string.h>
+#include <stddef.h>
+
 #include "dnswire.h"
 #include "ltarena.h"
+#include "ltintern.h"
 #include "gdnsd/plugapi.h"
 
 // struct/typedef stuff
 struct _ltree_node_struct;
 typedef struct _ltree_node_struct ltree_node_t;
+struct _ltree_fnode_struct;
+typedef struct _ltree_fnode_struct ltree_fnode_t;
+struct _ltree_nindex_struct;
+typedef struct _ltree_nindex_struct ltree_nindex_t;
 
-// depends on ltree_node_t above
+// depends on ltree_node_t/ltree_fnode_t above
 #include "ztree.h"
 
 struct _ltree_rdata_ns_struct;
@@ -139,6 +153,30 @@ typedef struct _ltree_rrset_naptr_struct ltree_rrset_naptr_t;
 typedef struct _ltree_rrset_txt_struct ltree_rrset_txt_t;
 typedef struct _ltree_rrset_rfc3597_struct ltree_rrset_rfc3597_t;
 
+// The frozen equivalents of the above, see further down
+typedef struct _ltree_frdata_ns_struct ltree_frdata_ns_t;
+typedef struct _ltree_frdata_ptr_struct ltree_frdata_ptr_t;
+typedef struct _ltree_frdata_mx_struct ltree_frdata_mx_t;
+typedef struct _ltree_frdata_srv_struct ltree_frdata_srv_t;
+typedef struct _ltree_frdata_naptr_struct ltree_frdata_naptr_t;
+typedef struct _ltree_frdata_rfc3597_struct ltree_frdata_rfc3597_t;
+typedef struct _ltree_frdata_soa_struct ltree_frdata_soa_t;
+
+typedef union  _ltree_frrset_union ltree_frrset_t;
+typedef struct _ltree_frrset_gen_struct ltree_frrset_gen_t;
+typedef struct _ltree_frrset_addr_struct ltree_frrset_addr_t;
+typedef struct _ltree_frrset_soa_struct ltree_frrset_soa_t;
+typedef struct _ltree_frrset_cname_struct ltree_frrset_cname_t;
+typedef struct _ltree_frrset_dync_struct ltree_frrset_dync_t;
+typedef struct _ltree_frrset_ns_struct ltree_frrset_ns_t;
+typedef struct _ltree_frrset_ptr_struct ltree_frrset_ptr_t;
+typedef struct _ltree_frrset_mx_struct ltree_frrset_mx_t;
+typedef struct _ltree_frrset_srv_struct ltree_frrset_srv_t;
+typedef struct _ltree_frrset_naptr_struct ltree_frrset_naptr_t;
+typedef struct _ltree_frrset_txt_struct ltree_frrset_txt_t;
+typedef struct _ltree_frrset_rfc3597_struct ltree_frrset_rfc3597_t;
+typedef struct _ltree_frrset_body_struct ltree_frrset_body_t;
+
 // Used to set/get the "glue" status of the "ad" pointer
 //  in ltree_rdata_ns_t, which is stored in the LSB.
 #define AD_IS_GLUE(x) (!!(((uintptr_t)(x)) & 1UL))
@@ -237,9 +275,23 @@ struct _ltree_rrset_soa_struct {
     uint32_t neg_ttl; // cache of htons(min(ntohs(gen.ttl), ntohs(times[4])))
 };
 
+// Precomputed result of following a static CNAME chain, set by
+//   postproc on the first CNAME of the chain.  "hops" are the
+//   CNAME rrsets after the first one, and "node" is the terminal
+//   in-zone node (NULL for NXDOMAIN).  If "noauth" is set, the last
+//   CNAME points out of the zone and "node" is meaningless.
+// Chains which reach DYNC data or delegations don't get one of these.
+typedef struct {
+    const ltree_node_t* node;
+    bool noauth;
+    unsigned len;
+    const ltree_rrset_cname_t* hops[];
+} ltree_cname_chain_t;
+
 struct _ltree_rrset_cname_struct {
     ltree_rrset_gen_t gen;
     const uint8_t* dname;
+    ltree_cname_chain_t* chain; // NULL if not precomputed
 };
 
 struct _ltree_rrset_dync_struct {
@@ -330,6 +382,363 @@ struct _ltree_node_struct {
     ltree_rrset_t* rrsets;     // The list of rrsets
 };
 
+// The frozen form of the tree, which is the only form the runtime code
+//  ever sees.  After postproc, ltree_freeze() rewrites the whole tree
+//  into a single contiguous, cache-line-aligned block of variable-sized
+//  nodes, laid out breadth-first so that siblings are adjacent, and a
+//  node no larger than a cache line never straddles two of them.  Each
+//  frozen node is the header below, followed by its label stored
+//  inline (the zone root has an empty label), padded to 4 bytes, then
+//  the rrset directory, then (child_mask + 1) child slots, then the
+//  node's own rrsets (ltree_frrset_t, below) with their rdata inline.
+//  The child slots are an open-addressed table with linear probing,
+//  sized to keep the load factor below 2/3, so a probe always ends at
+//  an empty slot.  child_mask is zero for nodes without children.
+//  After all of the nodes come the CNAME chains and the lists of TXT
+//  strings, and last of all the dnames, strings, and RFC3597 rdata.
+// The only pointers in the block are the DYNA/DYNC plugin callbacks.
+//  Child slots are 32-bit byte offsets from the zone root, the rrset
+//  list head and directory are relative to the node they belong to, and
+//  every other reference is an ltree_ref_t (below), which limits a
+//  zone's frozen block to 2GB.
+#define LTREE_CACHE_LINE 64U
+
+typedef struct {
+    uint32_t hash;   // full 32-bit label_djb_hash() of the child's label
+    uint32_t offset; // byte offset of the child from the zone root, 0 == empty
+} ltree_fslot_t;
+
+// The rrset directory holds the same rrsets as the linked list, with
+//  those of the common types (the LTREE_TBIT_* below) first, in bit
+//  order, followed by any others in ascending type order.  type_bits has
+//  the bit set for every common type present (and LTREE_TBIT_OTHER for
+//  any others), so a presence test is a single bit test, and a common
+//  type's directory index is the count of lower bits set in type_bits.
+#define LTREE_TBIT_ADDR  (1U << 0) // DNS_TYPE_A, for both A and AAAA
+#define LTREE_TBIT_NS    (1U << 1)
+#define LTREE_TBIT_CNAME (1U << 2)
+#define LTREE_TBIT_SOA   (1U << 3)
+#define LTREE_TBIT_PTR   (1U << 4)
+#define LTREE_TBIT_MX    (1U << 5)
+#define LTREE_TBIT_TXT   (1U << 6)
+#define LTREE_TBIT_SRV   (1U << 7)
+#define LTREE_TBIT_NAPTR (1U << 8)
+#define LTREE_TBIT_DYNC  (1U << 9)
+#define LTREE_TBIT_OTHER (1U << 31) // anything else (RFC 3597 types)
+
+F_CONST F_UNUSED
+static inline uint32_t ltree_type_bit(const unsigned rrtype) {
+    switch(rrtype) {
+        case DNS_TYPE_A:     return LTREE_TBIT_ADDR;
+        case DNS_TYPE_NS:    return LTREE_TBIT_NS;
+        case DNS_TYPE_CNAME: return LTREE_TBIT_CNAME;
+        case DNS_TYPE_SOA:   return LTREE_TBIT_SOA;
+        case DNS_TYPE_PTR:   return LTREE_TBIT_PTR;
+        case DNS_TYPE_MX:    return LTREE_TBIT_MX;
+        case DNS_TYPE_TXT:   return LTREE_TBIT_TXT;
+        case DNS_TYPE_SRV:   return LTREE_TBIT_SRV;
+        case DNS_TYPE_NAPTR: return LTREE_TBIT_NAPTR;
+        case DNS_TYPE_DYNC:  return LTREE_TBIT_DYNC;
+        default:             return LTREE_TBIT_OTHER;
+    }
+}
+
+#ifdef HAVE_BUILTIN_POPCOUNT
+#  define ltree_popcount(_x) ((unsigned)__builtin_popcount(_x))
+#else
+F_CONST F_UNUSED
+static inline unsigned ltree_popcount(uint32_t x) {
+    x = x - ((x >> 1U) & 0x55555555U);
+    x = (x & 0x33333333U) + ((x >> 2U) & 0x33333333U);
+    return (((x + (x >> 4U)) & 0x0F0F0F0FU) * 0x01010101U) >> 24U;
+}
+#endif
+
+struct _ltree_fnode_struct {
+    uint32_t rrsets;       // offset of the rrset list head from this node, 0 == none
+    uint32_t flags;        // LTNFLAG_*
+    uint32_t child_mask;   // child slot count - 1, or zero for no children
+    uint32_t type_bits;    // LTREE_TBIT_* for the types present
+    uint32_t num_rrsets;   // rrset directory length
+    uint8_t label[];
+};
+
+// Byte offsets from the start of a frozen node to its rrset directory
+//  (of 32-bit rrset offsets from the node) and to its child slots
+#define LTREE_FNODE_DIR_OFFSET(_label_len) \
+    ((offsetof(ltree_fnode_t, label) + 1U + (_label_len) + 3U) & ~3U)
+#define LTREE_FNODE_SLOTS_OFFSET(_label_len, _num_rrsets) \
+    (LTREE_FNODE_DIR_OFFSET(_label_len) + ((_num_rrsets) * sizeof(uint32_t)))
+
+// A reference within the frozen block: the signed byte offset of its
+//  target from the reference itself, zero for NULL.
+typedef int32_t ltree_ref_t;
+
+F_UNUSED F_PURE F_WUNUSED F_NONNULL
+static inline const void* ltree_ref(const ltree_ref_t* ref) {
+    dmn_assert(ref);
+    return *ref ? (const uint8_t*)ref + *ref : NULL;
+}
+
+// As above, for the "data" references to dnames, strings, and RFC3597 rdata
+F_UNUSED F_PURE F_WUNUSED F_NONNULL
+static inline const uint8_t* ltree_dref(const ltree_ref_t* ref) {
+    return ltree_ref(ref);
+}
+
+// Frozen rrsets mirror the mutable ones above, with ltree_ref_t in place
+//  of the pointers.  They're pointer-aligned within the block.  Except
+//  for addresses, CNAME, and DYNC, the rdata of an rrset is a separate
+//  "body" (an array of ltree_frdata_*_t for gen.count records, or the
+//  ltree_frdata_soa_t) referred to by the "body" field after its header.
+//  Normally this is a positive reference to the body inline in the
+//  frozen block, right after the rrset.  With zones_intern, the bodies
+//  of the rrsets at the zone apex are instead interned process-wide,
+//  and the reference is the negated lti_intern() handle of the body.
+// Other than "ad" references (whose bodies are never interned), the
+//  references within a body are all relative, and interned bodies
+//  carry their own copies of the data they refer to.
+F_UNUSED F_PURE F_WUNUSED F_NONNULL
+static inline const void* ltree_fbody(const ltree_ref_t* body) {
+    dmn_assert(body); dmn_assert(*body);
+    const ltree_ref_t r = *body;
+    if(r < 0)
+        return lti_handle_ptr((uint32_t)-r);
+    return (const uint8_t*)body + r;
+}
+
+// The "ad" reference of NS/MX/SRV/NAPTR rdata is to an address rrset,
+//  and (rdata fields and rrsets both being at least 4-byte aligned) its
+//  LSB is free for the glue flag, as with AD_SET_GLUE() above.
+#define LTREE_AD_IS_GLUE(_ad) (!!((_ad) & 1))
+
+struct _ltree_frdata_ns_struct {
+    ltree_ref_t dname;
+    ltree_ref_t ad;
+};
+
+struct _ltree_frdata_ptr_struct {
+    ltree_ref_t dname;
+};
+
+struct _ltree_frdata_mx_struct {
+    ltree_ref_t dname;
+    ltree_ref_t ad;
+    uint16_t pref; // net-order
+};
+
+struct _ltree_frdata_srv_struct {
+    ltree_ref_t dname;
+    ltree_ref_t ad;
+    uint16_t priority; // net-order
+    uint16_t weight; // net-order
+    uint16_t port; // net-order
+};
+
+struct _ltree_frdata_naptr_struct {
+    ltree_ref_t dname;
+    ltree_ref_t ad;
+    ltree_ref_t texts[3]; // flags, services, regexp
+    uint16_t order; // net-order
+    uint16_t pref; // net-order
+};
+
+struct _ltree_frdata_rfc3597_struct {
+    ltree_ref_t rd;
+    uint16_t rdlen;
+};
+
+struct _ltree_frdata_soa_struct {
+    ltree_ref_t email;
+    ltree_ref_t master;
+    uint32_t times[5];
+    uint32_t neg_ttl; // cache of htons(min(ntohs(gen.ttl), ntohs(times[4])))
+};
+
+struct _ltree_frrset_gen_struct {
+    ltree_ref_t next;
+    uint32_t ttl; // net-order
+    uint16_t type; // host-order
+    uint16_t count; // host-order
+};
+
+// gen.count is the count of IPv4 addresses.  If it and count_v6 are
+//  both zero, this is a DYNA and "dyn" is valid, otherwise "addrs" holds
+//  the IPv4 addresses followed by the IPv6 ones (4 words each).
+struct _ltree_frrset_addr_struct {
+    ltree_frrset_gen_t gen;
+    uint16_t count_v6;
+    uint16_t limit_v4;
+    uint16_t limit_v6;
+    // 16 "free" bits here
+    union {
+        struct {
+            gdnsd_resolve_cb_t func;
+            unsigned resource;
+            uint32_t ttl_min; // host-order!
+        } dyn;
+        uint32_t addrs[0];
+    };
+};
+
+struct _ltree_frrset_soa_struct {
+    ltree_frrset_gen_t gen;
+    ltree_ref_t body; // to ltree_frdata_soa_t
+};
+
+// The frozen ltree_cname_chain_t
+typedef struct {
+    ltree_ref_t fnode; // terminal node, 0 for NXDOMAIN or "noauth"
+    uint16_t len;
+    bool noauth;
+    ltree_ref_t hops[0]; // to ltree_frrset_cname_t
+} ltree_fcname_chain_t;
+
+struct _ltree_frrset_cname_struct {
+    ltree_frrset_gen_t gen;
+    ltree_ref_t dname;
+    ltree_ref_t chain; // to ltree_fcname_chain_t, 0 if not precomputed
+};
+
+struct _ltree_frrset_dync_struct {
+    ltree_frrset_gen_t gen;
+    ltree_ref_t origin;
+    gdnsd_resolve_cb_t func;
+    unsigned resource;
+    uint32_t ttl_min; // host-order!
+    uint16_t limit_v4;
+    uint16_t limit_v6;
+};
+
+struct _ltree_frrset_ns_struct {
+    ltree_frrset_gen_t gen;
+    ltree_ref_t body; // to ltree_frdata_ns_t[gen.count]
+};
+
+struct _ltree_frrset_ptr_struct {
+    ltree_frrset_gen_t gen;
+    ltree_ref_t body; // to ltree_frdata_ptr_t[gen.count]
+};
+
+struct _ltree_frrset_mx_struct {
+    ltree_frrset_gen_t gen;
+    ltree_ref_t body; // to ltree_frdata_mx_t[gen.count]
+};
+
+struct _ltree_frrset_srv_struct {
+    ltree_frrset_gen_t gen;
+    ltree_ref_t body; // to ltree_frdata_srv_t[gen.count]
+};
+
+struct _ltree_frrset_naptr_struct {
+    ltree_frrset_gen_t gen;
+    ltree_ref_t body; // to ltree_frdata_naptr_t[gen.count]
+};
+
+// The body is gen.count references, each to a zero-terminated array
+//  (also in the body) of data references to the strings of a record.
+struct _ltree_frrset_txt_struct {
+    ltree_frrset_gen_t gen;
+    ltree_ref_t body; // to ltree_ref_t[gen.count]
+};
+
+struct _ltree_frrset_rfc3597_struct {
+    ltree_frrset_gen_t gen;
+    ltree_ref_t body; // to ltree_frdata_rfc3597_t[gen.count]
+};
+
+// The common form of all of the above which have a body
+struct _ltree_frrset_body_struct {
+    ltree_frrset_gen_t gen;
+    ltree_ref_t body;
+};
+
+union _ltree_frrset_union {
+    ltree_frrset_gen_t gen;
+    ltree_frrset_body_t body;
+    ltree_frrset_addr_t addr;
+    ltree_frrset_soa_t soa;
+    ltree_frrset_cname_t cname;
+    ltree_frrset_dync_t dync;
+    ltree_frrset_ns_t ns;
+    ltree_frrset_ptr_t ptr;
+    ltree_frrset_mx_t mx;
+    ltree_frrset_srv_t srv;
+    ltree_frrset_naptr_t naptr;
+    ltree_frrset_txt_t txt;
+    ltree_frrset_rfc3597_t rfc3597;
+};
+
+// The address rrset referenced by an "ad", or NULL
+F_UNUSED F_PURE F_WUNUSED F_NONNULL
+static inline const ltree_frrset_addr_t* ltree_ad(const ltree_ref_t* ad) {
+    dmn_assert(ad);
+    const ltree_ref_t r = *ad & ~1;
+    return r ? (const ltree_frrset_addr_t*)((const uint8_t*)ad + r) : NULL;
+}
+
+// The rrset after "rrset" in its node's list, or NULL
+F_UNUSED F_PURE F_WUNUSED F_NONNULL
+static inline const ltree_frrset_t* ltree_frrset_next(const ltree_frrset_t* rrset) {
+    dmn_assert(rrset);
+    return ltree_ref(&rrset->gen.next);
+}
+
+// The head of the rrset list of a frozen node, NULL if it has none
+F_UNUSED F_PURE F_WUNUSED F_NONNULL
+static inline const ltree_frrset_t* ltree_fnode_rrsets(const ltree_fnode_t* node) {
+    dmn_assert(node);
+    return node->rrsets
+        ? (const ltree_frrset_t*)((const uint8_t*)node + node->rrsets)
+        : NULL;
+}
+
+// Returns the rrset of type "rrtype" (DNS_TYPE_A for addresses of
+//  either family) at a frozen node, or NULL if there isn't one.
+F_UNUSED F_PURE F_WUNUSED F_NONNULL
+static inline const ltree_frrset_t* ltree_fnode_get_rrset(const ltree_fnode_t* node, const unsigned rrtype) {
+    dmn_assert(node);
+
+    const uint32_t tbits = node->type_bits;
+    const uint32_t bit = ltree_type_bit(rrtype);
+    if(!(tbits & bit))
+        return NULL;
+
+    const uint32_t* dir = (const uint32_t*)((const uint8_t*)node + LTREE_FNODE_DIR_OFFSET(node->label[0]));
+    if(bit != LTREE_TBIT_OTHER)
+        return (const ltree_frrset_t*)((const uint8_t*)node + dir[ltree_popcount(tbits & (bit - 1U))]);
+
+    for(unsigned i = ltree_popcount(tbits & ~LTREE_TBIT_OTHER); i < node->num_rrsets; i++) {
+        const ltree_frrset_t* rrset = (const ltree_frrset_t*)((const uint8_t*)node + dir[i]);
+        const unsigned dtype = rrset->gen.type;
+        if(dtype == rrtype)
+            return rrset;
+        if(dtype > rrtype)
+            break;
+    }
+
+    return NULL;
+}
+
+// The optional full-name index of a frozen tree (gconfig.zones_name_index).
+//  This maps the full name (relative to the zone, as left by
+//  gdnsd_dname_drop_zone()) of every frozen node in authoritative space
+//  to the node.  Delegation points, everything beneath them, and the
+//  out-of-zone glue are never indexed, so a hit is always an exact
+//  DNAME_AUTH match.  The slots are open-addressed with linear probing
+//  at a load factor below 2/3, and the names they point at are stored
+//  after the slots in the same allocation.
+typedef struct {
+    uint32_t hash; // gdnsd_dname_hash() of the relative name
+    uint32_t node; // byte offset of the frozen node from the zone root
+    uint32_t name; // byte offset of the relative name from the index, 0 == empty
+} ltree_nslot_t;
+
+struct _ltree_nindex_struct {
+    uint32_t mask; // slot count - 1
+    ltree_nslot_t slots[];
+};
+
 // ztree/zone code uses these to create and destroy per-zone ltrees:
 F_NONNULL
 void ltree_init_zone(zone_t* zone);
@@ -337,6 +746,10 @@ F_WUNUSED F_NONNULL
 bool ltree_postproc_zone(zone_t* zone);
 F_NONNULL
 void ltree_destroy(ltree_node_t* node);
+// Releases the interned data referenced by the frozen tree; the frozen
+//  block itself belongs to the zone's arena, and goes with lta_destroy().
+F_NONNULL
+void ltree_destroy_frozen(ltree_fnode_t* froot);
 
 // Adding data to the ltree (called from parser)
 F_WUNUSED F_NONNULL
@@ -360,11 +773,11 @@ bool ltree_add_rec_mx(const zone_t* zone, const uint8_t* dname, const uint8_t* r
 F_WUNUSED F_NONNULL
 bool ltree_add_rec_srv(const zone_t* zone, const uint8_t* dname, const uint8_t* rhs, unsigned ttl, const unsigned priority, const unsigned weight, const unsigned port);
 F_WUNUSED F_NONNULL
-bool ltree_add_rec_naptr(const zone_t* zone, const uint8_t* dname, const uint8_t* rhs, unsigned ttl, const unsigned order, const unsigned pref, const unsigned num_texts, uint8_t** texts);
+bool ltree_add_rec_naptr(const zone_t* zone, const uint8_t* dname, const uint8_t* rhs, unsigned ttl, const unsigned order, const unsigned pref, const unsigned num_texts, const uint8_t* const* texts);
 F_WUNUSED F_NONNULL
-bool ltree_add_rec_txt(const zone_t* zone, const uint8_t* dname, const unsigned num_texts, uint8_t** texts, unsigned ttl);
+bool ltree_add_rec_txt(const zone_t* zone, const uint8_t* dname, const unsigned num_texts, const uint8_t* const* texts, unsigned ttl);
 F_WUNUSED F_NONNULLX(1)
-bool ltree_add_rec_rfc3597(const zone_t* zone, const uint8_t* dname, const unsigned rrtype, unsigned ttl, const unsigned rdlen, uint8_t* rd);
+bool ltree_add_rec_rfc3597(const zone_t* zone, const uint8_t* dname, const unsigned rrtype, unsigned ttl, const unsigned rdlen, const uint8_t* rd);
 
 // Load zonefiles (called from main, invokes parser)
 void ltree_load_zones(void);
@@ -417,4 +830,50 @@ static unsigned dname_to_lstack(const uint8_t* dname, const uint8_t** lstack) {
     return lcount;
 }
 
+// Look up the child of frozen node "node" (within the frozen tree
+//  rooted at "froot") with the given label, NULL if none.
+F_UNUSED F_PURE F_WUNUSED F_NONNULL
+static const ltree_fnode_t* ltree_fnode_find_child(const ltree_fnode_t* froot, const ltree_fnode_t* node, const uint8_t* label) {
+    dmn_assert(froot); dmn_assert(node); dmn_assert(label);
+
+    const uint32_t cmask = node->child_mask;
+    if(cmask) {
+        const ltree_fslot_t* slots = (const ltree_fslot_t*)((const uint8_t*)node + LTREE_FNODE_SLOTS_OFFSET(node->label[0], node->num_rrsets));
+        const uint32_t hash = label_djb_hash(label, UINT32_MAX);
+        uint32_t slot = hash & cmask;
+        while(slots[slot].offset) {
+            if(slots[slot].hash == hash) {
+                const ltree_fnode_t* child = (const ltree_fnode_t*)((const uint8_t*)froot + slots[slot].offset);
+                if(!gdnsd_label_cmp(label, child->label))
+                    return child;
+            }
+            slot = (slot + 1) & cmask;
+        }
+    }
+
+    return NULL;
+}
+
+// Look up an exact match for "rel_dname", relative to the zone, in the
+//  full-name index "nindex" of the frozen tree rooted at "froot".
+F_UNUSED F_PURE F_WUNUSED F_NONNULL
+static const ltree_fnode_t* ltree_nindex_find(const ltree_nindex_t* nindex, const ltree_fnode_t* froot, const uint8_t* rel_dname) {
+    dmn_assert(nindex); dmn_assert(froot); dmn_assert(rel_dname);
+
+    const uint32_t mask = nindex->mask;
+    const uint32_t hash = gdnsd_dname_hash(rel_dname);
+    uint32_t slot = hash & mask;
+    while(nindex->slots[slot].name) {
+        const ltree_nslot_t* ns = &nindex->slots[slot];
+        if(ns->hash == hash) {
+            const uint8_t* name = (const uint8_t*)nindex + ns->name;
+            if(!memcmp(name, rel_dname, *rel_dname + 1U))
+                return (const ltree_fnode_t*)((const uint8_t*)froot + ns->node);
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return NULL;
+}
+
 #endif // GDNSD_LTREE_H
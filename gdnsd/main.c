@@ -37,8 +37,10 @@
 #include "dnspacket.h"
 #include "statio.h"
 #include "ztree.h"
+#include "zprof.h"
 #include "zsrc_rfc1035.h"
 #include "zsrc_djb.h"
+#include "zsrc_tmpl.h"
 #include "gdnsd/log.h"
 #include "gdnsd/plugapi-priv.h"
 #include "gdnsd/net-priv.h"
@@ -120,7 +122,8 @@ static void usage(const char* argv0) {
         "  force-reload - Aliases 'restart'\n"
         "  condrestart - Does 'restart' action only if already running\n"
         "  try-restart - Aliases 'condrestart'\n"
-        "  status - Checks the status of the running daemon\n\n"
+        "  status - Checks the status of the running daemon\n"
+        "  compile-zones - Compiles the zones directory into a snapshot for faster startup\n\n"
         "Optional compile-time features:"
 
 #       ifndef NDEBUG
@@ -165,6 +168,7 @@ static void* zone_data_runtime(void* unused V_UNUSED) {
 
     zsrc_djb_runtime_init(zdata_loop);
     zsrc_rfc1035_runtime_init(zdata_loop);
+    zsrc_tmpl_runtime_init(zdata_loop);
 
     ev_run(zdata_loop, 0);
 
@@ -212,6 +216,10 @@ static void start_threads(void) {
                 i, t->is_udp ? "UDP" : "TCP", dmn_logf_anysin(&t->ac->addr), dmn_logf_strerror(pthread_err));
     }
 
+    // Start the reclaimer ahead of the zone data thread, so that runtime
+    //   reloads hand it replaced data rather than synchronizing inline
+    ztree_reclaim_start();
+
     pthread_t zone_data_threadid;
     pthread_err = pthread_create(&zone_data_threadid, &attribs, &zone_data_runtime, NULL);
     if(pthread_err)
@@ -299,6 +307,7 @@ typedef enum {
     ACT_RESTART,
     ACT_CRESTART, // downgrades to ACT_RESTART after checking...
     ACT_STATUS,
+    ACT_COMPILE,
     ACT_UNDEF
 } action_t;
 
@@ -317,8 +326,9 @@ static actmap_t actionmap[] = {
     { "condrestart",  ACT_CRESTART }, // 7
     { "try-restart",  ACT_CRESTART }, // 8
     { "status",       ACT_STATUS },   // 9
+    { "compile-zones", ACT_COMPILE }, // 10
 };
-#define ACTIONMAP_COUNT 9
+#define ACTIONMAP_COUNT 10
 
 F_NONNULL F_PURE
 static action_t match_action(const char* arg) {
@@ -403,6 +413,7 @@ int main(int argc, char** argv) {
             will_daemonize = false;
             break;
         case ACT_CHECKCFG:
+        case ACT_COMPILE:
             cmode = CONF_CHECK;
             will_daemonize = false;
             break;
@@ -466,10 +477,18 @@ int main(int argc, char** argv) {
     // Call plugin full_config actions
     gdnsd_plugins_action_full_config(gconfig.num_dns_threads);
 
+    if(action == ACT_COMPILE) {
+        ztree_init();
+        zsrc_rfc1035_compile_zones();
+        exit(0);
+    }
+
     log_info("Loading zone data...");
     ztree_init();
     zsrc_djb_load_zones(action == ACT_CHECKCFG);
     zsrc_rfc1035_load_zones(action == ACT_CHECKCFG);
+    zsrc_tmpl_load_zones(action == ACT_CHECKCFG);
+    zprof_log();
 
     if(action == ACT_CHECKCFG) {
         log_info("Configuration and zone data loads just fine");
@@ -630,6 +649,7 @@ int main(int argc, char** argv) {
                 log_info("Received HUP signal");
                 zsrc_djb_sighup();
                 zsrc_rfc1035_sighup();
+                zsrc_tmpl_sighup();
                 break;
             default:
                 dmn_assert(0);
@@ -30,6 +30,8 @@
 #include "dnsio_udp.h"
 #include "dnsio_tcp.h"
 #include "dnspacket.h"
+#include "ztree.h"
+#include "zprof.h"
 #include "gdnsd/log.h"
 #include "gdnsd/mon-priv.h"
 
@@ -56,6 +58,14 @@ typedef struct {
     stats_uint_t dns_edns_clientsub;
     stats_uint_t udp_reqs;
     stats_uint_t tcp_reqs;
+    stats_uint_t zfilter_bytes;
+    stats_uint_t zfilter_rejects;
+    stats_uint_t zfilter_fp;
+    stats_uint_t zreclaim_bytes;
+    stats_uint_t any;
+    stats_uint_t any_full;
+    stats_uint_t any_hinfo;
+    stats_uint_t any_rrset;
 } statio_t;
 
 typedef enum {
@@ -95,6 +105,10 @@ static const char log_udp[] =
     "udp_reqs:%" PRIuPTR " udp_recvfail:%" PRIuPTR " udp_sendfail:%" PRIuPTR " udp_tc:%" PRIuPTR " udp_edns_big:%" PRIuPTR " udp_edns_tc:%" PRIuPTR;
 static const char log_tcp[] =
     "tcp_reqs:%" PRIuPTR " tcp_recvfail:%" PRIuPTR " tcp_sendfail:%" PRIuPTR;
+static const char log_zones[] =
+    "zfilter_bytes:%" PRIuPTR " zfilter_rejects:%" PRIuPTR " zfilter_fp:%" PRIuPTR " zreclaim_bytes:%" PRIuPTR;
+static const char log_any[] =
+    "any:%" PRIuPTR " any_full:%" PRIuPTR " any_hinfo:%" PRIuPTR " any_rrset:%" PRIuPTR;
 
 static const char http_404_hdr[] =
     "HTTP/1.0 404 Not Found\r\n"
@@ -122,7 +136,11 @@ static const char csv_fixed[] =
     "udp_reqs,udp_recvfail,udp_sendfail,udp_tc,udp_edns_big,udp_edns_tc\r\n"
     "%" PRIuPTR ",%" PRIuPTR ",%" PRIuPTR ",%" PRIuPTR ",%" PRIuPTR ",%" PRIuPTR "\r\n"
     "tcp_reqs,tcp_recvfail,tcp_sendfail\r\n"
-    "%" PRIuPTR ",%" PRIuPTR ",%" PRIuPTR "\r\n";
+    "%" PRIuPTR ",%" PRIuPTR ",%" PRIuPTR "\r\n"
+    "zfilter_bytes,zfilter_rejects,zfilter_fp,zreclaim_bytes\r\n"
+    "%" PRIuPTR ",%" PRIuPTR ",%" PRIuPTR ",%" PRIuPTR "\r\n"
+    "any,any_full,any_hinfo,any_rrset\r\n"
+    "%" PRIuPTR ",%" PRIuPTR ",%" PRIuPTR ",%" PRIuPTR "\r\n";
 
 static const char json_fixed[] =
     "{\r\n"
@@ -151,6 +169,18 @@ static const char json_fixed[] =
     "\t\t\"reqs\": %" PRIuPTR ",\r\n"
     "\t\t\"recvfail\": %" PRIuPTR ",\r\n"
     "\t\t\"sendfail\": %" PRIuPTR "\r\n"
+    "\t},\r\n"
+    "\t\"zones\": {\r\n"
+    "\t\t\"zfilter_bytes\": %" PRIuPTR ",\r\n"
+    "\t\t\"zfilter_rejects\": %" PRIuPTR ",\r\n"
+    "\t\t\"zfilter_fp\": %" PRIuPTR ",\r\n"
+    "\t\t\"zreclaim_bytes\": %" PRIuPTR "\r\n"
+    "\t},\r\n"
+    "\t\"any\": {\r\n"
+    "\t\t\"reqs\": %" PRIuPTR ",\r\n"
+    "\t\t\"full\": %" PRIuPTR ",\r\n"
+    "\t\t\"hinfo\": %" PRIuPTR ",\r\n"
+    "\t\t\"rrset\": %" PRIuPTR "\r\n"
     "\t}";
 
 static const char json_footer[] = "}\r\n";
@@ -181,6 +211,12 @@ static const char html_fixed[] =
     "</table><table>\r\n"
     "<tr><th>tcp_reqs</th><th>tcp_recvfail</th><th>tcp_sendfail</th></tr>\r\n"
     "<tr><td>%" PRIuPTR "</td><td>%" PRIuPTR "</td><td>%" PRIuPTR "</td></tr>\r\n"
+    "</table><table>\r\n"
+    "<tr><th>zfilter_bytes</th><th>zfilter_rejects</th><th>zfilter_fp</th><th>zreclaim_bytes</th></tr>\r\n"
+    "<tr><td>%" PRIuPTR "</td><td>%" PRIuPTR "</td><td>%" PRIuPTR "</td><td>%" PRIuPTR "</td></tr>\r\n"
+    "</table><table>\r\n"
+    "<tr><th>any</th><th>any_full</th><th>any_hinfo</th><th>any_rrset</th></tr>\r\n"
+    "<tr><td>%" PRIuPTR "</td><td>%" PRIuPTR "</td><td>%" PRIuPTR "</td><td>%" PRIuPTR "</td></tr>\r\n"
     "</table>\r\n";
 
 static const char html_footer[] =
@@ -239,6 +275,12 @@ static void accumulate_statio(unsigned threadnum) {
     statio.dns_v6             += stats_get(&this_stats->v6);
     statio.dns_edns           += stats_get(&this_stats->edns);
     statio.dns_edns_clientsub += stats_get(&this_stats->edns_clientsub);
+    statio.zfilter_rejects    += stats_get(&this_stats->zfilter_rejects);
+    statio.zfilter_fp         += stats_get(&this_stats->zfilter_fp);
+    statio.any                += stats_get(&this_stats->any);
+    statio.any_full           += stats_get(&this_stats->any_full);
+    statio.any_hinfo          += stats_get(&this_stats->any_hinfo);
+    statio.any_rrset          += stats_get(&this_stats->any_rrset);
 }
 
 static void populate_stats(void) {
@@ -249,6 +291,8 @@ static void populate_stats(void) {
         const unsigned nio = gconfig.num_dns_threads;
         for(unsigned i = 0; i < nio; i++)
             accumulate_statio(i);
+        statio.zfilter_bytes = ztree_filter_bytes();
+        statio.zreclaim_bytes = ztree_reclaim_bytes();
         pop_statio_time = now;
     }
     dmn_assert(pop_statio_time >= start_time);
@@ -284,6 +328,8 @@ static void statio_log_stats(void) {
     log_info(log_dns, statio.dns_noerror, statio.dns_refused, statio.dns_nxdomain, statio.dns_notimp, statio.dns_badvers, statio.dns_formerr, statio.dns_dropped, statio.dns_v6, statio.dns_edns, statio.dns_edns_clientsub);
     log_info(log_udp, statio.udp_reqs, statio.udp_recvfail, statio.udp_sendfail, statio.udp_tc, statio.udp_edns_big, statio.udp_edns_tc);
     log_info(log_tcp, statio.tcp_reqs, statio.tcp_recvfail, statio.tcp_sendfail);
+    log_info(log_zones, statio.zfilter_bytes, statio.zfilter_rejects, statio.zfilter_fp, statio.zreclaim_bytes);
+    log_info(log_any, statio.any, statio.any_full, statio.any_hinfo, statio.any_rrset);
 }
 
 F_NONNULL
@@ -293,7 +339,7 @@ static void statio_fill_outbuf_csv(struct iovec* outbufs) {
 
     dmn_assert(pop_statio_time >= start_time);
 
-    outbufs[1].iov_len = snprintf(outbufs[1].iov_base, data_buffer_size, csv_fixed, (uint64_t)pop_statio_time - start_time, statio.dns_noerror, statio.dns_refused, statio.dns_nxdomain, statio.dns_notimp, statio.dns_badvers, statio.dns_formerr, statio.dns_dropped, statio.dns_v6, statio.dns_edns, statio.dns_edns_clientsub, statio.udp_reqs, statio.udp_recvfail, statio.udp_sendfail, statio.udp_tc, statio.udp_edns_big, statio.udp_edns_tc, statio.tcp_reqs, statio.tcp_recvfail, statio.tcp_sendfail);
+    outbufs[1].iov_len = snprintf(outbufs[1].iov_base, data_buffer_size, csv_fixed, (uint64_t)pop_statio_time - start_time, statio.dns_noerror, statio.dns_refused, statio.dns_nxdomain, statio.dns_notimp, statio.dns_badvers, statio.dns_formerr, statio.dns_dropped, statio.dns_v6, statio.dns_edns, statio.dns_edns_clientsub, statio.udp_reqs, statio.udp_recvfail, statio.udp_sendfail, statio.udp_tc, statio.udp_edns_big, statio.udp_edns_tc, statio.tcp_reqs, statio.tcp_recvfail, statio.tcp_sendfail, statio.zfilter_bytes, statio.zfilter_rejects, statio.zfilter_fp, statio.zreclaim_bytes, statio.any, statio.any_full, statio.any_hinfo, statio.any_rrset);
 
     outbufs[1].iov_len += gdnsd_mon_stats_out_csv(ADDVOID(outbufs[1].iov_base, outbufs[1].iov_len));
     outbufs[0].iov_len = snprintf(outbufs[0].iov_base, hdr_buffer_size, http_headers, "text/plain", (unsigned)outbufs[1].iov_len);
@@ -306,8 +352,9 @@ static void statio_fill_outbuf_json(struct iovec* outbufs) {
 
     dmn_assert(pop_statio_time >= start_time);
 
-    outbufs[1].iov_len = snprintf(outbufs[1].iov_base, data_buffer_size, json_fixed, (uint64_t)pop_statio_time - start_time, statio.dns_noerror, statio.dns_refused, statio.dns_nxdomain, statio.dns_notimp, statio.dns_badvers, statio.dns_formerr, statio.dns_dropped, statio.dns_v6, statio.dns_edns, statio.dns_edns_clientsub, statio.udp_reqs, statio.udp_recvfail, statio.udp_sendfail, statio.udp_tc, statio.udp_edns_big, statio.udp_edns_tc, statio.tcp_reqs, statio.tcp_recvfail, statio.tcp_sendfail);
+    outbufs[1].iov_len = snprintf(outbufs[1].iov_base, data_buffer_size, json_fixed, (uint64_t)pop_statio_time - start_time, statio.dns_noerror, statio.dns_refused, statio.dns_nxdomain, statio.dns_notimp, statio.dns_badvers, statio.dns_formerr, statio.dns_dropped, statio.dns_v6, statio.dns_edns, statio.dns_edns_clientsub, statio.udp_reqs, statio.udp_recvfail, statio.udp_sendfail, statio.udp_tc, statio.udp_edns_big, statio.udp_edns_tc, statio.tcp_reqs, statio.tcp_recvfail, statio.tcp_sendfail, statio.zfilter_bytes, statio.zfilter_rejects, statio.zfilter_fp, statio.zreclaim_bytes, statio.any, statio.any_full, statio.any_hinfo, statio.any_rrset);
 
+    outbufs[1].iov_len += zprof_out_json(ADDVOID(outbufs[1].iov_base, outbufs[1].iov_len));
     outbufs[1].iov_len += gdnsd_mon_stats_out_json(ADDVOID(outbufs[1].iov_base, outbufs[1].iov_len));
     memcpy(ADDVOID(outbufs[1].iov_base, outbufs[1].iov_len), json_footer, (sizeof(json_footer)) - 1);
     outbufs[1].iov_len += (sizeof(json_footer)-1);
@@ -327,7 +374,7 @@ static void statio_fill_outbuf_html(struct iovec* outbufs) {
     if(!asctime_r(&now_tm, now_char))
         log_fatal("asctime_r() failed");
 
-    outbufs[1].iov_len = snprintf(outbufs[1].iov_base, data_buffer_size, html_fixed, now_char, fmt_uptime(pop_statio_time), statio.dns_noerror, statio.dns_refused, statio.dns_nxdomain, statio.dns_notimp, statio.dns_badvers, statio.dns_formerr, statio.dns_dropped, statio.dns_v6, statio.dns_edns, statio.dns_edns_clientsub, statio.udp_reqs, statio.udp_recvfail, statio.udp_sendfail, statio.udp_tc, statio.udp_edns_big, statio.udp_edns_tc, statio.tcp_reqs, statio.tcp_recvfail, statio.tcp_sendfail);
+    outbufs[1].iov_len = snprintf(outbufs[1].iov_base, data_buffer_size, html_fixed, now_char, fmt_uptime(pop_statio_time), statio.dns_noerror, statio.dns_refused, statio.dns_nxdomain, statio.dns_notimp, statio.dns_badvers, statio.dns_formerr, statio.dns_dropped, statio.dns_v6, statio.dns_edns, statio.dns_edns_clientsub, statio.udp_reqs, statio.udp_recvfail, statio.udp_sendfail, statio.udp_tc, statio.udp_edns_big, statio.udp_edns_tc, statio.tcp_reqs, statio.tcp_recvfail, statio.tcp_sendfail, statio.zfilter_bytes, statio.zfilter_rejects, statio.zfilter_fp, statio.zreclaim_bytes, statio.any, statio.any_full, statio.any_hinfo, statio.any_rrset);
 
     outbufs[1].iov_len += gdnsd_mon_stats_out_html(ADDVOID(outbufs[1].iov_base, outbufs[1].iov_len));
     memcpy(ADDVOID(outbufs[1].iov_base, outbufs[1].iov_len), html_footer, (sizeof(html_footer)) - 1);
@@ -616,8 +663,9 @@ void statio_init(void) {
         fixed                                 // html_fixed format string
         + (25 - 2)                            // max asctime output - 2 for the original %s
         + (IVAL_BUFSZ - 2)                    // max fmt_uptime output, again - 2 for %s
-        + (19 * (stat_len - strlen(PRIuPTR))) // 19 stats, up to 20 bytes long each
+        + (27 * (stat_len - strlen(PRIuPTR))) // 27 stats, up to 20 bytes long each
         + gdnsd_mon_stats_get_max_len()       // whatever mon.c tells us...
+        + zprof_json_max_len()                // ditto for zprof.c (json only)
         + (sizeof(html_footer) - 1);          // html_footer fixed string
 
     // double it, because it's not that big and this gives us a lot of headroom for
@@ -0,0 +1,331 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "zprof.h"
+#include "conf.h"
+#include "gdnsd/log.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+// The slowest zones loaded, by total wall time.  A source
+//   appears at most once, with its slowest load.
+typedef struct {
+    uint8_t dname[256];
+    char src[256]; // truncated if longer
+    uint64_t total;
+    zprof_t prof;
+} zprof_ent_t;
+
+// Histogram buckets of total wall time per zone, by upper bound
+#define ZPROF_BUCKETS 7
+static const uint64_t bucket_max[ZPROF_BUCKETS - 1] = {
+    100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL
+};
+static const char* const bucket_names[ZPROF_BUCKETS] = {
+    "le_100us", "le_1ms", "le_10ms", "le_100ms", "le_1s", "le_10s", "gt_10s"
+};
+
+static pthread_mutex_t zprof_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t num_loads = 0;
+static uint64_t total_bytes = 0;
+static uint64_t total_wall[ZPROF_PHASES];
+static uint64_t total_cpu[ZPROF_PHASES];
+static uint64_t histogram[ZPROF_BUCKETS];
+static zprof_ent_t* slowest = NULL; // gconfig.zones_profile_slowest entries
+static unsigned num_slowest = 0;
+
+static uint64_t clock_ns(const clockid_t clk) {
+    struct timespec ts;
+    if(clock_gettime(clk, &ts))
+        return 0;
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+void zprof_mark(zprof_mark_t* mark) {
+    dmn_assert(mark);
+    mark->wall = clock_ns(CLOCK_MONOTONIC);
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    mark->cpu = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+#else
+    mark->cpu = 0;
+#endif
+}
+
+void zprof_add(zprof_t* prof, const zprof_phase_t phase, zprof_mark_t* mark) {
+    dmn_assert(prof); dmn_assert(mark);
+    dmn_assert(phase < ZPROF_PHASES);
+
+    zprof_mark_t now;
+    zprof_mark(&now);
+    prof->wall[phase] += now.wall - mark->wall;
+    prof->cpu[phase] += now.cpu - mark->cpu;
+    *mark = now;
+}
+
+F_NONNULL F_PURE
+static uint64_t prof_total(const zprof_t* prof, const bool cpu) {
+    const uint64_t* t = cpu ? prof->cpu : prof->wall;
+    uint64_t total = 0;
+    for(unsigned i = 0; i < ZPROF_PHASES; i++)
+        total += t[i];
+    return total;
+}
+
+// Inserts into the sorted slowest list, called with the lock held
+F_NONNULL
+static void slowest_insert(const uint8_t* dname, const char* src, const zprof_t* prof, const uint64_t total) {
+    const unsigned max = gconfig.zones_profile_slowest;
+    if(!max)
+        return;
+    if(!slowest)
+        slowest = calloc(max, sizeof(zprof_ent_t));
+
+    // a zone which is already listed keeps its slowest load.  The
+    //   source alone isn't unique (every zone from a djb directory
+    //   shares one), so this matches on zone name and source together.
+    for(unsigned i = 0; i < num_slowest; i++) {
+        if(!memcmp(slowest[i].dname, dname, dname[0] + 1U)
+            && !strncmp(slowest[i].src, src, sizeof(slowest[i].src) - 1)) {
+            if(total <= slowest[i].total)
+                return;
+            memmove(&slowest[i], &slowest[i + 1], (num_slowest - i - 1) * sizeof(zprof_ent_t));
+            num_slowest--;
+            break;
+        }
+    }
+
+    unsigned pos = num_slowest;
+    while(pos && slowest[pos - 1].total < total)
+        pos--;
+    if(pos == max)
+        return;
+    if(num_slowest == max)
+        num_slowest--;
+    memmove(&slowest[pos + 1], &slowest[pos], (num_slowest - pos) * sizeof(zprof_ent_t));
+    num_slowest++;
+
+    zprof_ent_t* ent = &slowest[pos];
+    memcpy(ent->dname, dname, dname[0] + 1U);
+    strncpy(ent->src, src, sizeof(ent->src) - 1);
+    ent->src[sizeof(ent->src) - 1] = '\0';
+    ent->total = total;
+    memcpy(&ent->prof, prof, sizeof(zprof_t));
+}
+
+void zprof_record(const uint8_t* dname, const char* src, const zprof_t* prof) {
+    dmn_assert(dname); dmn_assert(src); dmn_assert(prof);
+
+    const uint64_t total = prof_total(prof, false);
+    unsigned bucket = 0;
+    while(bucket < (ZPROF_BUCKETS - 1) && total > bucket_max[bucket])
+        bucket++;
+
+    pthread_mutex_lock(&zprof_lock);
+    num_loads++;
+    total_bytes += prof->bytes;
+    for(unsigned i = 0; i < ZPROF_PHASES; i++) {
+        total_wall[i] += prof->wall[i];
+        total_cpu[i] += prof->cpu[i];
+    }
+    histogram[bucket]++;
+    slowest_insert(dname, src, prof, total);
+    pthread_mutex_unlock(&zprof_lock);
+}
+
+#define MS(_ns) ((double)(_ns) / 1000000.0)
+
+void zprof_log(void) {
+    pthread_mutex_lock(&zprof_lock);
+
+    if(num_loads) {
+        uint64_t wall = 0, cpu = 0;
+        for(unsigned i = 0; i < ZPROF_PHASES; i++) {
+            wall += total_wall[i];
+            cpu += total_cpu[i];
+        }
+        log_info("Zone load profile: %" PRIu64 " zone loads took %.3f ms wall, %.3f ms cpu, %" PRIu64 " bytes (wall/cpu ms: scan %.3f/%.3f, phase1 %.3f/%.3f, phase2 %.3f/%.3f, freeze %.3f/%.3f, publish %.3f/%.3f)",
+            num_loads, MS(wall), MS(cpu), total_bytes,
+            MS(total_wall[ZPROF_SCAN]), MS(total_cpu[ZPROF_SCAN]),
+            MS(total_wall[ZPROF_PHASE1]), MS(total_cpu[ZPROF_PHASE1]),
+            MS(total_wall[ZPROF_PHASE2]), MS(total_cpu[ZPROF_PHASE2]),
+            MS(total_wall[ZPROF_FREEZE]), MS(total_cpu[ZPROF_FREEZE]),
+            MS(total_wall[ZPROF_PUBLISH]), MS(total_cpu[ZPROF_PUBLISH]));
+        log_info("Zone load profile: wall time histogram: <=100us:%" PRIu64 " <=1ms:%" PRIu64 " <=10ms:%" PRIu64 " <=100ms:%" PRIu64 " <=1s:%" PRIu64 " <=10s:%" PRIu64 " >10s:%" PRIu64,
+            histogram[0], histogram[1], histogram[2], histogram[3], histogram[4], histogram[5], histogram[6]);
+        for(unsigned i = 0; i < num_slowest; i++) {
+            const zprof_t* p = &slowest[i].prof;
+            log_info("Zone load profile: slowest #%u: zone %s source %s: %.3f ms wall, %.3f ms cpu, %" PRIu64 " bytes (wall/cpu ms: scan %.3f/%.3f, phase1 %.3f/%.3f, phase2 %.3f/%.3f, freeze %.3f/%.3f, publish %.3f/%.3f)",
+                i + 1, logf_dname(slowest[i].dname), slowest[i].src,
+                MS(slowest[i].total), MS(prof_total(p, true)), p->bytes,
+                MS(p->wall[ZPROF_SCAN]), MS(p->cpu[ZPROF_SCAN]),
+                MS(p->wall[ZPROF_PHASE1]), MS(p->cpu[ZPROF_PHASE1]),
+                MS(p->wall[ZPROF_PHASE2]), MS(p->cpu[ZPROF_PHASE2]),
+                MS(p->wall[ZPROF_FREEZE]), MS(p->cpu[ZPROF_FREEZE]),
+                MS(p->wall[ZPROF_PUBLISH]), MS(p->cpu[ZPROF_PUBLISH]));
+        }
+    }
+
+    pthread_mutex_unlock(&zprof_lock);
+}
+
+/* JSON output for statio, which becomes the "zone_loads" member of
+ *   the top-level object:
+ *
+ *   "zone_loads": {
+ *       "count": N, "bytes": N,
+ *       "wall_us": { "scan": N, ... }, "cpu_us": { "scan": N, ... },
+ *       "histogram": { "le_100us": N, ... },
+ *       "slowest": [
+ *           { "zone": S, "source": S, "wall_us": N, "cpu_us": N, "bytes": N,
+ *             "phases_wall_us": { "scan": N, ... }, "phases_cpu_us": { "scan": N, ... } },
+ *           ...
+ *       ]
+ *   }
+ */
+
+static const char json_head[] = ",\r\n\t\"zone_loads\": {\r\n\t\t\"count\": %" PRIu64 ",\r\n\t\t\"bytes\": %" PRIu64 ",\r\n";
+static const char json_phases[] = "\"%s\": { \"scan\": %" PRIu64 ", \"phase1\": %" PRIu64 ", \"phase2\": %" PRIu64 ", \"freeze\": %" PRIu64 ", \"publish\": %" PRIu64 " }";
+static const char json_hist[] = "\t\t\"histogram\": { \"%s\": %" PRIu64 ", \"%s\": %" PRIu64 ", \"%s\": %" PRIu64 ", \"%s\": %" PRIu64 ", \"%s\": %" PRIu64 ", \"%s\": %" PRIu64 ", \"%s\": %" PRIu64 " },\r\n\t\t\"slowest\": [";
+static const char json_ent[] = "\r\n\t\t\t{ \"zone\": \"%s\", \"source\": \"%s\", \"wall_us\": %" PRIu64 ", \"cpu_us\": %" PRIu64 ", \"bytes\": %" PRIu64 ",\r\n\t\t\t  ";
+static const char json_foot[] = "\r\n\t\t]\r\n\t}";
+
+// Worst-case escaped lengths of dname and src strings below
+#define DNAME_JSON_MAX (255U * 5U)
+#define SRC_JSON_MAX (255U * 6U)
+// Generous bound for any one format expansion of integers and names
+#define JSON_NUMS_MAX (20U * 8U)
+
+unsigned zprof_json_max_len(void) {
+    const unsigned phases = (sizeof(json_phases) - 1) + 16 + (5 * 20);
+    const unsigned ent = (sizeof(json_ent) - 1) + DNAME_JSON_MAX + SRC_JSON_MAX + (3 * 20)
+        + (2 * phases) + 8;
+    return (sizeof(json_head) - 1) + (2 * 20)
+        + (2 * (phases + 4))
+        + (sizeof(json_hist) - 1) + JSON_NUMS_MAX + 64
+        + (gconfig.zones_profile_slowest * ent)
+        + (sizeof(json_foot) - 1) + 1;
+}
+
+// Writes a dname as JSON string contents, with DNS-style
+//   \DDD escapes for unprintables
+F_NONNULL
+static char* json_dname(char* out, const uint8_t* dname) {
+    const uint8_t* lp = dname + 1;
+    if(!*lp) {
+        *out++ = '.';
+        return out;
+    }
+    while(*lp && *lp != 255) {
+        const unsigned llen = *lp++;
+        for(unsigned i = 0; i < llen; i++) {
+            const unsigned char x = *lp++;
+            if(x == '"' || x == '\\') {
+                *out++ = '\\';
+                *out++ = x;
+            }
+            else if(x > 0x20 && x < 0x7F) {
+                *out++ = x;
+            }
+            else {
+                *out++ = '\\';
+                *out++ = '\\';
+                *out++ = '0' + (x / 100);
+                *out++ = '0' + ((x / 10) % 10);
+                *out++ = '0' + (x % 10);
+            }
+        }
+        *out++ = '.';
+    }
+    return out;
+}
+
+F_NONNULL
+static char* json_str(char* out, const char* str) {
+    for(; *str; str++) {
+        const unsigned char x = *str;
+        if(x == '"' || x == '\\') {
+            *out++ = '\\';
+            *out++ = x;
+        }
+        else if(x < 0x20) {
+            out += sprintf(out, "\\u%04x", x);
+        }
+        else {
+            *out++ = x;
+        }
+    }
+    return out;
+}
+
+#define US(_ns) ((_ns) / 1000U)
+
+F_NONNULL
+static unsigned json_phases_out(char* buf, const char* name, const uint64_t* t) {
+    return (unsigned)sprintf(buf, json_phases, name,
+        US(t[ZPROF_SCAN]), US(t[ZPROF_PHASE1]), US(t[ZPROF_PHASE2]), US(t[ZPROF_FREEZE]), US(t[ZPROF_PUBLISH]));
+}
+
+unsigned zprof_out_json(char* buf) {
+    dmn_assert(buf);
+    char* out = buf;
+
+    pthread_mutex_lock(&zprof_lock);
+
+    out += sprintf(out, json_head, num_loads, total_bytes);
+    *out++ = '\t'; *out++ = '\t';
+    out += json_phases_out(out, "wall_us", total_wall);
+    memcpy(out, ",\r\n\t\t", 5); out += 5;
+    out += json_phases_out(out, "cpu_us", total_cpu);
+    memcpy(out, ",\r\n", 3); out += 3;
+    out += sprintf(out, json_hist,
+        bucket_names[0], histogram[0], bucket_names[1], histogram[1],
+        bucket_names[2], histogram[2], bucket_names[3], histogram[3],
+        bucket_names[4], histogram[4], bucket_names[5], histogram[5],
+        bucket_names[6], histogram[6]);
+
+    for(unsigned i = 0; i < num_slowest; i++) {
+        const zprof_ent_t* ent = &slowest[i];
+        char zone[DNAME_JSON_MAX + 1];
+        char src[SRC_JSON_MAX + 1];
+        *json_dname(zone, ent->dname) = '\0';
+        *json_str(src, ent->src) = '\0';
+        out += sprintf(out, json_ent, zone, src, US(ent->total), US(prof_total(&ent->prof, true)), ent->prof.bytes);
+        out += json_phases_out(out, "phases_wall_us", ent->prof.wall);
+        *out++ = ',';
+        *out++ = ' ';
+        out += json_phases_out(out, "phases_cpu_us", ent->prof.cpu);
+        memcpy(out, " }", 2); out += 2;
+        if(i < num_slowest - 1)
+            *out++ = ',';
+    }
+
+    pthread_mutex_unlock(&zprof_lock);
+
+    memcpy(out, json_foot, sizeof(json_foot) - 1);
+    out += sizeof(json_foot) - 1;
+
+    const unsigned len = (unsigned)(out - buf);
+    if(unlikely(len > zprof_json_max_len()))
+        log_fatal("BUG: zone load profile stats buf miscalculated");
+    return len;
+}
@@ -0,0 +1,75 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GDNSD_ZPROF_H
+#define GDNSD_ZPROF_H
+
+#include "config.h"
+#include "gdnsd/compiler.h"
+
+#include <inttypes.h>
+
+// Zone load profiling.  Every zone_t carries a zprof_t, which is
+//   filled in phase by phase as the zone is built, and is recorded
+//   into the global load statistics once the zone is published to
+//   the ztree.  Times are nanoseconds.
+
+typedef enum {
+    ZPROF_SCAN = 0, // parsing source data, including ltree insertion
+    ZPROF_PHASE1,   // postproc phase1 (zone root and per-node checks)
+    ZPROF_PHASE2,   // postproc phase2 (glue checks)
+    ZPROF_FREEZE,   // rewriting into the frozen runtime form
+    ZPROF_PUBLISH,  // insertion into the ztree
+    ZPROF_PHASES,
+} zprof_phase_t;
+
+typedef struct {
+    uint64_t wall;
+    uint64_t cpu; // of the calling thread
+} zprof_mark_t;
+
+typedef struct {
+    uint64_t wall[ZPROF_PHASES];
+    uint64_t cpu[ZPROF_PHASES];
+    uint64_t bytes; // zone storage held by the arena, once frozen
+} zprof_t;
+
+// Sets "mark" to the current time
+F_NONNULL
+void zprof_mark(zprof_mark_t* mark);
+
+// Adds the time since "mark" to "phase" of "prof", and resets
+//   "mark" to the current time for timing the next phase
+F_NONNULL
+void zprof_add(zprof_t* prof, const zprof_phase_t phase, zprof_mark_t* mark);
+
+// Records the profile of a published zone, thread-safe
+F_NONNULL
+void zprof_record(const uint8_t* dname, const char* src, const zprof_t* prof);
+
+// Logs the totals, histogram, and slowest zones at info level
+void zprof_log(void);
+
+// For statio: the maximum output length of zprof_out_json(),
+//   and the output itself (without a terminating NUL)
+unsigned zprof_json_max_len(void);
+F_NONNULL
+unsigned zprof_out_json(char* buf);
+
+#endif // GDNSD_ZPROF_H
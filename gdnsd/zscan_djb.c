@@ -78,12 +78,18 @@ typedef struct {
     uint64_t mtime;
     zscan_djb_zonedata_t* zonedata;
     const char* path;
-    uint8_t** texts;
+    const uint8_t** texts;
+    uint8_t* tbuf; /* text chunk data of the current record */
     char* line;
     size_t allocated;
+    size_t tbuf_allocated;
     int num_texts;
     int skipped;
 
+    /* scan time charged to the zone of the current run of records */
+    zscan_djb_zonedata_t* prof_zd;
+    zprof_mark_t prof_mark;
+
     /* file specific data */
     int lcount;
     char* full_fn;
@@ -93,6 +99,10 @@ typedef struct {
     sigjmp_buf jbuf;
 } zscan_t;
 
+// FNV-1a, for the per-zone record data hashes
+#define HASH_INIT 14695981039346656037ULL
+#define HASH_PRIME 1099511628211ULL
+
 static const uint8_t dname_root[] = {1,0};
 static const uint8_t dname_ns[]   = {4,2,'n','s',255};
 static const uint8_t dname_mx[]   = {4,2,'m','x',255};
@@ -101,6 +111,8 @@ static const uint8_t dname_srv[]  = {5,3,'s','r','v',255};
 void zscan_djbzone_add(zscan_djb_zonedata_t** zd, zone_t *zone) {
     zscan_djb_zonedata_t* nzd = malloc(sizeof(zscan_djb_zonedata_t));
     nzd->zone = zone;
+    nzd->old_zone = NULL;
+    nzd->hash = HASH_INIT;
     nzd->marked = 0;
     nzd->next = *zd;
     *zd = nzd;
@@ -270,17 +282,90 @@ static void create_zones(zscan_t *z, char record_type, field_t *field) {
     free(src);
 }
 
+F_NONNULL
+static uint64_t hash_bytes(uint64_t hash, const void* data, const unsigned len) {
+    const uint8_t* d = data;
+    for (unsigned i = 0; i < len; i++)
+        hash = (hash ^ d[i]) * HASH_PRIME;
+    return hash;
+}
+
+// Hashes each record (with its filename, which is the zone source)
+//   into the zone it would be loaded into by load_zones() below.  The
+//   zone which the glue address of a record is named relative to is
+//   part of the data as well.
+static void hash_zones(zscan_t *z, char record_type, field_t *field) {
+    uint8_t dname[256], dname2[256];
+    const uint8_t* subzone;
+
+    parse_dname(z, dname, &field[0]);
+    zscan_djb_zonedata_t* zd = zscan_djbzone_get(z->zonedata, dname, 0);
+    if (!zd)
+       return;
+
+    uint64_t hash = hash_bytes(zd->hash, z->fn, strlen(z->fn) + 1);
+    hash = hash_bytes(hash, &record_type, 1);
+    for (unsigned i = 0; i < 15; i++) {
+        hash = hash_bytes(hash, &field[i].len, sizeof(field[i].len));
+        hash = hash_bytes(hash, field[i].ptr, field[i].len);
+    }
+
+    switch (record_type) {
+        case '.': case '&': subzone = dname_ns; break;
+        case '@': subzone = dname_mx; break;
+        case 'S': subzone = dname_srv; break;
+        default: subzone = NULL; break;
+    }
+    if (subzone && field[1].len) {
+        make_dname_relative(dname, zd->zone->dname);
+        expand_dname(z, dname2, &field[2], subzone, dname);
+        zscan_djb_zonedata_t* gzd = zscan_djbzone_get(z->zonedata, dname2, 0);
+        if (gzd)
+            hash = hash_bytes(hash, gzd->zone->dname, gzd->zone->dname[0] + 1);
+    }
+
+    zd->hash = hash;
+}
+
+// Charges the scan time since the last switch to the zone it was
+//   spent on.  The clock is only read when the records switch from
+//   one zone to another, which for typical data (grouped by zone)
+//   is about once per zone.
+static void prof_switch(zscan_t *z, zscan_djb_zonedata_t* zd) {
+    if (zd == z->prof_zd)
+        return;
+    if (z->prof_zd)
+        zprof_add(&z->prof_zd->zone->prof, ZPROF_SCAN, &z->prof_mark);
+    else
+        zprof_mark(&z->prof_mark);
+    z->prof_zd = zd;
+}
+
 #define TTDCHECK(fno) if (field[fno].len) { z->skipped++; return; }
 #define LOCCHECK(fno) if (field[fno].len) { z->skipped++; return; }
 
+/* ltree copies text data out of the records it's given, so the chunks
+ * of the current record are just assembled in a buffer reused for all
+ * records, grown as needed */
+F_NONNULL
+static uint8_t *tbuf_reserve(zscan_t *z, size_t len) {
+    if (len > z->tbuf_allocated) {
+        z->tbuf_allocated = len;
+        z->tbuf = realloc(z->tbuf, len);
+    }
+    return z->tbuf;
+}
+
 static void load_zones(zscan_t *z, char record_type, field_t *field) {
     uint8_t dname[256], dname2[256], email[256];
+    uint8_t* chunk;
     unsigned i, ttl;
 
     parse_dname(z, dname, &field[0]);
     zscan_djb_zonedata_t* zd = zscan_djbzone_get(z->zonedata, dname, 0);
-    if (!zd)
+    if (!zd || zd->zone == zd->old_zone)
        return;
+    prof_switch(z, zd);
 
     //log_info("djb: processing '%s'", logf_dname(dname));
 
@@ -391,20 +476,19 @@ static void load_zones(zscan_t *z, char record_type, field_t *field) {
             parse_error_noargs("Text chunk too long (>65500 unescaped)");
 
         z->texts = realloc(z->texts, sizeof(uint8_t *) * (chunks + 1));
+        chunk = tbuf_reserve(z, bytes + chunks);
         for (i = 0; i < chunks; i++) {
             int s = (bytes > 255 ? 255 : bytes);
-            z->texts[i] = malloc(s + 1);
-            z->texts[i][0] = s;
-            memcpy(&z->texts[i][1], src, s);
+            z->texts[i] = chunk;
+            *chunk++ = s;
+            memcpy(chunk, src, s);
+            chunk += s;
             bytes -= s;
             src += s;
         }
         z->texts[i] = NULL;
-        if (ltree_add_rec_txt(zone, dname, chunks, z->texts, parse_ttl(z,&field[2], TTL_POSITIVE))) {
-            for (i = 0; i < chunks; i++)
-                free(z->texts[i]);
+        if (ltree_add_rec_txt(zone, dname, chunks, z->texts, parse_ttl(z,&field[2], TTL_POSITIVE)))
             parse_abort();
-        }
         break;
     case 'S': /* SRV (+ A) */
         TTDCHECK(7);
@@ -433,17 +517,16 @@ static void load_zones(zscan_t *z, char record_type, field_t *field) {
             parse_error_noargs("NAPTR label cannot exceed 255 chars");
 
         z->texts = realloc(z->texts, 4 * sizeof(uint8_t *));
+        chunk = tbuf_reserve(z, field[3].len + field[4].len + field[5].len + 3);
         for (i = 0; i < 3; i++) {
-            z->texts[i] = malloc(field[3+i].len + 1);
-            z->texts[i][0] = field[3+i].len;
-            memcpy(&z->texts[i][1], field[3+i].ptr, field[3+i].len);
+            z->texts[i] = chunk;
+            *chunk++ = field[3+i].len;
+            memcpy(chunk, field[3+i].ptr, field[3+i].len);
+            chunk += field[3+i].len;
         }
         z->texts[i] = NULL;
-        if (ltree_add_rec_naptr(zone, dname, parse_dname(z, dname2, &field[6]), parse_ttl(z, &field[7], TTL_POSITIVE), parse_int(z, &field[1]), parse_int(z, &field[2]), 3, z->texts)) {
-            for (i = 0; i < 3; i++)
-                free(z->texts[i]);
+        if (ltree_add_rec_naptr(zone, dname, parse_dname(z, dname2, &field[6]), parse_ttl(z, &field[7], TTL_POSITIVE), parse_int(z, &field[1]), parse_int(z, &field[2]), 3, z->texts))
             parse_abort();
-        }
         break;
 #if 0
     case '3': /* AAAA */
@@ -554,8 +637,8 @@ static bool zscan_foreach_record(zscan_t *z, djb_recordcb_t cb) {
     return failed;
 }
 
-F_WUNUSED F_NONNULL
-bool zscan_djb(const char* djb_path, zscan_djb_zonedata_t** zonedata)
+F_WUNUSED F_NONNULLX(1, 3)
+bool zscan_djb(const char* djb_path, zscan_djb_zonedata_t* prev, zscan_djb_zonedata_t** zonedata)
 {
     dmn_assert(djb_path);
 
@@ -563,11 +646,32 @@ bool zscan_djb(const char* djb_path, zscan_djb_zonedata_t** zonedata)
     memset(z, 0, sizeof(*z));
     z->path = djb_path;
 
-    if (zscan_foreach_record(z, create_zones) || zscan_foreach_record(z, load_zones))
+    for (zscan_djb_zonedata_t *zd = prev; zd; zd = zd->next)
+        zd->marked = 0;
+
+    if (zscan_foreach_record(z, create_zones) || zscan_foreach_record(z, hash_zones))
         goto error;
 
+    // Zones with unchanged data keep their existing zone_t, and
+    //   only the rest are loaded from the records
+    for (zscan_djb_zonedata_t *zd = z->zonedata; zd; zd = zd->next) {
+        zscan_djb_zonedata_t* old = zscan_djbzone_get(prev, zd->zone->dname, 1);
+        if (old) {
+            old->marked = 1;
+            zd->old_zone = old->zone;
+            if (old->hash == zd->hash) {
+                zone_delete(zd->zone);
+                zd->zone = old->zone;
+            }
+        }
+    }
+
+    if (zscan_foreach_record(z, load_zones))
+        goto error;
+    prof_switch(z, NULL);
+
     for (zscan_djb_zonedata_t *zd = z->zonedata; zd; zd = zd->next)
-        if (zone_finalize(zd->zone))
+        if (zd->zone != zd->old_zone && zone_finalize(zd->zone))
             goto error;
 
     if (z->skipped)
@@ -575,10 +679,17 @@ bool zscan_djb(const char* djb_path, zscan_djb_zonedata_t** zonedata)
 
     *zonedata = z->zonedata;
     free(z->line);
+    free(z->texts);
+    free(z->tbuf);
     return false;
 
 error:
+    for (zscan_djb_zonedata_t *zd = z->zonedata; zd; zd = zd->next)
+        if (zd->zone != zd->old_zone)
+            zone_delete(zd->zone);
     zscan_djbzone_free(&z->zonedata);
     free(z->line);
+    free(z->texts);
+    free(z->tbuf);
     return true;
 }
@@ -24,6 +24,8 @@
 
 typedef struct _zscan_djb_zonedata {
     zone_t* zone;
+    zone_t* old_zone; // same-named zone of the previous scan, or NULL
+    uint64_t hash;    // hash of the zone's record data
     int marked;
     struct _zscan_djb_zonedata* next;
 } zscan_djb_zonedata_t;
@@ -32,7 +34,11 @@ void zscan_djbzone_add(zscan_djb_zonedata_t**, zone_t *zone);
 zscan_djb_zonedata_t* zscan_djbzone_get(zscan_djb_zonedata_t*, const uint8_t*, int);
 void zscan_djbzone_free(zscan_djb_zonedata_t**);
 
-F_WUNUSED F_NONNULL
-bool zscan_djb(const char* djb_path, zscan_djb_zonedata_t** zonedata);
+// "prev" is the zonedata of the previous scan (or NULL).  Any zone
+//   whose record data hashes the same as in "prev" is not loaded
+//   again: its "zone" is the existing "old_zone".  Entries of "prev"
+//   with a same-named zone in the new zonedata are marked.
+F_WUNUSED F_NONNULLX(1, 3)
+bool zscan_djb(const char* djb_path, zscan_djb_zonedata_t* prev, zscan_djb_zonedata_t** zonedata);
 
 #endif // GDNSD_ZSCAN_DJB_H
@@ -22,9 +22,24 @@
 
 #include "config.h"
 #include "ztree.h"
+#include "zsnap.h"
 
-// Actually scan the zonefile, creating the data
+// Actually scan the zonefile, creating the data.  If "snap" is
+//   non-NULL, the records are also recorded there for zsnap.
+F_WUNUSED F_NONNULLX(1,2)
+bool zscan_rfc1035(zone_t* zone, const char* fn, zsnap_buf_t* snap);
+
+// As above, but the records are only recorded into "recs", without
+//   creating any zone data ("zone" is only used for its name).  If
+//   "journal" is set, "fn" is a zone journal: $ADD and $DELETE
+//   directives are allowed, and each record is recorded with its
+//   operation, for zscan_rfc1035_replay().
 F_WUNUSED F_NONNULL
-bool zscan_rfc1035(zone_t* zone, const char* fn);
+bool zscan_rfc1035_record(zone_t* zone, const char* fn, zsnap_buf_t* recs, const bool journal);
+
+// Creates the data from records recorded by the above, with the
+//   operations of a recorded zone journal (if non-NULL) applied.
+F_WUNUSED F_NONNULLX(1)
+bool zscan_rfc1035_replay(zone_t* zone, const uint8_t* data, const size_t len, const uint8_t* journal, const size_t journal_len);
 
 #endif // GDNSD_ZSCAN_H
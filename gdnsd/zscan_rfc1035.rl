@@ -32,6 +32,7 @@
 #include "ltarena.h"
 #include "gdnsd/log.h"
 #include "gdnsd/misc.h"
+#include "gdnsd/misc-priv.h"
 
 #ifndef INET6_ADDRSTRLEN
 #define INET6_ADDRSTRLEN 46
@@ -53,6 +54,23 @@
  */
 #define MAX_BUFSIZE 65536
 
+/*
+ * Record data which must outlive a single token (TXT chunks and
+ *  RFC3597 rdata) is carved from per-scan scratch blocks, which are
+ *  rewound at the start of each such record.  The previous record's
+ *  data is dead by then, as ltree copies what it keeps into the
+ *  zone's arena.  Blocks are kept for the life of the scan and are
+ *  never moved, so steady-state parsing does no heap allocation.
+ * SCRATCH_BLOCK must be at least as large as the largest single
+ *  allocation, which is the 65535-byte max of RFC3597 rdata.
+ */
+#define SCRATCH_BLOCK 65536U
+
+typedef struct _scratch_blk_t {
+    struct _scratch_blk_t* next;
+    uint8_t data[SCRATCH_BLOCK];
+} scratch_blk_t;
+
 #define parse_error(_fmt, ...) \
     do {\
         log_err("rfc1035: Zone %s: Zonefile parse error at line %u: " _fmt,logf_dname(z->zone->dname),z->lcount,__VA_ARGS__);\
@@ -71,8 +89,13 @@ typedef struct {
     bool     in_paren;
     bool     zn_err_detect;
     bool     lhs_is_ooz;
+    bool     record_only; // records are only recorded to ->snap, not added to ->zone
+    bool     journal;     // scanning a zone journal, see journal_op() below
+    uint8_t  journal_op;  // JOURNAL_ADD or JOURNAL_DELETE
     unsigned lcount;
     unsigned num_texts;
+    unsigned texts_alloc;
+    unsigned scratch_used; // bytes used in scratch_cur
     unsigned def_ttl;
     unsigned uval;
     unsigned ttl;
@@ -87,13 +110,16 @@ typedef struct {
     unsigned limit_v4;
     unsigned limit_v6;
     uint8_t* rfc3597_data;
+    scratch_blk_t* scratch;     // all blocks
+    scratch_blk_t* scratch_cur; // current block, NULL after rewind
     zone_t* zone;
     const char* tstart;
     uint8_t  origin[256];
     uint8_t  lhs_dname[256];
     uint8_t  rhs_dname[256];
     uint8_t  eml_dname[256];
-    uint8_t** texts;
+    const uint8_t** texts; // NULL-terminated, reused across records
+    zsnap_buf_t* snap; // records are also recorded here, if non-NULL
     sigjmp_buf jbuf;
 } zscan_t;
 
@@ -202,13 +228,53 @@ static void dname_set(zscan_t* z, uint8_t* dname, unsigned len, bool lhs) {
     }
 }
 
+/********** Scratch ******************/
+
+F_NONNULL
+static void scratch_rewind(zscan_t* z) {
+    dmn_assert(z);
+    z->scratch_cur = NULL;
+    z->scratch_used = 0;
+}
+
+F_NONNULL F_WUNUSED
+static uint8_t* scratch_alloc(zscan_t* z, const unsigned size) {
+    dmn_assert(z);
+    dmn_assert(size <= SCRATCH_BLOCK);
+
+    if(!z->scratch_cur || z->scratch_used + size > SCRATCH_BLOCK) {
+        scratch_blk_t** next = z->scratch_cur ? &z->scratch_cur->next : &z->scratch;
+        if(!*next) {
+            *next = malloc(sizeof(scratch_blk_t));
+            (*next)->next = NULL;
+        }
+        z->scratch_cur = *next;
+        z->scratch_used = 0;
+    }
+
+    uint8_t* rv = &z->scratch_cur->data[z->scratch_used];
+    z->scratch_used += size;
+    return rv;
+}
+
 /********** TXT ******************/
 
 F_NONNULL
 static void text_start(zscan_t* z) {
     dmn_assert(z);
     z->num_texts = 0;
-    z->texts = NULL;
+    scratch_rewind(z);
+}
+
+F_NONNULL
+static void text_push(zscan_t* z, const uint8_t* chunk) {
+    dmn_assert(z); dmn_assert(chunk);
+    if(z->num_texts + 2U > z->texts_alloc) {
+        z->texts_alloc = z->texts_alloc ? z->texts_alloc << 1U : 16U;
+        z->texts = realloc(z->texts, z->texts_alloc * sizeof(*z->texts));
+    }
+    z->texts[z->num_texts++] = chunk;
+    z->texts[z->num_texts] = NULL;
 }
 
 F_NONNULL
@@ -230,27 +296,25 @@ static void text_add_tok(zscan_t* z, const unsigned len, const bool big_ok) {
         unsigned remainder = newlen % 255;
         unsigned num_whole_chunks = (newlen - remainder) / 255;
         const uint8_t* zptr = text_temp;
-        const unsigned new_alloc = 1 + z->num_texts + num_whole_chunks + (remainder ? 1 : 0);
-        z->texts = realloc(z->texts, new_alloc * sizeof(uint8_t*));
         for(unsigned i = 0; i < num_whole_chunks; i++) {
-            uint8_t* chunk = z->texts[z->num_texts++] = malloc(256);
+            uint8_t* chunk = scratch_alloc(z, 256);
+            text_push(z, chunk);
             *chunk++ = 255;
             memcpy(chunk, zptr, 255);
             zptr += 255;
         }
         if(remainder) {
-            uint8_t* chunk = z->texts[z->num_texts++] = malloc(remainder + 1);
+            uint8_t* chunk = scratch_alloc(z, remainder + 1);
+            text_push(z, chunk);
             *chunk++ = remainder;
             memcpy(chunk, zptr, remainder);
         }
-        z->texts[z->num_texts] = NULL;
     }
     else {
-        z->texts = realloc(z->texts, (z->num_texts + 2) * sizeof(uint8_t*));
-        uint8_t* chunk = z->texts[z->num_texts++] = malloc(newlen + 1);
+        uint8_t* chunk = scratch_alloc(z, newlen + 1);
+        text_push(z, chunk);
         *chunk++ = newlen;
         memcpy(chunk, text_temp, newlen);
-        z->texts[z->num_texts] = NULL;
     }
 
     z->tstart = NULL;
@@ -309,12 +373,145 @@ static void set_dyna(zscan_t* z, const char* fpc) {
     z->tstart = NULL;
 }
 
+// Records are recorded for zsnap as a type byte, the lhs_is_ooz flag,
+//   the LHS dname and TTL, and then the remaining zscan_t fields used
+//   by that type's rec_*() function below.  zscan_rfc1035_replay()
+//   decodes them back into a zscan_t and calls the same rec_*().
+// In a zone journal, each record is preceded by its JOURNAL_* byte.
+#define JOURNAL_ADD 0
+#define JOURNAL_DELETE 1
+
+typedef enum {
+    SNAP_SOA = 0,
+    SNAP_A,
+    SNAP_AAAA,
+    SNAP_NS,
+    SNAP_CNAME,
+    SNAP_PTR,
+    SNAP_MX,
+    SNAP_SRV,
+    SNAP_NAPTR,
+    SNAP_TXT,
+    SNAP_DYNA,
+    SNAP_DYNC,
+    SNAP_RFC3597,
+} snap_op_t;
+
+F_NONNULL
+static void snap_u32(zsnap_buf_t* b, const uint32_t v) {
+    dmn_assert(b);
+    zsnap_buf_append(b, &v, sizeof(v));
+}
+
+F_NONNULL
+static void snap_dname(zsnap_buf_t* b, const uint8_t* dname) {
+    dmn_assert(b); dmn_assert(dname);
+    zsnap_buf_append(b, dname, *dname + 1U);
+}
+
+// DYNA/DYNC resource strings (stored in eml_dname) are NUL-terminated
+F_NONNULL
+static void snap_str(zsnap_buf_t* b, const uint8_t* str) {
+    dmn_assert(b); dmn_assert(str);
+    const uint8_t len = strlen((const char*)str);
+    zsnap_buf_append(b, &len, 1);
+    zsnap_buf_append(b, str, len);
+}
+
+F_NONNULL
+static void snap_texts(zsnap_buf_t* b, const zscan_t* z) {
+    dmn_assert(b); dmn_assert(z);
+    snap_u32(b, z->num_texts);
+    for(unsigned i = 0; i < z->num_texts; i++)
+        zsnap_buf_append(b, z->texts[i], z->texts[i][0] + 1U);
+}
+
+// Returns true if the record is only to be recorded (z->record_only),
+//   in which case the caller must not add it to the zone
+F_NONNULL
+static bool snap_rec(zscan_t* z, const snap_op_t op) {
+    dmn_assert(z);
+
+    zsnap_buf_t* b = z->snap;
+    if(!b)
+        return false;
+
+    if(z->journal)
+        zsnap_buf_append(b, &z->journal_op, 1);
+    const uint8_t hdr[2] = { op, z->lhs_is_ooz };
+    zsnap_buf_append(b, hdr, 2);
+    snap_dname(b, z->lhs_dname);
+    snap_u32(b, z->ttl);
+
+    switch(op) {
+        case SNAP_SOA:
+            snap_dname(b, z->rhs_dname);
+            snap_dname(b, z->eml_dname);
+            snap_u32(b, z->uv_1);
+            snap_u32(b, z->uv_2);
+            snap_u32(b, z->uv_3);
+            snap_u32(b, z->uv_4);
+            snap_u32(b, z->uv_5);
+            break;
+        case SNAP_A:
+            snap_u32(b, z->ipv4);
+            snap_u32(b, z->limit_v4);
+            break;
+        case SNAP_AAAA:
+            zsnap_buf_append(b, z->ipv6, 16);
+            snap_u32(b, z->limit_v6);
+            break;
+        case SNAP_NS:
+        case SNAP_CNAME:
+        case SNAP_PTR:
+            snap_dname(b, z->rhs_dname);
+            break;
+        case SNAP_MX:
+            snap_dname(b, z->rhs_dname);
+            snap_u32(b, z->uv_1);
+            break;
+        case SNAP_SRV:
+            snap_dname(b, z->rhs_dname);
+            snap_u32(b, z->uv_1);
+            snap_u32(b, z->uv_2);
+            snap_u32(b, z->uv_3);
+            break;
+        case SNAP_NAPTR:
+            snap_dname(b, z->rhs_dname);
+            snap_u32(b, z->uv_1);
+            snap_u32(b, z->uv_2);
+            snap_texts(b, z);
+            break;
+        case SNAP_TXT:
+            snap_texts(b, z);
+            break;
+        case SNAP_DYNC:
+            snap_dname(b, z->origin);
+            // fall-through
+        case SNAP_DYNA:
+            snap_str(b, z->eml_dname);
+            snap_u32(b, z->ttl_min);
+            snap_u32(b, z->limit_v4);
+            snap_u32(b, z->limit_v6);
+            break;
+        case SNAP_RFC3597:
+            snap_u32(b, z->uv_1);
+            snap_u32(b, z->rfc3597_data_len);
+            zsnap_buf_append(b, z->rfc3597_data, z->rfc3597_data_len);
+            break;
+    }
+
+    return z->record_only;
+}
+
 F_NONNULL
 static void rec_soa(zscan_t* z) {
     dmn_assert(z);
     validate_lhs_not_ooz(z);
     if(z->lhs_dname[0] != 1)
         parse_error_noargs("SOA record can only be defined for the root of the zone");
+    if(snap_rec(z, SNAP_SOA))
+        return;
     if(ltree_add_rec_soa(z->zone, z->lhs_dname, z->rhs_dname, z->eml_dname, z->ttl, z->uv_1, z->uv_2, z->uv_3, z->uv_4, z->uv_5))
         siglongjmp(z->jbuf, 1);
 }
@@ -322,6 +519,8 @@ static void rec_soa(zscan_t* z) {
 F_NONNULL
 static void rec_a(zscan_t* z) {
     dmn_assert(z);
+    if(snap_rec(z, SNAP_A))
+        return;
     if(ltree_add_rec_a(z->zone, z->lhs_dname, z->ipv4, z->ttl, z->limit_v4, z->lhs_is_ooz))
         siglongjmp(z->jbuf, 1);
 }
@@ -329,6 +528,8 @@ static void rec_a(zscan_t* z) {
 F_NONNULL
 static void rec_aaaa(zscan_t* z) {
     dmn_assert(z);
+    if(snap_rec(z, SNAP_AAAA))
+        return;
     if(ltree_add_rec_aaaa(z->zone, z->lhs_dname, z->ipv6, z->ttl, z->limit_v6, z->lhs_is_ooz))
         siglongjmp(z->jbuf, 1);
 }
@@ -337,6 +538,8 @@ F_NONNULL
 static void rec_ns(zscan_t* z) {
     dmn_assert(z);
     validate_lhs_not_ooz(z);
+    if(snap_rec(z, SNAP_NS))
+        return;
     if(ltree_add_rec_ns(z->zone, z->lhs_dname, z->rhs_dname, z->ttl))
         siglongjmp(z->jbuf, 1);
 }
@@ -345,6 +548,8 @@ F_NONNULL
 static void rec_cname(zscan_t* z) {
     dmn_assert(z);
     validate_lhs_not_ooz(z);
+    if(snap_rec(z, SNAP_CNAME))
+        return;
     if(ltree_add_rec_cname(z->zone, z->lhs_dname, z->rhs_dname, z->ttl))
         siglongjmp(z->jbuf, 1);
 }
@@ -353,6 +558,8 @@ F_NONNULL
 static void rec_ptr(zscan_t* z) {
     dmn_assert(z);
     validate_lhs_not_ooz(z);
+    if(snap_rec(z, SNAP_PTR))
+        return;
     if(ltree_add_rec_ptr(z->zone, z->lhs_dname, z->rhs_dname, z->ttl))
         siglongjmp(z->jbuf, 1);
 }
@@ -361,6 +568,8 @@ F_NONNULL
 static void rec_mx(zscan_t* z) {
     dmn_assert(z);
     validate_lhs_not_ooz(z);
+    if(snap_rec(z, SNAP_MX))
+        return;
     if(ltree_add_rec_mx(z->zone, z->lhs_dname, z->rhs_dname, z->ttl, z->uv_1))
         siglongjmp(z->jbuf, 1);
 }
@@ -369,39 +578,37 @@ F_NONNULL
 static void rec_srv(zscan_t* z) {
     dmn_assert(z);
     validate_lhs_not_ooz(z);
+    if(snap_rec(z, SNAP_SRV))
+        return;
     if(ltree_add_rec_srv(z->zone, z->lhs_dname, z->rhs_dname, z->ttl, z->uv_1, z->uv_2, z->uv_3))
         siglongjmp(z->jbuf, 1);
 }
 
-F_NONNULL
-static void texts_cleanup(zscan_t* z) {
-    dmn_assert(z);
-    free(z->texts);
-    z->texts = NULL;
-    z->num_texts = 0;
-}
-
 F_NONNULL
 static void rec_naptr(zscan_t* z) {
     dmn_assert(z);
     validate_lhs_not_ooz(z);
+    if(snap_rec(z, SNAP_NAPTR))
+        return;
     if(ltree_add_rec_naptr(z->zone, z->lhs_dname, z->rhs_dname, z->ttl, z->uv_1, z->uv_2, z->num_texts, z->texts))
         siglongjmp(z->jbuf, 1);
-    texts_cleanup(z);
 }
 
 F_NONNULL
 static void rec_txt(zscan_t* z) {
     dmn_assert(z);
     validate_lhs_not_ooz(z);
+    if(snap_rec(z, SNAP_TXT))
+        return;
     if(ltree_add_rec_txt(z->zone, z->lhs_dname, z->num_texts, z->texts, z->ttl))
         siglongjmp(z->jbuf, 1);
-    texts_cleanup(z);
 }
 
 F_NONNULL
 static void rec_dyna(zscan_t* z) {
     dmn_assert(z);
+    if(snap_rec(z, SNAP_DYNA))
+        return;
     if(ltree_add_rec_dynaddr(z->zone, z->lhs_dname, z->eml_dname, z->ttl, z->ttl_min, z->limit_v4, z->limit_v6, z->lhs_is_ooz))
         siglongjmp(z->jbuf, 1);
 }
@@ -410,6 +617,8 @@ F_NONNULL
 static void rec_dync(zscan_t* z) {
     dmn_assert(z);
     validate_lhs_not_ooz(z);
+    if(snap_rec(z, SNAP_DYNC))
+        return;
     if(ltree_add_rec_dync(z->zone, z->lhs_dname, z->eml_dname, z->origin, z->ttl, z->ttl_min, z->limit_v4, z->limit_v6))
         siglongjmp(z->jbuf, 1);
 }
@@ -420,17 +629,21 @@ static void rec_rfc3597(zscan_t* z) {
     if(z->rfc3597_data_written < z->rfc3597_data_len)
         parse_error("RFC3597 generic RR claimed rdata length of %u, but only %u bytes of data present", z->rfc3597_data_len, z->rfc3597_data_written);
     validate_lhs_not_ooz(z);
+    if(snap_rec(z, SNAP_RFC3597))
+        return;
     if(ltree_add_rec_rfc3597(z->zone, z->lhs_dname, z->uv_1, z->ttl, z->rfc3597_data_len, z->rfc3597_data))
         siglongjmp(z->jbuf, 1);
-    z->rfc3597_data = NULL;
 }
 
 F_NONNULL
 static void rfc3597_data_setup(zscan_t* z) {
     dmn_assert(z);
+    if(z->uval > 65535U)
+        parse_error("RFC3597 generic RR: rdata length %u too large", z->uval);
     z->rfc3597_data_len = z->uval;
     z->rfc3597_data_written = 0;
-    z->rfc3597_data = malloc(z->uval);
+    scratch_rewind(z);
+    z->rfc3597_data = scratch_alloc(z, z->uval);
 }
 
 F_NONNULL
@@ -457,6 +670,14 @@ static void set_limit_v6(zscan_t* z) {
     z->limit_v6 = z->uval;
 }
 
+F_NONNULL
+static void journal_op(zscan_t* z, const uint8_t op) {
+    dmn_assert(z);
+    if(!z->journal)
+        parse_error_noargs("$ADD and $DELETE are only valid in zone journals");
+    z->journal_op = op;
+}
+
 F_NONNULL
 static void open_paren(zscan_t* z) {
     dmn_assert(z);
@@ -518,6 +739,9 @@ static void close_paren(zscan_t* z) {
     action set_limit_v4 { set_limit_v4(z); }
     action set_limit_v6 { set_limit_v6(z); }
 
+    action journal_add { journal_op(z, JOURNAL_ADD); }
+    action journal_delete { journal_op(z, JOURNAL_DELETE); }
+
     # We re-use eml_dname to store dyna strings
     action set_dyna { set_dyna(z, fpc); }
 
@@ -681,6 +905,8 @@ static void close_paren(zscan_t* z) {
         | ('ORIGIN'i ws dname_rhs %reset_origin)
         | ('ADDR_LIMIT_V4'i ws uval %set_limit_v4)
         | ('ADDR_LIMIT_V6'i ws uval %set_limit_v6)
+        | ('ADD'i %journal_add)
+        | ('DELETE'i %journal_delete)
     );
 
     # A zonefile is composed of many resource records
@@ -691,6 +917,22 @@ static void close_paren(zscan_t* z) {
     write data;
 }%%
 
+// Checks the machine state after a chunk of input (all of it, if "eof")
+F_NONNULLX(1, 3)
+static void scanner_check(zscan_t* z, const int cs, const char* buf, const char* eof) {
+    dmn_assert(z); dmn_assert(buf);
+
+    if(cs == zone_error) {
+        parse_error_noargs("General parse error");
+    }
+    else if(eof && cs < zone_first_final) {
+        if(eof > buf && *(eof - 1) != '\n')
+            parse_error_noargs("Trailing incomplete or unparseable record at end of file (missing newline at end of file?)");
+        else
+            parse_error_noargs("Trailing incomplete or unparseable record at end of file");
+    }
+}
+
 F_NONNULL
 static void scanner(zscan_t* z, char* buf, const unsigned bufsize, const int fd) {
     dmn_assert(z);
@@ -730,45 +972,101 @@ static void scanner(zscan_t* z, char* buf, const unsigned bufsize, const int fd)
             write exec;
         }%%
 
-        if(cs == zone_error) {
-            parse_error_noargs("General parse error");
-        }
-        else if(eof && cs < zone_first_final) {
-            if(eof > buf && *(eof - 1) != '\n')
-                parse_error_noargs("Trailing incomplete or unparseable record at end of file (missing newline at end of file?)");
-            else
-                parse_error_noargs("Trailing incomplete or unparseable record at end of file");
-        }
+        scanner_check(z, cs, buf, eof);
     }
 }
 
+// As above, but the whole file is already mapped into memory at "buf",
+//   so the machine runs over it in one pass with no buffer management.
+F_NONNULL
+static void scanner_mapped(zscan_t* z, const char* buf, const size_t len) {
+    dmn_assert(z); dmn_assert(buf);
+
+    (void)zone_en_main; // silence unused var warning from generated code
+
+    const char* p = buf;
+    const char* pe = buf + len;
+    const char* eof = pe;
+    int cs = zone_start;
+
+    %%{
+        write exec;
+    }%%
+
+    scanner_check(z, cs, buf, eof);
+}
+
+F_NONNULLX(1)
+static zscan_t* zscan_new(zone_t* zone, zsnap_buf_t* snap) {
+    dmn_assert(zone);
+    zscan_t* z = calloc(1, sizeof(zscan_t));
+    z->lcount = 1;
+    z->def_ttl = gconfig.zones_default_ttl;
+    z->zone = zone;
+    z->snap = snap;
+    dname_copy(z->origin, zone->dname);
+    z->lhs_dname[0] = 1; // set lhs to relative origin initially
+    return z;
+}
+
+F_NONNULL
+static void zscan_free(zscan_t* z) {
+    dmn_assert(z);
+    free(z->texts);
+    scratch_blk_t* blk = z->scratch;
+    while(blk) {
+        scratch_blk_t* next = blk->next;
+        free(blk);
+        blk = next;
+    }
+    free(z);
+}
+
 // This is broken out into a separate function (called via
 //   function pointer to eliminate the possibility of
 //   inlining on non-gcc compilers, I hope) to avoid issues with
 //   setjmp and all of the local auto variables in zscan_rfc1035() below.
-typedef bool (*sij_func_t)(zscan_t*,char*,const unsigned,const int);
-F_NONNULL F_NOINLINE
-static bool _scan_isolate_jmp(zscan_t* z, char* buf, const unsigned bufsize, const int fd) {
-    dmn_assert(z); dmn_assert(buf); dmn_assert(fd >= 0);
+// Exactly one of "buf" (for read() from "fd") or "map" is non-NULL.
+typedef bool (*sij_func_t)(zscan_t*,char*,const unsigned,const int,const char*,const size_t);
+F_NONNULLX(1) F_NOINLINE
+static bool _scan_isolate_jmp(zscan_t* z, char* buf, const unsigned bufsize, const int fd, const char* map, const size_t map_len) {
+    dmn_assert(z); dmn_assert(!buf != !map); dmn_assert(fd >= 0);
 
     volatile bool failed = true;
 
-    if(!sigsetjmp(z->jbuf, 0)) {
-        scanner(z, buf, bufsize, fd);
-        failed = false;
-    }
-    else {
-        failed = true;
+    switch(sigsetjmp(z->jbuf, 0)) {
+        case 0:
+            if(map) {
+                // the file can be truncated under the mapping by
+                //   whatever is updating it, which would SIGBUS
+                gdnsd_map_guard(&z->jbuf);
+                scanner_mapped(z, map, map_len);
+            }
+            else {
+                scanner(z, buf, bufsize, fd);
+            }
+            failed = false;
+            break;
+        case GDNSD_MAP_FAULT:
+            log_err("rfc1035: Zone %s: Zonefile was truncated while being read, near line %u", logf_dname(z->zone->dname), z->lcount);
+            break;
+        default: // parse_error() has logged the details
+            break;
     }
 
+    gdnsd_map_guard(NULL);
     return failed;
 }
 
-bool zscan_rfc1035(zone_t* zone, const char* fn) {
+F_NONNULLX(1,2)
+static bool scan_file(zone_t* zone, const char* fn, zsnap_buf_t* snap, const bool record_only, const bool journal) {
     dmn_assert(zone);
     dmn_assert(zone->dname);
     dmn_assert(fn);
-    log_debug("rfc1035: Scanning zone '%s'", logf_dname(zone->dname));
+    dmn_assert(snap || !record_only);
+
+    zprof_mark_t mark;
+    zprof_mark(&mark);
 
     const int fd = open(fn, O_RDONLY);
     if(fd < 0) {
@@ -776,8 +1074,13 @@ bool zscan_rfc1035(zone_t* zone, const char* fn) {
         return true;
     }
 
+    // Regular files are scanned directly from a mapping where
+    //   possible, with the read() buffer as the fallback
+    size_t map_len = 0;
+    const char* map = gdnsd_map_file(fd, &map_len);
+
     unsigned bufsize = MAX_BUFSIZE;
-    {
+    if(!map) {
         struct stat fdstat;
         if(!fstat(fd, &fdstat)) {
 #ifdef HAVE_POSIX_FADVISE
@@ -791,36 +1094,526 @@ bool zscan_rfc1035(zone_t* zone, const char* fn) {
         }
     }
 
-    zscan_t* z = calloc(1, sizeof(zscan_t));
-    z->lcount = 1;
-    z->def_ttl = gconfig.zones_default_ttl;
-    z->zone = zone;
-    dname_copy(z->origin, zone->dname);
-    z->lhs_dname[0] = 1; // set lhs to relative origin initially
+    zscan_t* z = zscan_new(zone, snap);
+    z->record_only = record_only;
+    z->journal = journal;
 
-    char* buf = malloc(bufsize + 1);
-    buf[bufsize] = 0;
+    char* buf = NULL;
+    if(!map) {
+        buf = malloc(bufsize + 1);
+        buf[bufsize] = 0;
+    }
 
     sij_func_t sij = &_scan_isolate_jmp;
-    bool failed = sij(z, buf, bufsize, fd);
+    bool failed = sij(z, buf, bufsize, fd, map, map_len);
+
+    if(map)
+        gdnsd_unmap_file(map, map_len);
 
     if(close(fd)) {
         log_err("rfc1035: Cannot close file '%s': %s", fn, dmn_logf_errno());
         failed = true;
     }
 
-    free(buf);
+    if(buf)
+        free(buf);
+
+    zscan_free(z);
+    zprof_add(&zone->prof, ZPROF_SCAN, &mark);
+
+    return failed;
+}
+
+bool zscan_rfc1035(zone_t* zone, const char* fn, zsnap_buf_t* snap) {
+    dmn_assert(zone); dmn_assert(fn);
+    log_debug("rfc1035: Scanning zone '%s'", logf_dname(zone->dname));
+    return scan_file(zone, fn, snap, false, false);
+}
+
+bool zscan_rfc1035_record(zone_t* zone, const char* fn, zsnap_buf_t* recs, const bool journal) {
+    dmn_assert(zone); dmn_assert(fn); dmn_assert(recs);
+    log_debug("rfc1035: Recording zone %s '%s'", journal ? "journal" : "data", logf_dname(zone->dname));
+    return scan_file(zone, fn, recs, true, journal);
+}
+
+// Replay of zsnap recordings (see snap_rec() above)
+
+typedef struct {
+    const uint8_t* p;
+    const uint8_t* end;
+} snap_cur_t;
+
+F_NONNULL
+static void snap_get(zscan_t* z, snap_cur_t* c, void* out, const size_t len) {
+    dmn_assert(z); dmn_assert(c); dmn_assert(out);
+    if((size_t)(c->end - c->p) < len)
+        parse_error_noargs("Zone snapshot data is truncated");
+    memcpy(out, c->p, len);
+    c->p += len;
+}
+
+F_NONNULL
+static unsigned snap_get_u32(zscan_t* z, snap_cur_t* c) {
+    dmn_assert(z); dmn_assert(c);
+    uint32_t v;
+    snap_get(z, c, &v, sizeof(v));
+    return v;
+}
+
+F_NONNULL
+static void snap_get_dname(zscan_t* z, snap_cur_t* c, uint8_t* dname) {
+    dmn_assert(z); dmn_assert(c); dmn_assert(dname);
+    snap_get(z, c, dname, 1);
+    snap_get(z, c, &dname[1], dname[0]);
+}
+
+F_NONNULL
+static void snap_get_str(zscan_t* z, snap_cur_t* c, uint8_t* str) {
+    dmn_assert(z); dmn_assert(c); dmn_assert(str);
+    uint8_t len;
+    snap_get(z, c, &len, 1);
+    snap_get(z, c, str, len);
+    str[len] = 0;
+}
+
+F_NONNULL
+static void snap_get_texts(zscan_t* z, snap_cur_t* c) {
+    dmn_assert(z); dmn_assert(c);
+    const unsigned num = snap_get_u32(z, c);
+    if(num > (size_t)(c->end - c->p))
+        parse_error_noargs("Zone snapshot data is corrupt");
+    // The recorded chunks are in ltree's own length-prefixed form,
+    //   so they're handed over in place, without copying
+    z->num_texts = 0;
+    for(unsigned i = 0; i < num; i++) {
+        if(c->p == c->end || (size_t)(c->end - c->p) < *c->p + 1U)
+            parse_error_noargs("Zone snapshot data is truncated");
+        text_push(z, c->p);
+        c->p += *c->p + 1U;
+    }
+}
+
+// Decodes and adds the record at the cursor
+F_NONNULL
+static void replay_one(zscan_t* z, snap_cur_t* c) {
+    dmn_assert(z); dmn_assert(c);
+
+    uint8_t hdr[2];
+    snap_get(z, c, hdr, 2);
+    z->lhs_is_ooz = hdr[1];
+    snap_get_dname(z, c, z->lhs_dname);
+    z->ttl = snap_get_u32(z, c);
+
+    switch(hdr[0]) {
+        case SNAP_SOA:
+            snap_get_dname(z, c, z->rhs_dname);
+            snap_get_dname(z, c, z->eml_dname);
+            z->uv_1 = snap_get_u32(z, c);
+            z->uv_2 = snap_get_u32(z, c);
+            z->uv_3 = snap_get_u32(z, c);
+            z->uv_4 = snap_get_u32(z, c);
+            z->uv_5 = snap_get_u32(z, c);
+            rec_soa(z);
+            break;
+        case SNAP_A:
+            z->ipv4 = snap_get_u32(z, c);
+            z->limit_v4 = snap_get_u32(z, c);
+            rec_a(z);
+            break;
+        case SNAP_AAAA:
+            snap_get(z, c, z->ipv6, 16);
+            z->limit_v6 = snap_get_u32(z, c);
+            rec_aaaa(z);
+            break;
+        case SNAP_NS:
+            snap_get_dname(z, c, z->rhs_dname);
+            rec_ns(z);
+            break;
+        case SNAP_CNAME:
+            snap_get_dname(z, c, z->rhs_dname);
+            rec_cname(z);
+            break;
+        case SNAP_PTR:
+            snap_get_dname(z, c, z->rhs_dname);
+            rec_ptr(z);
+            break;
+        case SNAP_MX:
+            snap_get_dname(z, c, z->rhs_dname);
+            z->uv_1 = snap_get_u32(z, c);
+            rec_mx(z);
+            break;
+        case SNAP_SRV:
+            snap_get_dname(z, c, z->rhs_dname);
+            z->uv_1 = snap_get_u32(z, c);
+            z->uv_2 = snap_get_u32(z, c);
+            z->uv_3 = snap_get_u32(z, c);
+            rec_srv(z);
+            break;
+        case SNAP_NAPTR:
+            snap_get_dname(z, c, z->rhs_dname);
+            z->uv_1 = snap_get_u32(z, c);
+            z->uv_2 = snap_get_u32(z, c);
+            snap_get_texts(z, c);
+            rec_naptr(z);
+            break;
+        case SNAP_TXT:
+            snap_get_texts(z, c);
+            rec_txt(z);
+            break;
+        case SNAP_DYNA:
+        case SNAP_DYNC:
+            if(hdr[0] == SNAP_DYNC)
+                snap_get_dname(z, c, z->origin);
+            snap_get_str(z, c, z->eml_dname);
+            z->ttl_min = snap_get_u32(z, c);
+            z->limit_v4 = snap_get_u32(z, c);
+            z->limit_v6 = snap_get_u32(z, c);
+            if(hdr[0] == SNAP_DYNC)
+                rec_dync(z);
+            else
+                rec_dyna(z);
+            break;
+        case SNAP_RFC3597:
+            z->uv_1 = snap_get_u32(z, c);
+            z->rfc3597_data_len = snap_get_u32(z, c);
+            if(z->rfc3597_data_len > (size_t)(c->end - c->p))
+                parse_error_noargs("Zone snapshot data is truncated");
+            if(z->rfc3597_data_len > 65535U)
+                parse_error_noargs("Zone snapshot data is corrupt");
+            scratch_rewind(z);
+            z->rfc3597_data = scratch_alloc(z, z->rfc3597_data_len);
+            snap_get(z, c, z->rfc3597_data, z->rfc3597_data_len);
+            z->rfc3597_data_written = z->rfc3597_data_len;
+            rec_rfc3597(z);
+            break;
+        default:
+            parse_error("Zone snapshot data is corrupt (record type %u)", hdr[0]);
+    }
+}
+
+// Advances the cursor past "len" bytes
+F_NONNULL
+static void snap_skip(zscan_t* z, snap_cur_t* c, const size_t len) {
+    dmn_assert(z); dmn_assert(c);
+    if((size_t)(c->end - c->p) < len)
+        parse_error_noargs("Zone snapshot data is truncated");
+    c->p += len;
+}
 
-    if(z->texts) {
-        for(unsigned i = 0; i < z->num_texts; i++)
-            if(z->texts[i])
-                free(z->texts[i]);
-        free(z->texts);
+// Advances the cursor past a length-prefixed dname, text chunk, or string
+F_NONNULL
+static void snap_skip_counted(zscan_t* z, snap_cur_t* c) {
+    dmn_assert(z); dmn_assert(c);
+    snap_skip(z, c, 1);
+    snap_skip(z, c, c->p[-1]);
+}
+
+// Advances the cursor past one record without decoding it
+F_NONNULL
+static void snap_skip_rec(zscan_t* z, snap_cur_t* c) {
+    dmn_assert(z); dmn_assert(c);
+
+    uint8_t op;
+    snap_get(z, c, &op, 1);
+    snap_skip(z, c, 1); // lhs_is_ooz
+    snap_skip_counted(z, c); // lhs_dname
+    snap_skip(z, c, 4); // ttl
+
+    unsigned count;
+    switch(op) {
+        case SNAP_SOA:
+            snap_skip_counted(z, c);
+            snap_skip_counted(z, c);
+            snap_skip(z, c, 20);
+            break;
+        case SNAP_A:
+            snap_skip(z, c, 8);
+            break;
+        case SNAP_AAAA:
+            snap_skip(z, c, 20);
+            break;
+        case SNAP_NS:
+        case SNAP_CNAME:
+        case SNAP_PTR:
+            snap_skip_counted(z, c);
+            break;
+        case SNAP_MX:
+            snap_skip_counted(z, c);
+            snap_skip(z, c, 4);
+            break;
+        case SNAP_SRV:
+            snap_skip_counted(z, c);
+            snap_skip(z, c, 12);
+            break;
+        case SNAP_NAPTR:
+            snap_skip_counted(z, c);
+            snap_skip(z, c, 8);
+            // fall-through
+        case SNAP_TXT:
+            count = snap_get_u32(z, c);
+            while(count--)
+                snap_skip_counted(z, c);
+            break;
+        case SNAP_DYNC:
+            snap_skip_counted(z, c);
+            // fall-through
+        case SNAP_DYNA:
+            snap_skip_counted(z, c);
+            snap_skip(z, c, 12);
+            break;
+        case SNAP_RFC3597:
+            snap_skip(z, c, 4);
+            snap_skip(z, c, snap_get_u32(z, c));
+            break;
+        default:
+            parse_error("Zone snapshot data is corrupt (record type %u)", op);
+    }
+}
+
+// Journal deletions match records regardless of TTL, so the TTL
+//   bytes (which follow the type, lhs_is_ooz and LHS dname) are
+//   excluded from record hashing and comparison.
+F_NONNULL F_PURE
+static unsigned jrec_ttl_pos(const uint8_t* rec) {
+    dmn_assert(rec);
+    return 3U + rec[2];
+}
+
+F_NONNULL F_PURE
+static uint32_t jrec_hash(const uint8_t* rec, const unsigned len) {
+    dmn_assert(rec);
+    const unsigned tpos = jrec_ttl_pos(rec);
+    return gdnsd_lookup2((const char*)rec, tpos)
+        ^ gdnsd_lookup2((const char*)&rec[tpos + 4U], len - tpos - 4U);
+}
+
+F_NONNULL F_PURE
+static bool jrec_eq(const uint8_t* a, const unsigned a_len, const uint8_t* b, const unsigned b_len) {
+    dmn_assert(a); dmn_assert(b);
+    if(a_len != b_len)
+        return false;
+    const unsigned tpos = jrec_ttl_pos(a);
+    return !memcmp(a, b, tpos)
+        && !memcmp(&a[tpos + 4U], &b[tpos + 4U], a_len - tpos - 4U);
+}
+
+typedef struct {
+    const uint8_t* rec;
+    unsigned len;
+    bool live; // for adds: not deleted again.  for dels: not yet matched
+} jrec_t;
+
+// State for replaying base records with a journal applied.  The
+//   arrays are owned here (rather than by replay()) so that they're
+//   freed whether or not replay() is aborted by a parse error.
+typedef struct {
+    snap_cur_t base;
+    snap_cur_t journal;
+    jrec_t* adds;     // journal additions, in order
+    unsigned num_adds;
+    jrec_t* dels;     // open-addressed table of deletions from base
+    unsigned del_mask;
+} jreplay_t;
+
+// Finds the deletion slot for rec (either a match or an empty slot)
+F_NONNULL
+static jrec_t* jdel_slot(const jreplay_t* jr, const uint8_t* rec, const unsigned len) {
+    dmn_assert(jr); dmn_assert(rec);
+    unsigned slot = jrec_hash(rec, len) & jr->del_mask;
+    unsigned jmpby = 1;
+    while(jr->dels[slot].rec && !jrec_eq(jr->dels[slot].rec, jr->dels[slot].len, rec, len))
+        slot = (slot + jmpby++) & jr->del_mask;
+    return &jr->dels[slot];
+}
+
+// The serial of the recorded SOA record at "rec"
+F_NONNULL
+static unsigned snap_soa_serial(zscan_t* z, const uint8_t* rec, const unsigned len) {
+    dmn_assert(z); dmn_assert(rec);
+    dmn_assert(rec[0] == SNAP_SOA);
+
+    snap_cur_t c = { rec, rec + len };
+    snap_skip(z, &c, 2);
+    snap_skip_counted(z, &c); // lhs
+    snap_skip(z, &c, 4); // ttl
+    snap_skip_counted(z, &c); // master
+    snap_skip_counted(z, &c); // email
+    return snap_get_u32(z, &c);
+}
+
+// RFC 1982 serial number comparison: true if "a" is newer than "b"
+F_CONST
+static bool serial_newer(const uint32_t a, const uint32_t b) {
+    return a != b && (uint32_t)(a - b) < 0x80000000U;
+}
+
+// The journal's operations apply in order: a deletion cancels the
+//   latest matching addition earlier in the journal if there is one,
+//   and otherwise deletes the record from the base data.
+// The journal must add an SOA, which replaces that of the base data,
+//   with a serial newer than the base data's.  Serials are then only
+//   ever set by the files themselves, and move forward with every
+//   change to either of them.  A journal whose SOA serial isn't newer
+//   has been superseded by an update of the zonefile (which should
+//   include the journal's changes), and is ignored.
+F_NONNULL
+static void replay(zscan_t* z, jreplay_t* jr) {
+    dmn_assert(z); dmn_assert(jr);
+
+    if(jr->journal.p == jr->journal.end) {
+        while(jr->base.p < jr->base.end)
+            replay_one(z, &jr->base);
+        return;
+    }
+
+    unsigned count = 0;
+    snap_cur_t* jc = &jr->journal;
+    snap_cur_t counter = *jc;
+    while(counter.p < counter.end) {
+        snap_skip(z, &counter, 1);
+        snap_skip_rec(z, &counter);
+        count++;
+    }
+
+    jr->adds = calloc(count, sizeof(jrec_t));
+    unsigned slots = 16;
+    while(slots < (count << 1))
+        slots <<= 1;
+    jr->del_mask = slots - 1;
+    jr->dels = calloc(slots, sizeof(jrec_t));
+
+    while(jc->p < jc->end) {
+        uint8_t op;
+        snap_get(z, jc, &op, 1);
+        const uint8_t* rec = jc->p;
+        snap_skip_rec(z, jc);
+        const unsigned len = jc->p - rec;
+        if(op == JOURNAL_ADD) {
+            jr->adds[jr->num_adds].rec = rec;
+            jr->adds[jr->num_adds].len = len;
+            jr->adds[jr->num_adds].live = true;
+            jr->num_adds++;
+        }
+        else {
+            unsigned i = jr->num_adds;
+            while(i--)
+                if(jr->adds[i].live && jrec_eq(jr->adds[i].rec, jr->adds[i].len, rec, len))
+                    break;
+            if(i < jr->num_adds) {
+                jr->adds[i].live = false;
+            }
+            else {
+                jrec_t* del = jdel_slot(jr, rec, len);
+                del->rec = rec;
+                del->len = len;
+                del->live = true;
+            }
+        }
+    }
+
+    const jrec_t* jsoa = NULL;
+    for(unsigned i = 0; i < jr->num_adds; i++)
+        if(jr->adds[i].live && jr->adds[i].rec[0] == SNAP_SOA)
+            jsoa = &jr->adds[i];
+    if(!jsoa) {
+        log_err("rfc1035: Zone %s: zone journal does not add an SOA record (with a serial newer than the zonefile's)", logf_dname(z->zone->dname));
+        siglongjmp(z->jbuf, 1);
+    }
+
+    snap_cur_t* bc = &jr->base;
+    snap_cur_t sc = *bc;
+    while(sc.p < sc.end) {
+        const uint8_t* rec = sc.p;
+        snap_skip_rec(z, &sc);
+        if(rec[0] == SNAP_SOA) {
+            const unsigned serial = snap_soa_serial(z, rec, sc.p - rec);
+            const unsigned jserial = snap_soa_serial(z, jsoa->rec, jsoa->len);
+            if(!serial_newer(jserial, serial)) {
+                log_warn("rfc1035: Zone %s: ignoring zone journal with SOA serial %u, which is not newer than the zonefile's serial %u", logf_dname(z->zone->dname), jserial, serial);
+                while(bc->p < bc->end)
+                    replay_one(z, bc);
+                return;
+            }
+            break;
+        }
+    }
+
+
+    while(bc->p < bc->end) {
+        const uint8_t* rec = bc->p;
+        snap_cur_t next = *bc;
+        snap_skip_rec(z, &next);
+        jrec_t* del = jdel_slot(jr, rec, next.p - rec);
+        if(del->rec) {
+            del->live = false;
+            bc->p = next.p;
+        }
+        else if(rec[0] == SNAP_SOA) {
+            bc->p = next.p;
+        }
+        else {
+            replay_one(z, bc);
+        }
+    }
+
+    for(unsigned i = 0; i < jr->num_adds; i++) {
+        if(jr->adds[i].live) {
+            snap_cur_t ac = { jr->adds[i].rec, jr->adds[i].rec + jr->adds[i].len };
+            replay_one(z, &ac);
+        }
+    }
+
+    for(unsigned i = 0; i <= jr->del_mask; i++)
+        if(jr->dels[i].live)
+            log_warn("rfc1035: Zone %s: zone journal deletes a record which does not exist", logf_dname(z->zone->dname));
+}
+
+// As with _scan_isolate_jmp() above
+typedef bool (*rij_func_t)(zscan_t*,jreplay_t*);
+F_NONNULL F_NOINLINE
+static bool _replay_isolate_jmp(zscan_t* z, jreplay_t* jr) {
+    dmn_assert(z); dmn_assert(jr);
+
+    volatile bool failed = true;
+
+    if(!sigsetjmp(z->jbuf, 0)) {
+        replay(z, jr);
+        failed = false;
+    }
+    else {
+        failed = true;
     }
-    if(z->rfc3597_data)
-        free(z->rfc3597_data);
-    free(z);
 
     return failed;
 }
 
+bool zscan_rfc1035_replay(zone_t* zone, const uint8_t* data, const size_t len, const uint8_t* journal, const size_t journal_len) {
+    dmn_assert(zone);
+    dmn_assert(zone->dname);
+    dmn_assert(data || !len);
+    dmn_assert(journal || !journal_len);
+    log_debug("rfc1035: Replaying zone '%s' from recorded data", logf_dname(zone->dname));
+
+    zprof_mark_t mark;
+    zprof_mark(&mark);
+
+    zscan_t* z = zscan_new(zone, NULL);
+    jreplay_t jr;
+    memset(&jr, 0, sizeof(jr));
+    if(data) {
+        jr.base.p = data;
+        jr.base.end = data + len;
+    }
+    if(journal) {
+        jr.journal.p = journal;
+        jr.journal.end = journal + journal_len;
+    }
+    rij_func_t rij = &_replay_isolate_jmp;
+    const bool failed = rij(z, &jr);
+    free(jr.adds);
+    free(jr.dels);
+    zscan_free(z);
+    zprof_add(&zone->prof, ZPROF_SCAN, &mark);
+
+    return failed;
+}
@@ -0,0 +1,315 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "zsnap.h"
+#include "conf.h"
+#include "gdnsd/compiler.h"
+#include "gdnsd/log.h"
+#include "gdnsd/misc.h"
+#include "gdnsd/misc-priv.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// The snapshot file is a zsnap_hdr_t followed by "count" entries,
+//   each of which is a zsnap_ent_t, the NUL-terminated filename, and
+//   the recorded data, padded out to a multiple of 8 bytes.  Integers
+//   are in host byte order; the file is only meant to be used on the
+//   host (and by the build) which compiled it.
+#define ZSNAP_MAGIC "GDNSDZS"
+#define ZSNAP_VERSION 1U
+#define ZSNAP_ENDIAN 0x01020304U
+
+typedef struct {
+    char magic[8];     // ZSNAP_MAGIC
+    uint32_t version;  // ZSNAP_VERSION
+    uint32_t endian;   // ZSNAP_ENDIAN as stored by the writer
+    uint32_t build;    // zsnap_build_hash() of the writer
+    uint32_t count;    // count of entries
+    uint64_t len;      // total file length
+} zsnap_hdr_t;
+
+typedef struct {
+    uint64_t len;      // whole entry, including this header and padding
+    uint64_t m;        // statcmp_t identity of the zonefile...
+    uint64_t i;
+    uint64_t d;
+    uint32_t fn_len;   // filename length, including the NUL
+    uint32_t data_len; // length of the recorded data
+    uint32_t checksum; // gdnsd_lookup2() of filename and data
+    uint32_t pad;
+} zsnap_ent_t;
+
+#define ZSNAP_ALIGN(_x) (((_x) + 7U) & ~((size_t)7U))
+
+// Recordings depend on the parser itself and the config options
+//   which affect parsing, rather than just the zonefile data, so
+//   those are folded into a hash that must match exactly.
+static uint32_t zsnap_build_hash(void) {
+    char desc[128];
+    const int dlen = snprintf(desc, sizeof(desc), "%s %u %u %u",
+        PACKAGE_VERSION, (unsigned)sizeof(void*),
+        gconfig.zones_default_ttl, gconfig.disable_text_autosplit ? 1U : 0U);
+    dmn_assert(dlen > 0 && dlen < (int)sizeof(desc));
+    return gdnsd_lookup2(desc, (uint32_t)dlen);
+}
+
+static uint32_t zsnap_checksum(const char* fn, const unsigned fn_len, const uint8_t* data, const size_t data_len) {
+    const uint32_t fn_hash = gdnsd_lookup2(fn, fn_len);
+    return data_len ? fn_hash ^ gdnsd_lookup2((const char*)data, (uint32_t)data_len) : fn_hash;
+}
+
+void zsnap_buf_append(zsnap_buf_t* buf, const void* data, const size_t len) {
+    dmn_assert(buf); dmn_assert(data || !len);
+    if(buf->len + len > buf->alloc) {
+        if(!buf->alloc)
+            buf->alloc = 256;
+        while(buf->len + len > buf->alloc)
+            buf->alloc <<= 1;
+        buf->data = realloc(buf->data, buf->alloc);
+    }
+    if(len)
+        memcpy(&buf->data[buf->len], data, len);
+    buf->len += len;
+}
+
+void zsnap_buf_free(zsnap_buf_t* buf) {
+    dmn_assert(buf);
+    free(buf->data);
+    buf->data = NULL;
+    buf->len = buf->alloc = 0;
+}
+
+/*** Writer ***/
+
+struct _zsnap_writer_struct {
+    zsnap_buf_t out;
+    unsigned count;
+};
+
+zsnap_writer_t* zsnap_writer_new(void) {
+    zsnap_writer_t* w = calloc(1, sizeof(zsnap_writer_t));
+    const zsnap_hdr_t hdr = { ZSNAP_MAGIC, ZSNAP_VERSION, ZSNAP_ENDIAN, zsnap_build_hash(), 0, 0 };
+    zsnap_buf_append(&w->out, &hdr, sizeof(hdr));
+    return w;
+}
+
+void zsnap_writer_add(zsnap_writer_t* w, const char* fn, const uint64_t m, const uint64_t i, const uint64_t d, const zsnap_buf_t* recs) {
+    dmn_assert(w); dmn_assert(fn); dmn_assert(recs);
+
+    const unsigned fn_len = strlen(fn) + 1;
+    const size_t raw_len = sizeof(zsnap_ent_t) + fn_len + recs->len;
+    const zsnap_ent_t ent = {
+        .len = ZSNAP_ALIGN(raw_len),
+        .m = m,
+        .i = i,
+        .d = d,
+        .fn_len = fn_len,
+        .data_len = (uint32_t)recs->len,
+        .checksum = zsnap_checksum(fn, fn_len, recs->data, recs->len),
+        .pad = 0,
+    };
+    static const uint8_t zeros[8] = { 0 };
+    zsnap_buf_append(&w->out, &ent, sizeof(ent));
+    zsnap_buf_append(&w->out, fn, fn_len);
+    zsnap_buf_append(&w->out, recs->data, recs->len);
+    zsnap_buf_append(&w->out, zeros, ent.len - raw_len);
+    w->count++;
+}
+
+bool zsnap_writer_commit(zsnap_writer_t* w, const char* path) {
+    dmn_assert(w); dmn_assert(path);
+
+    zsnap_hdr_t* hdr = (zsnap_hdr_t*)w->out.data;
+    hdr->count = w->count;
+    hdr->len = w->out.len;
+
+    // written under a temporary name and renamed into place, so that
+    //   a starting daemon never sees a partial snapshot
+    bool failed = true;
+    char* tmp_path = gdnsd_str_combine(path, ".tmp", NULL);
+    const int fd = open(tmp_path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if(fd < 0) {
+        log_err("Cannot open snapshot file '%s' for writing: %s", tmp_path, dmn_logf_errno());
+    }
+    else {
+        const uint8_t* p = w->out.data;
+        size_t left = w->out.len;
+        while(left) {
+            const ssize_t wrv = write(fd, p, left);
+            if(wrv < 0) {
+                if(errno == EINTR)
+                    continue;
+                log_err("Failed to write snapshot file '%s': %s", tmp_path, dmn_logf_errno());
+                break;
+            }
+            p += wrv;
+            left -= (size_t)wrv;
+        }
+        if(!left && fsync(fd))
+            log_err("Failed to fsync snapshot file '%s': %s", tmp_path, dmn_logf_errno());
+        else if(!left)
+            failed = false;
+        if(close(fd)) {
+            log_err("Failed to close snapshot file '%s': %s", tmp_path, dmn_logf_errno());
+            failed = true;
+        }
+        if(!failed && rename(tmp_path, path)) {
+            log_err("Failed to rename snapshot file '%s' to '%s': %s", tmp_path, path, dmn_logf_errno());
+            failed = true;
+        }
+        if(failed)
+            unlink(tmp_path);
+    }
+
+    free(tmp_path);
+    zsnap_buf_free(&w->out);
+    free(w);
+    return failed;
+}
+
+/*** Reader ***/
+
+// Entries are found via an open-addressed hash on filename,
+//   built over the mapped entries when the snapshot is opened.
+struct _zsnap_struct {
+    const char* map;
+    size_t map_len;
+    const zsnap_ent_t** table;
+    unsigned mask;
+};
+
+F_NONNULL
+static const char* ent_fn(const zsnap_ent_t* ent) {
+    return (const char*)ent + sizeof(zsnap_ent_t);
+}
+
+zsnap_t* zsnap_open(const char* path) {
+    dmn_assert(path);
+
+    const int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        if(errno != ENOENT)
+            log_warn("Cannot open zone snapshot '%s' for reading: %s", path, dmn_logf_errno());
+        return NULL;
+    }
+
+    size_t map_len = 0;
+    const char* map = gdnsd_map_file(fd, &map_len);
+    close(fd);
+    if(!map) {
+        log_warn("Cannot map zone snapshot '%s', ignoring it", path);
+        return NULL;
+    }
+
+    const zsnap_hdr_t* hdr = (const zsnap_hdr_t*)map;
+    if(map_len < sizeof(zsnap_hdr_t)
+        || memcmp(hdr->magic, ZSNAP_MAGIC, sizeof(hdr->magic))
+        || hdr->version != ZSNAP_VERSION
+        || hdr->endian != ZSNAP_ENDIAN
+        || hdr->len != map_len
+        || hdr->count > map_len / sizeof(zsnap_ent_t)) {
+        log_warn("Zone snapshot '%s' is invalid or truncated, ignoring it", path);
+        gdnsd_unmap_file(map, map_len);
+        return NULL;
+    }
+    if(hdr->build != zsnap_build_hash()) {
+        log_warn("Zone snapshot '%s' was compiled by a different version or configuration, ignoring it", path);
+        gdnsd_unmap_file(map, map_len);
+        return NULL;
+    }
+
+    zsnap_t* snap = calloc(1, sizeof(zsnap_t));
+    snap->map = map;
+    snap->map_len = map_len;
+    unsigned slots = 16;
+    while(slots < hdr->count * 2U)
+        slots <<= 1;
+    snap->mask = slots - 1;
+    snap->table = calloc(slots, sizeof(zsnap_ent_t*));
+
+    size_t offset = sizeof(zsnap_hdr_t);
+    for(unsigned n = 0; n < hdr->count; n++) {
+        const zsnap_ent_t* ent = (const zsnap_ent_t*)&map[offset];
+        if(map_len - offset < sizeof(zsnap_ent_t)
+            || ent->len > map_len - offset
+            || ent->len < sizeof(zsnap_ent_t) + (uint64_t)ent->fn_len + ent->data_len
+            || ent->len & 7U
+            || !ent->fn_len
+            || ent_fn(ent)[ent->fn_len - 1]) {
+            log_warn("Zone snapshot '%s' is corrupt, ignoring it", path);
+            zsnap_close(snap);
+            return NULL;
+        }
+        unsigned slot = gdnsd_lookup2(ent_fn(ent), ent->fn_len - 1) & snap->mask;
+        unsigned jmpby = 1;
+        while(snap->table[slot]) {
+            slot = (slot + jmpby++) & snap->mask;
+        }
+        snap->table[slot] = ent;
+        offset += ent->len;
+    }
+
+    log_info("Using zone snapshot '%s' with %u zonefiles", path, hdr->count);
+    return snap;
+}
+
+const uint8_t* zsnap_find(const zsnap_t* snap, const char* fn, const uint64_t m, const uint64_t i, const uint64_t d, size_t* len_out) {
+    dmn_assert(snap); dmn_assert(fn); dmn_assert(len_out);
+
+    const unsigned fn_len = strlen(fn) + 1;
+    unsigned slot = gdnsd_lookup2(fn, fn_len - 1) & snap->mask;
+    unsigned jmpby = 1;
+    const zsnap_ent_t* ent;
+    while((ent = snap->table[slot])) {
+        if(ent->fn_len == fn_len && !memcmp(ent_fn(ent), fn, fn_len))
+            break;
+        slot = (slot + jmpby++) & snap->mask;
+    }
+
+    if(!ent) {
+        log_debug("rfc1035: zonefile '%s' is not in the zone snapshot", fn);
+        return NULL;
+    }
+    if(ent->m != m || ent->i != i || ent->d != d) {
+        log_debug("rfc1035: zonefile '%s' has changed since the zone snapshot was compiled", fn);
+        return NULL;
+    }
+
+    const uint8_t* data = (const uint8_t*)ent_fn(ent) + fn_len;
+    if(ent->checksum != zsnap_checksum(fn, fn_len, data, ent->data_len)) {
+        log_warn("rfc1035: zonefile '%s' has a corrupt zone snapshot entry, ignoring it", fn);
+        return NULL;
+    }
+
+    *len_out = ent->data_len;
+    return data;
+}
+
+void zsnap_close(zsnap_t* snap) {
+    dmn_assert(snap);
+    gdnsd_unmap_file(snap->map, snap->map_len);
+    free(snap->table);
+    free(snap);
+}
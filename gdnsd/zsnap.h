@@ -0,0 +1,96 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GDNSD_ZSNAP_H
+#define GDNSD_ZSNAP_H
+
+#include "config.h"
+#include "gdnsd/compiler.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/******************************************************************\
+* zsnap is the compiled snapshot of the rfc1035 zones directory,
+*   written by "gdnsd compile-zones" and used to skip zonefile text
+*   parsing at startup.  For each zonefile it stores the pre-parsed
+*   records (as recorded by zscan_rfc1035(), and replayed into a
+*   fresh zone by zscan_rfc1035_replay()), keyed on the filename and
+*   the same mtime/inode/device identity used for change detection,
+*   with a checksum over each entry.  Any file whose identity doesn't
+*   match its entry (or whose entry fails its checksum) is simply
+*   parsed from its text as usual.
+* The snapshot can't hold the finished ltree itself: while the frozen
+*   block of a zone is otherwise made of relative offsets, it holds
+*   DYNA/DYNC plugin callbacks and (with zones_intern) process-local
+*   intern handles, and the plugin resource mappings must be redone
+*   against the current plugin configuration anyways.
+\******************************************************************/
+
+// Filename of the snapshot within the state directory
+#define ZSNAP_FILE "zones.snap"
+
+// Growable buffer holding one zonefile's recorded records
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t alloc;
+} zsnap_buf_t;
+
+F_NONNULLX(1)
+void zsnap_buf_append(zsnap_buf_t* buf, const void* data, const size_t len);
+F_NONNULL
+void zsnap_buf_free(zsnap_buf_t* buf);
+
+// --- Writing a snapshot ---
+
+typedef struct _zsnap_writer_struct zsnap_writer_t;
+
+F_WUNUSED
+zsnap_writer_t* zsnap_writer_new(void);
+
+// Adds the records "recs" of the zonefile "fn" (relative to the zones
+//   directory), whose identity was m/i/d while they were recorded.
+F_NONNULL
+void zsnap_writer_add(zsnap_writer_t* w, const char* fn, const uint64_t m, const uint64_t i, const uint64_t d, const zsnap_buf_t* recs);
+
+// Writes the snapshot to "path" (atomically replacing any previous
+//   file) and destroys the writer.  Returns true on failure (logged).
+F_NONNULL F_WUNUSED
+bool zsnap_writer_commit(zsnap_writer_t* w, const char* path);
+
+// --- Reading a snapshot ---
+
+typedef struct _zsnap_struct zsnap_t;
+
+// Maps the snapshot at "path" read-only, returning NULL if it doesn't
+//   exist or can't be used (e.g. truncated, or from a different build).
+F_NONNULL F_WUNUSED
+zsnap_t* zsnap_open(const char* path);
+
+// Returns the records for zonefile "fn" if the snapshot has an intact
+//   entry for it with identity m/i/d, with the length in "len_out".
+//   Otherwise returns NULL.  Safe to call from several threads at once.
+F_NONNULL F_WUNUSED
+const uint8_t* zsnap_find(const zsnap_t* snap, const char* fn, const uint64_t m, const uint64_t i, const uint64_t d, size_t* len_out);
+
+F_NONNULL
+void zsnap_close(zsnap_t* snap);
+
+#endif // GDNSD_ZSNAP_H
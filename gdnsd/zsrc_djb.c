@@ -45,7 +45,7 @@ static void unload_zones(void) {
         ztree_txn_end();
 
         for (zscan_djb_zonedata_t* cur = active_zonedata; cur; cur = cur->next)
-            zone_delete(cur->zone);
+            zone_retire(cur->zone);
 
         zscan_djbzone_free(&active_zonedata);
     }
@@ -53,43 +53,49 @@ static void unload_zones(void) {
 
 static void zsrc_djb_sync_zones(void) {
     zscan_djb_zonedata_t* zonedata;
-    int num_zones = 0;
+    unsigned num_zones = 0;
+    unsigned num_changed = 0;
+    unsigned num_removed = 0;
 
-    if (zscan_djb(djb_dir, &zonedata) || (!active_zonedata && !zonedata))
+    if (zscan_djb(djb_dir, active_zonedata, &zonedata) || (!active_zonedata && !zonedata))
         return;
 
-    ztree_txn_start();
-
+    // zones whose data didn't change are already in the ztree as-is
     for (zscan_djb_zonedata_t* cur = zonedata; cur; cur = cur->next) {
-        zscan_djb_zonedata_t* old = zscan_djbzone_get(active_zonedata, cur->zone->dname, 1);
-        if (old) {
-            old->marked = 1;
-            ztree_txn_update(old->zone, cur->zone);
-        } else {
-            ztree_txn_update(NULL, cur->zone);
-        }
+        if (cur->zone != cur->old_zone)
+            num_changed++;
         num_zones++;
     }
 
     for (zscan_djb_zonedata_t* cur = active_zonedata; cur; cur = cur->next)
         if (!cur->marked)
-            ztree_txn_update(cur->zone, NULL);
+            num_removed++;
 
-    ztree_txn_end();
+    if (num_changed || num_removed) {
+        ztree_txn_start();
 
-    // now delete the unused zone_t's that were removed/replaced in the multi-zone
-    //   transaction above.
-    for (zscan_djb_zonedata_t* cur = zonedata; cur; cur = cur->next) {
-        zscan_djb_zonedata_t* old = zscan_djbzone_get(active_zonedata, cur->zone->dname, 1);
-        if (old)
-            zone_delete(old->zone);
-    }
+        for (zscan_djb_zonedata_t* cur = zonedata; cur; cur = cur->next)
+            if (cur->zone != cur->old_zone)
+                ztree_txn_update(cur->old_zone, cur->zone);
 
-    for (zscan_djb_zonedata_t* cur = active_zonedata; cur; cur = cur->next)
-        if (!cur->marked)
-            zone_delete(cur->zone);
+        for (zscan_djb_zonedata_t* cur = active_zonedata; cur; cur = cur->next)
+            if (!cur->marked)
+                ztree_txn_update(cur->zone, NULL);
+
+        ztree_txn_end();
+
+        // now delete the unused zone_t's that were removed/replaced in the multi-zone
+        //   transaction above.
+        for (zscan_djb_zonedata_t* cur = zonedata; cur; cur = cur->next)
+            if (cur->old_zone && cur->zone != cur->old_zone)
+                zone_retire(cur->old_zone);
+
+        for (zscan_djb_zonedata_t* cur = active_zonedata; cur; cur = cur->next)
+            if (!cur->marked)
+                zone_retire(cur->zone);
+    }
 
-    log_info("zsrc_djb: loaded %d zones from %s...", num_zones, djb_dir);
+    log_info("zsrc_djb: loaded %u zones from %s (%u new or changed, %u removed)...", num_zones, djb_dir, num_changed, num_removed);
 
     zscan_djbzone_free(&active_zonedata);
     active_zonedata = zonedata;
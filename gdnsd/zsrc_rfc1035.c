@@ -22,6 +22,7 @@
 #include "gdnsd/log.h"
 #include "gdnsd/paths.h"
 #include "zscan_rfc1035.h"
+#include "zsnap.h"
 #include "conf.h"
 
 #include <sys/types.h>
@@ -31,6 +32,8 @@
 #include <dirent.h>
 #include <stdlib.h>
 #include <time.h>
+#include <pthread.h>
+#include <signal.h>
 
 #include "ztree.h"
 #include "main.h"
@@ -50,6 +53,18 @@ static bool fail_fatally = false;
 static double min_quiesce = 1.02;
 static double full_quiesce = 5.0;
 
+// batching values, from zones_rfc1035_batch and
+//   zones_rfc1035_batch_max.  Both are zero for the
+//   initial load, which is a single batch anyways.
+static double batch_wait = 0.0;
+static double batch_max = 0.0;
+
+// The zone snapshot from "gdnsd compile-zones", which is only
+//   open during the initial load.  snap_hits counts the zonefiles
+//   which were replayed from it rather than parsed.
+static zsnap_t* snap = NULL;
+static unsigned snap_hits = 0;
+
 #ifdef USE_INOTIFY
 
 #include <sys/inotify.h>
@@ -92,13 +107,24 @@ char* rfc1035_dir = NULL;
 //   non-existent (e.g. deleted) file.  The same value is used
 //   to indicate an invalid zonefile (e.g. the pathname is
 //   a subdirectory, a socket, a softlink, etc...)
+// The journal members identify the zonefile's journal the same way,
+//   and are all zero when it has none.
 typedef struct {
-    uint64_t m; // see ztree.h
-    ino_t i;    // st.st_inode
-    dev_t d;    // st.st_dev
+    uint64_t m;  // see ztree.h
+    ino_t i;     // st.st_inode
+    dev_t d;     // st.st_dev
+    uint64_t jm; // journal mtime
+    ino_t ji;    // journal st.st_inode
+    dev_t jd;    // journal st.st_dev
 } statcmp_t;
 
 static bool statcmp_eq(statcmp_t* a, statcmp_t* b) {
+    return !((a->m ^ b->m) | (a->i ^ b->i) | (a->d ^ b->d)
+        | (a->jm ^ b->jm) | (a->ji ^ b->ji) | (a->jd ^ b->jd));
+}
+
+// as above, but for the zonefile alone
+static bool statcmp_file_eq(statcmp_t* a, statcmp_t* b) {
     return !((a->m ^ b->m) | (a->i ^ b->i) | (a->d ^ b->d));
 }
 
@@ -107,24 +133,37 @@ static bool statcmp_nx(statcmp_t* a) {
     return !(a->m | a->i | a->d);
 }
 
+static bool statcmp_has_journal(statcmp_t* a) {
+    return !!(a->jm | a->ji | a->jd);
+}
+
 // represents a zone file
-// on initial load, pending_event is NULL, and thus "pending" is irrelevant
+// on initial load, pending_set is false, and thus "pending" is irrelevant
 // when change detection sees a statcmp diff between "loaded" and the
-//   filesystem, it's going to set pending_event and save the fs info
-//   to "pending", while in many cases a quiescence timer waits for further
+//   filesystem, it's going to set pending_set and save the fs info
+//   to "pending", while in many cases a quiescence period waits for further
 //   updates.
 // when "pending" and the raw FS have stabilized, then the zone is actually
-//   reloaded and "loaded" is set to "pending" values and the update_pending
+//   reloaded and "loaded" is set to "pending" values and the pending_set
 //   flag is cleared.
 typedef struct {
     unsigned hash;       // hash of "fn"
     unsigned generation; // generation counter for deletion checks
     char* full_fn;       // "etc/zones/example.com"
     const char* fn;      // ptr to "example.com" in above storage
+    char* journal_fn;    // "etc/zones/.example.com.journal"
     zone_t* zone;        // zone data
-    ev_timer* pending_event; // pending quiescence timer, NULL if no pending change
+    double pending_at;   // ev_now() time at which the quiescence period ends
+    unsigned pending_idx; // 1-based position in the quiescence heap, 0 if not waiting
+    bool pending_set;    // a change is pending (waiting on quiescence, or on the batch)
+    zone_t* batch_zone;  // replacement for "zone" awaiting the batch, or NULL
+    bool batch_set;      // "batch_zone" (even if NULL) is to be applied by the batch
+    bool batch_parse;    // quiesced "pending" data is to be parsed for the batch
+    bool batched;        // in the batch list for either of the above reasons
     statcmp_t pending;   // lstat() info on pending update
-    statcmp_t loaded;    // lstat() info on loaded data
+    statcmp_t loaded;    // lstat() info on loaded data (or batched, if "batch_set")
+    statcmp_t base_stat; // zonefile identity of "base"
+    zsnap_buf_t base;    // recorded zonefile data, kept only while a journal exists
 } zfile_t;
 
 // hash of all extant zonefiles
@@ -142,15 +181,20 @@ F_NONNULL
 static void zf_delete(zfile_t* zf) {
     dmn_assert(zf);
     if(zf->zone)
-        zone_delete(zf->zone);
+        zone_retire(zf->zone);
+    if(zf->batch_zone)
+        zone_delete(zf->batch_zone);
     if(zf->full_fn)
         free(zf->full_fn);
-    if(zf->pending_event)
-        free(zf->pending_event);
+    if(zf->journal_fn)
+        free(zf->journal_fn);
+    zsnap_buf_free(&zf->base);
     free(zf);
 }
 
-static void statcmp_set(const char* full_fn, statcmp_t* out) {
+// journal_fn may be NULL to ignore any journal
+F_NONNULLX(1, 3)
+static void statcmp_set(const char* full_fn, const char* journal_fn, statcmp_t* out) {
     dmn_assert(full_fn); dmn_assert(out);
 
     struct stat st;
@@ -165,6 +209,17 @@ static void statcmp_set(const char* full_fn, statcmp_t* out) {
         out->i = 0;
         out->d = 0;
     }
+
+    if(journal_fn && !lstat(journal_fn, &st) && S_ISREG(st.st_mode)) {
+        out->jm = get_extended_mtime(&st);
+        out->ji = st.st_ino;
+        out->jd = st.st_dev;
+    }
+    else {
+        out->jm = 0;
+        out->ji = 0;
+        out->jd = 0;
+    }
 }
 
 // grow hash by doubling, while also
@@ -297,6 +352,37 @@ static char* make_zone_name(const char* zf_name) {
     return out;
 }
 
+// A zonefile with a journal is loaded by replaying its recorded data
+//   with the journal's changes applied.  The recording is kept in
+//   zf->base while the journal exists, so that a change to only the
+//   journal is applied without re-reading the zonefile itself.
+F_NONNULLX(1, 2)
+static bool zone_load_journaled(zfile_t* zf, zone_t* z, const uint8_t* snap_data, const size_t snap_len) {
+    dmn_assert(zf); dmn_assert(z);
+
+    zsnap_buf_t jrecs = { NULL, 0, 0 };
+    bool failed = zscan_rfc1035_record(z, zf->journal_fn, &jrecs, true);
+
+    if(!failed && (!zf->base.data || !statcmp_file_eq(&zf->base_stat, &zf->pending))) {
+        zsnap_buf_free(&zf->base);
+        if(snap_data)
+            zsnap_buf_append(&zf->base, snap_data, snap_len);
+        else
+            failed = zscan_rfc1035_record(z, zf->full_fn, &zf->base, false);
+        if(failed)
+            zsnap_buf_free(&zf->base);
+        else
+            memcpy(&zf->base_stat, &zf->pending, sizeof(statcmp_t));
+    }
+
+    if(!failed)
+        failed = zscan_rfc1035_replay(z, zf->base.data, zf->base.len, jrecs.data, jrecs.len)
+            || zone_finalize(z);
+
+    zsnap_buf_free(&jrecs);
+    return failed;
+}
+
 F_NONNULL
 static zone_t* zone_from_zf(zfile_t* zf) {
     dmn_assert(zf);
@@ -305,88 +391,448 @@ static zone_t* zone_from_zf(zfile_t* zf) {
     if(!name)
         return NULL;
 
+    size_t snap_len = 0;
+    const uint8_t* snap_data = snap
+        ? zsnap_find(snap, zf->fn, zf->pending.m, (uint64_t)zf->pending.i, (uint64_t)zf->pending.d, &snap_len)
+        : NULL;
+
     char* src = gdnsd_str_combine("rfc1035:", zf->fn, NULL);
     zone_t* z = zone_new(name, src);
-    free(src);
-    free(name);
 
-    if(z) {
-        if(zscan_rfc1035(z, zf->full_fn) || zone_finalize(z)) {
+    if(z && statcmp_has_journal(&zf->pending)) {
+        if(zone_load_journaled(zf, z, snap_data, snap_len)) {
             zone_delete(z);
             z = NULL;
         }
+        else if(snap_data) {
+            __sync_fetch_and_add(&snap_hits, 1U);
+        }
+        free(src);
+        free(name);
+        return z;
     }
 
+    // without a journal, there's no reason to keep the recording
+    zsnap_buf_free(&zf->base);
+
+    if(z && snap_data) {
+        if(zscan_rfc1035_replay(z, snap_data, snap_len, NULL, 0) || zone_finalize(z)) {
+            log_warn("rfc1035: zonefile '%s': replay from the zone snapshot failed, parsing the zonefile instead", zf->fn);
+            zone_delete(z);
+            z = zone_new(name, src);
+            snap_data = NULL;
+        }
+        else {
+            __sync_fetch_and_add(&snap_hits, 1U);
+        }
+    }
+
+    if(z && !snap_data) {
+        if(zscan_rfc1035(z, zf->full_fn, NULL) || zone_finalize(z)) {
+            zone_delete(z);
+            z = NULL;
+        }
+    }
+
+    free(src);
+    free(name);
     return z;
 }
 
+// Zonefiles are parsed by a pool of zones_rfc1035_threads workers
+//   (the calling thread being one of them), each taking the next
+//   unparsed file from the list until none remain.  Every zone
+//   has its own zone_t and arena, so they parse independently.
+typedef struct {
+    zfile_t** zfs;
+    zone_t** zones;
+    unsigned count;
+    unsigned next;
+} parse_job_t;
+
+F_NONNULL
+static void* parse_worker(void* data) {
+    dmn_assert(data);
+    parse_job_t* job = data;
+    unsigned i;
+    while((i = __sync_fetch_and_add(&job->next, 1U)) < job->count)
+        job->zones[i] = zone_from_zf(job->zfs[i]);
+    return NULL;
+}
+
+F_NONNULL
+static void* parse_thread(void* data) {
+    dmn_assert(data);
+    gdnsd_thread_setname("gdnsd-zparse");
+    return parse_worker(data);
+}
+
+// Parses count zonefiles from zfs into zones (NULL for a failed parse)
+F_NONNULL
+static void parse_zonefiles(zfile_t** zfs, zone_t** zones, const unsigned count) {
+    dmn_assert(zfs); dmn_assert(zones);
+
+    parse_job_t job = { zfs, zones, count, 0 };
+    unsigned nthreads = gconfig.zones_rfc1035_threads;
+    if(nthreads > count)
+        nthreads = count;
+
+    pthread_t threads[nthreads ? nthreads : 1];
+    unsigned started = 0;
+    if(nthreads > 1) {
+        // workers shouldn't ever catch signals meant for the process
+        sigset_t sigmask_all, sigmask_prev;
+        sigfillset(&sigmask_all);
+        pthread_sigmask(SIG_SETMASK, &sigmask_all, &sigmask_prev);
+        while(started < nthreads - 1) {
+            const int pthread_err = pthread_create(&threads[started], NULL, parse_thread, &job);
+            if(pthread_err) {
+                log_err("rfc1035: pthread_create() of zonefile parsing thread failed: %s", dmn_logf_strerror(pthread_err));
+                break;
+            }
+            started++;
+        }
+        pthread_sigmask(SIG_SETMASK, &sigmask_prev, NULL);
+    }
+
+    parse_worker(&job);
+    for(unsigned i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+}
+
+// Zonefiles waiting out a quiescence period are kept in a binary
+//   min-heap ordered by the time their period ends, and a single
+//   shared timer is armed for the earliest of them.  A burst of
+//   changes across a large directory thus costs one heap entry per
+//   file, rather than an ev_timer allocation and registration each.
+static zfile_t** qheap = NULL;
+static unsigned qheap_count = 0;
+static unsigned qheap_alloc = 0;
+static ev_timer* qheap_timer = NULL;
+
+F_NONNULL
+static void quiesce_expire(struct ev_loop* loop, ev_timer* timer, int revents);
+
+F_NONNULL
+static void qheap_place(const unsigned idx, zfile_t* zf) {
+    dmn_assert(zf);
+    qheap[idx] = zf;
+    zf->pending_idx = idx + 1;
+}
+
+// Restores heap order around zf after its pending_at changed, in
+//   whichever direction
 F_NONNULL
-static void quiesce_check(struct ev_loop* loop, ev_timer* timer, int revents V_UNUSED) {
+static void qheap_fix(zfile_t* zf) {
+    dmn_assert(zf); dmn_assert(zf->pending_idx);
+
+    unsigned idx = zf->pending_idx - 1;
+    while(idx) {
+        const unsigned parent = (idx - 1) >> 1;
+        if(qheap[parent]->pending_at <= zf->pending_at)
+            break;
+        qheap_place(idx, qheap[parent]);
+        idx = parent;
+    }
+    while(1) {
+        unsigned child = (idx << 1) + 1;
+        if(child >= qheap_count)
+            break;
+        if(child + 1 < qheap_count && qheap[child + 1]->pending_at < qheap[child]->pending_at)
+            child++;
+        if(zf->pending_at <= qheap[child]->pending_at)
+            break;
+        qheap_place(idx, qheap[child]);
+        idx = child;
+    }
+    qheap_place(idx, zf);
+}
+
+F_NONNULL
+static void qheap_del(zfile_t* zf) {
+    dmn_assert(zf); dmn_assert(zf->pending_idx);
+
+    const unsigned idx = zf->pending_idx - 1;
+    zf->pending_idx = 0;
+    qheap_count--;
+    if(idx < qheap_count) {
+        zfile_t* last = qheap[qheap_count];
+        qheap_place(idx, last);
+        qheap_fix(last);
+    }
+}
+
+// (Re-)arm the shared timer for the top of the heap
+F_NONNULL
+static void qheap_arm(struct ev_loop* loop) {
+    dmn_assert(loop); dmn_assert(qheap_timer);
+
+    ev_timer_stop(loop, qheap_timer);
+    if(qheap_count) {
+        double wait = qheap[0]->pending_at - ev_now(loop);
+        if(wait < 0.)
+            wait = 0.;
+        ev_timer_set(qheap_timer, wait, 0.);
+        ev_timer_start(loop, qheap_timer);
+    }
+}
+
+// (Re-)start the quiescence period of a pending change, ending
+//   "wait" seconds from now
+F_NONNULL
+static void quiesce_start(struct ev_loop* loop, zfile_t* zf, const double wait) {
+    dmn_assert(loop); dmn_assert(zf);
+
+    zf->pending_set = true;
+    zf->pending_at = ev_now(loop) + wait;
+    if(zf->pending_idx) {
+        qheap_fix(zf);
+    }
+    else {
+        if(qheap_count == qheap_alloc) {
+            qheap_alloc = qheap_alloc ? qheap_alloc << 1 : 16;
+            qheap = realloc(qheap, qheap_alloc * sizeof(zfile_t*));
+        }
+        qheap_place(qheap_count++, zf);
+        qheap_fix(zf);
+    }
+
+    if(!qheap_timer) {
+        qheap_timer = malloc(sizeof(ev_timer));
+        ev_timer_init(qheap_timer, quiesce_expire, 0., 0.);
+    }
+    // If zf was moved down from the top, the timer is left to expire
+    //   early, and quiesce_expire() re-arms it for the new top.
+    if(qheap[0] == zf || !ev_is_active(qheap_timer))
+        qheap_arm(loop);
+}
+
+// Zonefiles whose quiescence periods have completed are not parsed and
+//   applied to the runtime ztree one at a time.  Instead they're
+//   collected in the batch list below.  Once no new zonefile has
+//   quiesced for batch_wait seconds (or at most batch_max seconds
+//   after the first one joined), the batch is parsed in parallel and
+//   applied as a single ztree transaction.
+static zfile_t** batch_list = NULL;
+static unsigned batch_count = 0;
+static unsigned batch_alloc = 0;
+static double batch_start = 0.;
+static ev_timer* batch_timer = NULL;
+
+// Parse the batch members whose quiesced data still matches the
+//   filesystem, and convert successful results into batch_set changes
+F_NONNULL
+static void batch_parse(struct ev_loop* loop) {
     dmn_assert(loop);
-    dmn_assert(timer);
-    dmn_assert(revents == EV_TIMER);
 
-    zfile_t* zf = (zfile_t*)timer->data;
-    dmn_assert(zf->pending_event == timer);
+    zfile_t** zfs = malloc(batch_count * sizeof(zfile_t*));
+    unsigned count = 0;
+    for(unsigned i = 0; i < batch_count; i++) {
+        zfile_t* zf = batch_list[i];
+        if(zf->batch_parse) {
+            zf->batch_parse = false;
+            // if quiescence was restarted by a newer change, it will
+            //   requeue the file when it quiesces again
+            if(!zf->pending_idx)
+                zfs[count++] = zf;
+        }
+    }
+
+    zone_t** zones = malloc((count ? count : 1) * sizeof(zone_t*));
+    parse_zonefiles(zfs, zones, count);
+
+    for(unsigned i = 0; i < count; i++) {
+        zfile_t* zf = zfs[i];
+        zone_t* z = zones[i];
+        // re-check that file didn't change while loading
+        statcmp_t post_check;
+        statcmp_set(zf->full_fn, zf->journal_fn, &post_check);
+        if(!statcmp_eq(&zf->pending, &post_check)) {
+            log_debug("rfc1035: zonefile '%s': lstat() changed during zonefile parsing, restarting timer for %.3g seconds...", zf->fn, full_quiesce);
+            if(z)
+                 zone_delete(z);
+            quiesce_start(loop, zf, full_quiesce);
+            continue;
+        }
+
+        if(z) {
+            log_debug("rfc1035: zonefile '%s': new zone data being added/updated for runtime...", zf->fn);
+            memcpy(&zf->loaded, &zf->pending, sizeof(statcmp_t));
+            z->mtime = zf->loaded.m;
+            if(zf->batch_zone)
+                zone_delete(zf->batch_zone);
+            zf->batch_zone = z;
+            zf->batch_set = true;
+        }
+        else {
+            if(fail_fatally)
+                log_fatal("rfc1035: Cannot load zonefile '%s', failing", zf->fn);
+            log_debug("rfc1035: zonefile '%s': zone parsing failed while lstat() info remained stable, dropping event, awaiting further fresh FS notification to try new syntax fixes...", zf->fn);
+        }
+        zf->pending_set = false;
+    }
+
+    free(zones);
+    free(zfs);
+}
+
+F_NONNULL
+static void batch_apply(struct ev_loop* loop, ev_timer* timer V_UNUSED, int revents V_UNUSED) {
+    dmn_assert(loop);
+    dmn_assert(timer == batch_timer);
+    dmn_assert(batch_count);
+
+    batch_parse(loop);
+
+    unsigned changes = 0;
+    for(unsigned i = 0; i < batch_count; i++) {
+        const zfile_t* zf = batch_list[i];
+        if(zf->batch_set && (zf->zone || zf->batch_zone))
+            changes++;
+    }
+
+    // A lone change doesn't need the cost of a ztree clone
+    const bool use_txn = changes > 1;
+    if(use_txn)
+        ztree_txn_start();
+    for(unsigned i = 0; i < batch_count; i++) {
+        zfile_t* zf = batch_list[i];
+        if(zf->batch_set && (zf->zone || zf->batch_zone)) {
+            if(use_txn)
+                ztree_txn_update(zf->zone, zf->batch_zone);
+            else
+                ztree_update(zf->zone, zf->batch_zone);
+        }
+    }
+    if(use_txn)
+        ztree_txn_end();
+
+    for(unsigned i = 0; i < batch_count; i++) {
+        zfile_t* zf = batch_list[i];
+        zf->batched = false;
+        if(!zf->batch_set)
+            continue;
+        if(zf->zone)
+            zone_retire(zf->zone);
+        zf->zone = zf->batch_zone;
+        zf->batch_zone = NULL;
+        zf->batch_set = false;
+        // a batched deletion is final unless the file has since reappeared
+        if(statcmp_nx(&zf->loaded) && !zf->pending_set)
+            zfhash_del(zf);
+    }
+
+    log_debug("rfc1035: applied a batch of %u zonefile change(s) to runtime", changes);
+    batch_count = 0;
+}
+
+// Add a zonefile to the pending batch (if it isn't already a member),
+//   and (re-)arm the batch timer.
+F_NONNULL
+static void batch_queue(struct ev_loop* loop, zfile_t* zf) {
+    dmn_assert(loop); dmn_assert(zf);
+
+    if(zf->batched)
+        return;
+    zf->batched = true;
+    if(batch_count == batch_alloc) {
+        batch_alloc = batch_alloc ? batch_alloc << 1 : 16;
+        batch_list = realloc(batch_list, batch_alloc * sizeof(zfile_t*));
+    }
+    batch_list[batch_count++] = zf;
+
+    if(!batch_timer) {
+        batch_timer = malloc(sizeof(ev_timer));
+        ev_timer_init(batch_timer, batch_apply, 0., 0.);
+    }
+    const double now = ev_now(loop);
+    if(batch_count == 1)
+        batch_start = now;
+    double wait = batch_wait;
+    if(now + wait > batch_start + batch_max)
+        wait = batch_start + batch_max - now;
+    if(wait < 0.)
+        wait = 0.;
+    ev_timer_stop(loop, batch_timer);
+    ev_timer_set(batch_timer, wait, 0.);
+    ev_timer_start(loop, batch_timer);
+}
+
+F_NONNULL
+static void quiesce_check(struct ev_loop* loop, zfile_t* zf) {
+    dmn_assert(loop); dmn_assert(zf);
+    dmn_assert(zf->pending_set); dmn_assert(!zf->pending_idx);
 
     // check lstat() again for a new change during quiesce period
     statcmp_t newstat;
-    statcmp_set(zf->full_fn, &newstat);
+    statcmp_set(zf->full_fn, zf->journal_fn, &newstat);
 
     // if it stayed stable...
     if(statcmp_eq(&newstat, &zf->pending)) {
         // stable delete
         if(statcmp_nx(&newstat)) {
-            if(zf->zone) {
-                log_debug("rfc1035: zonefile '%s' quiesce timer: acting on deletion, removing zone data from runtime...", zf->fn);
-                dmn_assert(!statcmp_nx(&zf->loaded));
-                ztree_update(zf->zone, NULL);
+            zf->pending_set = false;
+            zf->batch_parse = false;
+            if(zf->zone || zf->batched) {
+                log_debug("rfc1035: zonefile '%s' quiesce timer: acting on deletion, queueing removal of zone data from runtime...", zf->fn);
+                memcpy(&zf->loaded, &zf->pending, sizeof(statcmp_t));
+                if(zf->batch_zone)
+                    zone_delete(zf->batch_zone);
+                zf->batch_zone = NULL;
+                zf->batch_set = true;
+                batch_queue(loop, zf);
             }
             else {
                 log_debug("rfc1035: zonefile '%s' quiesce timer: processing delete without runtime effects (add->remove before quiescence ended?)", zf->fn);
+                zfhash_del(zf);
             }
-            zfhash_del(zf);
         }
-        // quiesced state isn't deleted, we need to load data
+        // quiesced state isn't deleted, queue it to be loaded with the batch
         else {
-            zone_t* z = zone_from_zf(zf);
-            // re-check that file didn't change while loading
-            statcmp_t post_check;
-            statcmp_set(zf->full_fn, &post_check);
-            if(!statcmp_eq(&zf->pending, &post_check)) {
-                log_debug("rfc1035: zonefile '%s' quiesce timer: lstat() changed during zonefile parsing, restarting timer for %.3g seconds...", zf->fn, full_quiesce);
-                if(z)
-                     zone_delete(z);
-                ev_timer_set(timer, full_quiesce, 0.);
-                ev_timer_start(loop, timer);
-            }
-            else {
-                if(z) {
-                    log_debug("rfc1035: zonefile '%s' quiesce timer: new zone data being added/updated for runtime...", zf->fn);
-                    memcpy(&zf->loaded, &zf->pending, sizeof(statcmp_t));
-                    z->mtime = zf->loaded.m;
-                    ztree_update(zf->zone, z);
-                    if(zf->zone)
-                        zone_delete(zf->zone);
-                    zf->zone = z;
-                }
-                else {
-                    if(fail_fatally)
-                        log_fatal("rfc1035: Cannot load zonefile '%s', failing", zf->fn);
-                    log_debug("rfc1035: zonefile '%s' quiesce timer: zone parsing failed while lstat() info remained stable, dropping event, awaiting further fresh FS notification to try new syntax fixes...", zf->fn);
-                }
-                free(zf->pending_event);
-                zf->pending_event = NULL;
-            }
+            log_debug("rfc1035: zonefile '%s' quiesce timer: queueing zonefile to be loaded...", zf->fn);
+            zf->batch_parse = true;
+            batch_queue(loop, zf);
         }
     }
     else {
         log_debug("rfc1035: zonefile '%s' quiesce timer: lstat() changed again, restarting timer for %.3g seconds...", zf->fn, full_quiesce);
-        ev_timer_set(timer, full_quiesce, 0.);
-        ev_timer_start(loop, timer);
+        quiesce_start(loop, zf, full_quiesce);
     }
 }
 
+// The shared quiescence timer has expired for (at least) the file at
+//   the top of the heap.  Everything that's due is collected before
+//   any of it is checked, as quiesce_check() can restart a file's
+//   period, and with a zero quiesce time that must wait for the next
+//   loop iteration rather than spinning here.
+F_NONNULL
+static void quiesce_expire(struct ev_loop* loop, ev_timer* timer V_UNUSED, int revents V_UNUSED) {
+    dmn_assert(loop);
+    dmn_assert(timer == qheap_timer);
+    dmn_assert(revents == EV_TIMER);
+
+    // The timer was armed for "pending_at - ev_now()" seconds, and
+    //   ev_now() is now the time cached at the start of this loop
+    //   iteration.  Floating-point rounding in that round trip (and
+    //   libev's periodic re-estimate of its realtime offset) can leave
+    //   it a hair short of a pending_at which is in fact due, so allow
+    //   1ms rather than re-arming a near-zero timer for the remainder.
+    const double due_by = ev_now(loop) + 0.001;
+    zfile_t** due = malloc((qheap_count ? qheap_count : 1) * sizeof(zfile_t*));
+    unsigned due_count = 0;
+    while(qheap_count && qheap[0]->pending_at <= due_by) {
+        zfile_t* zf = qheap[0];
+        qheap_del(zf);
+        due[due_count++] = zf;
+    }
+
+    for(unsigned i = 0; i < due_count; i++)
+        quiesce_check(loop, due[i]);
+    free(due);
+
+    qheap_arm(loop);
+}
+
 F_NONNULL
 static void process_zonefile(const char* zfn, struct ev_loop* loop, const double initial_quiesce_time) {
     dmn_assert(zfn);
@@ -394,24 +840,29 @@ static void process_zonefile(const char* zfn, struct ev_loop* loop, const double
 
     const char* fn;
     char* full_fn = gdnsd_str_combine(rfc1035_dir, zfn, &fn);
+    zfile_t* current_zft = zfhash_find(fn);
+    char* journal_fn = current_zft
+        ? NULL
+        : gdnsd_str_combine_n(4, rfc1035_dir, ".", fn, ".journal");
 
     statcmp_t newstat;
-    statcmp_set(full_fn, &newstat);
-    zfile_t* current_zft = zfhash_find(fn);
+    statcmp_set(full_fn, current_zft ? current_zft->journal_fn : journal_fn, &newstat);
 
     if(!statcmp_nx(&newstat) && !current_zft) {
         // file was found, but previously unknown to the zfhash
         current_zft = calloc(1, sizeof(zfile_t));
         current_zft->full_fn = full_fn;
         current_zft->fn = fn;
+        current_zft->journal_fn = journal_fn;
         current_zft->hash = gdnsd_lookup2(fn, strlen(fn));
         zfhash_add(current_zft);
     }
     else {
-        // else we don't need this new copy of the full fn,
-        //   it's already there in the current_zft
+        // else we don't need these new copies of the full fn
+        //   and journal fn, they're already there in the current_zft
         dmn_assert(!current_zft || !strcmp(current_zft->full_fn, full_fn));
         free(full_fn);
+        free(journal_fn);
     }
 
     // the outer if-block here on the rest of this code means
@@ -423,13 +874,11 @@ static void process_zonefile(const char* zfn, struct ev_loop* loop, const double
         //   by scandir() is what keeps check_missing() from thinking
         //   this zfile_t*'s target was deleted from the filesystem.
         current_zft->generation = generation;
-        if(current_zft->pending_event) { // we already had a pending change
+        if(current_zft->pending_set) { // we already had a pending change
             if(!statcmp_eq(&newstat, &current_zft->pending)) { // but it changed again!
                 log_debug("rfc1035: Change detected for already-pending zonefile '%s', delaying %.3g secs for further changes...", current_zft->fn, full_quiesce);
                 memcpy(&current_zft->pending, &newstat, sizeof(statcmp_t));
-                ev_timer_stop(loop, current_zft->pending_event);
-                ev_timer_set(current_zft->pending_event, full_quiesce, 0.);
-                ev_timer_start(loop, current_zft->pending_event);
+                quiesce_start(loop, current_zft, full_quiesce);
             }
             // else (if pending state has not changed) let timer continue as it was...
             //   (spurious notification of already-detected change)
@@ -440,15 +889,16 @@ static void process_zonefile(const char* zfn, struct ev_loop* loop, const double
             else
                 log_debug("rfc1035: New change detected for stable zonefile '%s', delaying %.3g secs for further changes...", current_zft->fn, initial_quiesce_time);
             memcpy(&current_zft->pending, &newstat, sizeof(statcmp_t));
-            current_zft->pending_event = malloc(sizeof(ev_timer));
-            ev_timer_init(current_zft->pending_event, quiesce_check, initial_quiesce_time, 0.);
-            current_zft->pending_event->data = current_zft;
-            ev_timer_start(loop, current_zft->pending_event);
+            quiesce_start(loop, current_zft, initial_quiesce_time);
         }
     }
 }
 
 static void unload_zones(void) {
+    free(batch_list);
+    free(batch_timer);
+    free(qheap);
+    free(qheap_timer);
     for(unsigned i = 0; i < zfhash_alloc; i++) {
         zfile_t* zf = zfhash[i];
         if(SLOT_REAL(zf)) {
@@ -459,6 +909,20 @@ static void unload_zones(void) {
     }
 }
 
+// The zonefile name for a zone journal's name, e.g. "example.com"
+//   for ".example.com.journal", or NULL if fname isn't one.
+F_NONNULL
+static char* journal_zfn(const char* fname) {
+    dmn_assert(fname);
+    const size_t len = strlen(fname);
+    if(len < 10 || fname[0] != '.' || fname[1] == '.' || strcmp(&fname[len - 8], ".journal"))
+        return NULL;
+    char* zfn = malloc(len - 8);
+    memcpy(zfn, &fname[1], len - 9);
+    zfn[len - 9] = '\0';
+    return zfn;
+}
+
 static void scan_dir(struct ev_loop* loop, double initial_quiesce_time) {
     DIR* zdhandle = opendir(rfc1035_dir);
     if(!zdhandle) {
@@ -504,12 +968,56 @@ static void do_scandir(struct ev_loop* loop) {
     check_missing(loop);
 }
 
+// The identity of the zones directory itself as of the last
+//   zones_rfc1035_fast_scan scan, if it can be trusted to show
+//   any later change.
+static bool dir_seen_valid = false;
+static uint64_t dir_seen_m = 0;
+static ino_t dir_seen_i = 0;
+static dev_t dir_seen_d = 0;
+
+// For zones_rfc1035_fast_scan: creating, removing, or renaming any
+//   name in the directory updates its mtime, so a directory whose
+//   identity hasn't changed since the last scan is skipped without
+//   reading it at all.  Otherwise, it's a normal full scan.
+F_NONNULL
+static void do_fast_scandir(struct ev_loop* loop) {
+    dmn_assert(loop);
+
+    struct stat st;
+    if(stat(rfc1035_dir, &st)) {
+        log_err("rfc1035: Cannot stat zones directory '%s': %s", rfc1035_dir, dmn_logf_errno());
+        dir_seen_valid = false;
+        do_scandir(loop);
+        return;
+    }
+
+    const uint64_t m = get_extended_mtime(&st);
+    if(dir_seen_valid && m == dir_seen_m && st.st_ino == dir_seen_i && st.st_dev == dir_seen_d) {
+        log_debug("rfc1035: zones directory unchanged, skipping scan");
+        return;
+    }
+
+    // With coarse filesystem timestamps, a directory modified within
+    //   the last couple of seconds could be modified again without any
+    //   visible change, so it's not trusted until a later scan.
+    dir_seen_valid = ((uint64_t)st.st_mtime + 2U < (uint64_t)time(NULL));
+    dir_seen_m = m;
+    dir_seen_i = st.st_ino;
+    dir_seen_d = st.st_dev;
+
+    do_scandir(loop);
+}
+
 F_NONNULL
 static void periodic_scan(struct ev_loop* loop, ev_timer* rtimer V_UNUSED, int revents V_UNUSED) {
     dmn_assert(loop);
     dmn_assert(rtimer);
     dmn_assert(revents == EV_TIMER);
-    do_scandir(loop);
+    if(gconfig.zones_rfc1035_fast_scan)
+        do_fast_scandir(loop);
+    else
+        do_scandir(loop);
 }
 
 // ev stuff
@@ -703,6 +1211,15 @@ static bool inot_process_event(struct ev_loop* loop, const char* fname, uint32_t
             delay = full_quiesce;
         process_zonefile(fname, loop, delay);
     }
+    else { // dotfiles are skipped, other than zone journals
+        char* zfn = journal_zfn(fname);
+        if(zfn) {
+            log_debug("rfc1035: inotified for zone journal: %s event: %s", fname, logf_inmask(emask));
+            // journal writers are expected to rename(2) into place
+            process_zonefile(zfn, loop, (emask & (IN_CREATE|IN_MODIFY|IN_CLOSE_WRITE|IN_ATTRIB)) ? full_quiesce : min_quiesce);
+            free(zfn);
+        }
+    }
 
     return rv;
 }
@@ -851,6 +1368,16 @@ static void set_quiesce(void) {
     }
 }
 
+static void set_batch(void) {
+    batch_wait = gconfig.zones_rfc1035_batch;
+    batch_max = (batch_wait > gconfig.zones_rfc1035_batch_max)
+        ? batch_wait
+        : gconfig.zones_rfc1035_batch_max;
+    if(getenv("GDNSD_TESTSUITE_NO_ZONEFILE_MODS"))
+        batch_wait = batch_max = 0.0;
+    log_info("rfc1035: change batching times are %.3g wait, %.3g max", batch_wait, batch_max);
+}
+
 /*************************/
 /*** Public interfaces ***/
 /*************************/
@@ -870,6 +1397,13 @@ void zsrc_rfc1035_load_zones(const bool check_only) {
         inotify_initial_setup(); // no-op if no compile-time support
     if(gconfig.zones_strict_startup)
         fail_fatally = true;
+    // checkconf always validates the zonefile text itself
+    if(!check_only) {
+        char* snap_fn = gdnsd_resolve_path_state(ZSNAP_FILE, NULL);
+        snap = zsnap_open(snap_fn);
+        free(snap_fn);
+    }
+
     struct ev_loop* temp_load_loop = ev_loop_new(EVFLAG_AUTO);
     scan_dir(temp_load_loop, min_quiesce);
     ev_run(temp_load_loop, 0);
@@ -878,9 +1412,70 @@ void zsrc_rfc1035_load_zones(const bool check_only) {
     fail_fatally = false;
     gdnsd_atexit_debug(unload_zones);
 
+    if(snap) {
+        zsnap_close(snap);
+        snap = NULL;
+        log_info("rfc1035: %u zonefiles were loaded from the zone snapshot", snap_hits);
+    }
+
     log_info("rfc1035: Loaded %u zonefiles from '%s'", zfhash_count, rfc1035_dir);
 }
 
+void zsrc_rfc1035_compile_zones(void) {
+    dmn_assert(!rfc1035_dir);
+
+    rfc1035_dir = gdnsd_resolve_path_cfg("zones/", NULL);
+    char* snap_fn = gdnsd_resolve_path_state(ZSNAP_FILE, NULL);
+    zsnap_writer_t* w = zsnap_writer_new();
+    unsigned count = 0;
+
+    DIR* zdhandle = opendir(rfc1035_dir);
+    if(!zdhandle)
+        log_fatal("rfc1035: Cannot open zones directory '%s': %s", rfc1035_dir, dmn_logf_strerror(errno));
+
+    struct dirent* zfdi;
+    while((zfdi = readdir(zdhandle))) {
+        if(zfdi->d_name[0] == '.')
+            continue;
+        const char* fn;
+        char* full_fn = gdnsd_str_combine(rfc1035_dir, zfdi->d_name, &fn);
+
+        // the identity recorded is the one which held for the whole
+        //   parse, exactly as for runtime change detection
+        statcmp_t pre_check;
+        statcmp_set(full_fn, NULL, &pre_check);
+        if(!statcmp_nx(&pre_check)) {
+            char* name = make_zone_name(fn);
+            if(!name)
+                log_fatal("rfc1035: Cannot compile zonefile '%s'", fn);
+            char* src = gdnsd_str_combine("rfc1035:", fn, NULL);
+            zone_t* z = zone_new(name, src);
+            zsnap_buf_t recs = { NULL, 0, 0 };
+            if(!z || zscan_rfc1035(z, full_fn, &recs) || zone_finalize(z))
+                log_fatal("rfc1035: Cannot compile zonefile '%s'", fn);
+            statcmp_t post_check;
+            statcmp_set(full_fn, NULL, &post_check);
+            if(!statcmp_eq(&pre_check, &post_check))
+                log_fatal("rfc1035: zonefile '%s' changed while it was being compiled", fn);
+            zsnap_writer_add(w, fn, pre_check.m, (uint64_t)pre_check.i, (uint64_t)pre_check.d, &recs);
+            zsnap_buf_free(&recs);
+            zone_delete(z);
+            free(src);
+            free(name);
+            count++;
+        }
+        free(full_fn);
+    }
+
+    if(closedir(zdhandle))
+        log_err("rfc1035: closedir(%s) failed: %s", rfc1035_dir, dmn_logf_strerror(errno));
+
+    if(zsnap_writer_commit(w, snap_fn))
+        log_fatal("rfc1035: Failed to write zone snapshot '%s'", snap_fn);
+    log_info("rfc1035: Compiled %u zonefiles from '%s' into zone snapshot '%s'", count, rfc1035_dir, snap_fn);
+    free(snap_fn);
+}
+
 // we track the loop here for the async sighup request
 static struct ev_loop* zones_loop = NULL;
 static ev_async* sighup_waker = NULL;
@@ -907,6 +1502,7 @@ void zsrc_rfc1035_runtime_init(struct ev_loop* loop) {
     ev_async_init(sighup_waker, sighup_cb);
     ev_async_start(loop, sighup_waker);
 
+    set_batch();
     if(gconfig.zones_rfc1035_auto)
         initial_run(zones_loop);
 }
@@ -27,6 +27,11 @@
 
 void zsrc_rfc1035_load_zones(const bool check_only);
 
+// Parses every zonefile and writes the results to the zone snapshot
+//   (see zsnap.h) for use by later zsrc_rfc1035_load_zones() calls.
+//   Any failure is fatal.
+void zsrc_rfc1035_compile_zones(void);
+
 F_NONNULL
 void zsrc_rfc1035_runtime_init(struct ev_loop* loop);
 
@@ -0,0 +1,449 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "zsrc_tmpl.h"
+#include "zscan_rfc1035.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "conf.h"
+#include "ltree.h"
+#include "main.h"
+#include "gdnsd/log.h"
+#include "gdnsd/misc.h"
+#include "gdnsd/paths.h"
+
+// Template zones: for each file NAME.tmpl in the templates directory,
+//   a zonefile written relative to a placeholder origin, NAME.zones
+//   lists the zone names (one per line, '#' comments) to be served
+//   from it.  The template is parsed once, and every listed zone
+//   shares its frozen tree (see zone_new_attached()).
+
+#define TMPL_SUFFIX ".tmpl"
+#define ZONES_SUFFIX ".zones"
+
+typedef struct {
+    char* name;      // "parked" for parked.tmpl
+    uint64_t mtime;  // latest of the .tmpl and .zones mtimes
+    zone_t** zones;  // attached zones
+    unsigned count;
+} tmpl_t;
+
+static struct ev_loop* zones_loop = NULL;
+static ev_async* sighup_waker = NULL;
+static char* tmpl_dir = NULL;
+static tmpl_t** active = NULL;
+static unsigned active_count = 0;
+
+// Open-addressed set of zones by name, used to de-duplicate a zone list
+//   and to pair up old and new zones on reload.
+typedef struct {
+    zone_t** slots;
+    unsigned mask;
+} zset_t;
+
+// a slot whose zone was taken by zset_take()
+static zone_t* const ZSET_TAKEN = (zone_t*)(uintptr_t)0x1;
+
+F_NONNULL
+static void zset_init(zset_t* zs, const unsigned count) {
+    dmn_assert(zs);
+    unsigned size = 16;
+    while(size < (count << 1))
+        size <<= 1;
+    zs->slots = calloc(size, sizeof(zone_t*));
+    zs->mask = size - 1;
+}
+
+// Returns the slot holding a zone named "dname", or the empty slot it would go in
+F_NONNULL
+static zone_t** zset_slot(const zset_t* zs, const uint8_t* dname, const unsigned hash) {
+    dmn_assert(zs); dmn_assert(dname);
+    unsigned i = hash & zs->mask;
+    unsigned jump = 1;
+    while(zs->slots[i]) {
+        const zone_t* z = zs->slots[i];
+        if(z != ZSET_TAKEN && z->hash == hash && !dname_cmp(z->dname, dname))
+            break;
+        i = (i + jump++) & zs->mask;
+    }
+    return &zs->slots[i];
+}
+
+// false if a zone of the same name was already present
+F_NONNULL
+static bool zset_add(zset_t* zs, zone_t* z) {
+    dmn_assert(zs); dmn_assert(z);
+    zone_t** slot = zset_slot(zs, z->dname, z->hash);
+    if(*slot)
+        return false;
+    *slot = z;
+    return true;
+}
+
+F_NONNULL
+static zone_t* zset_take(zset_t* zs, const zone_t* z) {
+    dmn_assert(zs); dmn_assert(z);
+    zone_t** slot = zset_slot(zs, z->dname, z->hash);
+    zone_t* rv = *slot;
+    if(rv)
+        *slot = ZSET_TAKEN;
+    return rv;
+}
+
+static void tmpl_free(tmpl_t* t) {
+    if(t) {
+        for(unsigned i = 0; i < t->count; i++)
+            zone_retire(t->zones[i]);
+        free(t->zones);
+        free(t->name);
+        free(t);
+    }
+}
+
+F_NONNULL
+static tmpl_t* tmpl_find(tmpl_t** list, const unsigned count, const char* name) {
+    dmn_assert(list); dmn_assert(name);
+    for(unsigned i = 0; i < count; i++)
+        if(list[i] && !strcmp(list[i]->name, name))
+            return list[i];
+    return NULL;
+}
+
+// mtime of a regular file, 0 if missing, true on other failures
+F_NONNULL
+static bool tmpl_file_mtime(const char* fn, uint64_t* mtime_out) {
+    dmn_assert(fn); dmn_assert(mtime_out);
+    struct stat st;
+    if(stat(fn, &st)) {
+        if(errno == ENOENT) {
+            *mtime_out = 0;
+            return false;
+        }
+        log_err("tmpl: cannot stat file '%s': %s", fn, dmn_logf_errno());
+        return true;
+    }
+    if((st.st_mode & S_IFMT) != S_IFREG) {
+        log_err("tmpl: '%s' is not a regular file", fn);
+        return true;
+    }
+    *mtime_out = get_extended_mtime(&st);
+    return false;
+}
+
+// Attaches the zones named in zones_fn to the template zone "tz"
+F_NONNULL
+static bool tmpl_attach_zones(tmpl_t* t, zone_t* tz, const char* zones_fn) {
+    dmn_assert(t); dmn_assert(tz); dmn_assert(zones_fn);
+
+    FILE* fp = fopen(zones_fn, "r");
+    if(!fp) {
+        log_err("tmpl: cannot open file '%s': %s", zones_fn, dmn_logf_errno());
+        return true;
+    }
+
+    bool failed = false;
+    unsigned alloc = 64;
+    t->zones = malloc(alloc * sizeof(zone_t*));
+    zset_t zs;
+    zset_init(&zs, alloc);
+
+    char* line = NULL;
+    size_t line_alloc = 0;
+    unsigned linenum = 0;
+    while(!failed && getline(&line, &line_alloc, fp) >= 0) {
+        linenum++;
+        char* zname = line;
+        while(isspace((unsigned char)*zname))
+            zname++;
+        char* end = zname;
+        while(*end && *end != '#' && !isspace((unsigned char)*end))
+            end++;
+        *end = '\0';
+        if(!*zname)
+            continue;
+
+        zone_t* z = zone_new_attached(zname, tz->src, tz);
+        if(!z) {
+            log_err("tmpl: bad zone name at %s line %u", zones_fn, linenum);
+            failed = true;
+        }
+        else if(!zset_add(&zs, z)) {
+            log_warn("tmpl: zone '%s' listed more than once in %s, ignoring line %u", logf_dname(z->dname), zones_fn, linenum);
+            zone_delete(z);
+        }
+        else {
+            if(t->count == alloc) {
+                alloc <<= 1;
+                t->zones = realloc(t->zones, alloc * sizeof(zone_t*));
+            }
+            t->zones[t->count++] = z;
+            // keep the set sparse as the list grows
+            if((t->count << 1) > zs.mask) {
+                free(zs.slots);
+                zset_init(&zs, t->count << 1);
+                for(unsigned i = 0; i < t->count; i++)
+                    zset_add(&zs, t->zones[i]);
+            }
+        }
+    }
+
+    if(!failed && ferror(fp)) {
+        log_err("tmpl: read error on file '%s': %s", zones_fn, dmn_logf_errno());
+        failed = true;
+    }
+
+    free(line);
+    free(zs.slots);
+    if(fclose(fp)) {
+        log_err("tmpl: fclose(%s) failed: %s", zones_fn, dmn_logf_errno());
+        failed = true;
+    }
+
+    return failed;
+}
+
+// Loads NAME.tmpl and NAME.zones into a new tmpl_t, or NULL on failure
+F_NONNULL
+static tmpl_t* tmpl_load(const char* name, const char* tmpl_fn, const char* zones_fn, const uint64_t mtime) {
+    dmn_assert(name); dmn_assert(tmpl_fn); dmn_assert(zones_fn);
+
+    char* src = gdnsd_str_combine("template:", name, NULL);
+    zone_t* tz = zone_new(ZONE_TMPL_NAME, src);
+    free(src);
+    if(!tz)
+        return NULL;
+
+    if(zscan_rfc1035(tz, tmpl_fn, NULL) || zone_finalize(tz)) {
+        zone_delete(tz);
+        return NULL;
+    }
+    tz->mtime = mtime;
+
+    tmpl_t* t = calloc(1, sizeof(tmpl_t));
+    t->name = strdup(name);
+    t->mtime = mtime;
+    const bool failed = tmpl_attach_zones(t, tz, zones_fn);
+
+    // attached zones hold their own references from here
+    zone_delete(tz);
+
+    if(failed) {
+        tmpl_free(t);
+        return NULL;
+    }
+
+    log_info("tmpl: template '%s' loaded for %u zones", name, t->count);
+    return t;
+}
+
+// Scans the directory and builds the new list of templates, reusing any
+//   active entry whose files are unchanged (or which failed to reload)
+static tmpl_t** tmpl_scan(unsigned* count_out, const bool initial) {
+    dmn_assert(count_out);
+
+    unsigned count = 0;
+    unsigned alloc = 16;
+    tmpl_t** list = malloc(alloc * sizeof(tmpl_t*));
+
+    DIR* dir = opendir(tmpl_dir);
+    if(!dir) {
+        if(errno == ENOENT)
+            log_debug("tmpl: templates directory '%s' does not exist", tmpl_dir);
+        else
+            log_err("tmpl: cannot open directory '%s': %s", tmpl_dir, dmn_logf_errno());
+        *count_out = 0;
+        return list;
+    }
+
+    const unsigned sfx_len = sizeof(TMPL_SUFFIX) - 1;
+    struct dirent* e;
+    while((e = readdir(dir))) {
+        if(e->d_name[0] == '.')
+            continue;
+        const unsigned fn_len = strlen(e->d_name);
+        if(fn_len <= sfx_len || strcmp(&e->d_name[fn_len - sfx_len], TMPL_SUFFIX))
+            continue;
+
+        char* name = strdup(e->d_name);
+        name[fn_len - sfx_len] = '\0';
+        char* tmpl_fn = gdnsd_str_combine_n(3, tmpl_dir, name, TMPL_SUFFIX);
+        char* zones_fn = gdnsd_str_combine_n(3, tmpl_dir, name, ZONES_SUFFIX);
+
+        tmpl_t* old = tmpl_find(active, active_count, name);
+        tmpl_t* t = NULL;
+        uint64_t tmpl_mtime, zones_mtime;
+        if(tmpl_file_mtime(tmpl_fn, &tmpl_mtime) || tmpl_file_mtime(zones_fn, &zones_mtime)) {
+            t = old;
+        }
+        else if(!zones_mtime) {
+            log_warn("tmpl: template '%s' has no zone list %s, ignoring", name, zones_fn);
+        }
+        else {
+            const uint64_t mtime = tmpl_mtime > zones_mtime ? tmpl_mtime : zones_mtime;
+            if(old && old->mtime == mtime) {
+                t = old;
+            }
+            else if(!(t = tmpl_load(name, tmpl_fn, zones_fn, mtime))) {
+                if(initial && gconfig.zones_strict_startup)
+                    log_fatal("tmpl: Cannot load template '%s', failing", name);
+                log_err("tmpl: cannot load template '%s'%s", name, old ? ", keeping previous data" : "");
+                t = old;
+            }
+        }
+
+        if(t) {
+            if(count == alloc) {
+                alloc <<= 1;
+                list = realloc(list, alloc * sizeof(tmpl_t*));
+            }
+            list[count++] = t;
+        }
+
+        free(zones_fn);
+        free(tmpl_fn);
+        free(name);
+    }
+
+    if(closedir(dir))
+        log_err("tmpl: closedir(%s) failed: %s", tmpl_dir, dmn_logf_errno());
+
+    *count_out = count;
+    return list;
+}
+
+static void zsrc_tmpl_sync_zones(const bool initial) {
+    unsigned new_count;
+    tmpl_t** new_list = tmpl_scan(&new_count, initial);
+
+    // old templates replaced or removed (NULL entries stay as-is)
+    tmpl_t** old_list = calloc(active_count ? active_count : 1, sizeof(tmpl_t*));
+    unsigned old_count = 0;
+    for(unsigned i = 0; i < active_count; i++) {
+        tmpl_t* a = active[i];
+        bool kept = false;
+        for(unsigned j = 0; j < new_count; j++)
+            if(new_list[j] == a)
+                kept = true;
+        if(!kept)
+            old_list[old_count++] = a;
+    }
+
+    bool changed = !!old_count;
+    for(unsigned i = 0; !changed && i < new_count; i++)
+        if(!tmpl_find(active, active_count, new_list[i]->name))
+            changed = true;
+
+    if(changed) {
+        ztree_txn_start();
+
+        for(unsigned i = 0; i < new_count; i++) {
+            tmpl_t* t = new_list[i];
+            if(tmpl_find(active, active_count, t->name) == t)
+                continue; // unchanged
+
+            tmpl_t* old = tmpl_find(old_list, old_count, t->name);
+            zset_t zs;
+            zset_init(&zs, old ? old->count : 0);
+            if(old)
+                for(unsigned j = 0; j < old->count; j++)
+                    zset_add(&zs, old->zones[j]);
+
+            for(unsigned j = 0; j < t->count; j++)
+                ztree_txn_update(zset_take(&zs, t->zones[j]), t->zones[j]);
+            for(unsigned j = 0; j <= zs.mask; j++)
+                if(zs.slots[j] && zs.slots[j] != ZSET_TAKEN)
+                    ztree_txn_update(zs.slots[j], NULL);
+            free(zs.slots);
+        }
+
+        for(unsigned i = 0; i < old_count; i++)
+            if(!tmpl_find(new_list, new_count, old_list[i]->name))
+                for(unsigned j = 0; j < old_list[i]->count; j++)
+                    ztree_txn_update(old_list[i]->zones[j], NULL);
+
+        ztree_txn_end();
+
+        // now delete the zone_t's that were removed/replaced above
+        for(unsigned i = 0; i < old_count; i++)
+            tmpl_free(old_list[i]);
+    }
+
+    free(old_list);
+    free(active);
+    active = new_list;
+    active_count = new_count;
+
+    unsigned num_zones = 0;
+    for(unsigned i = 0; i < active_count; i++)
+        num_zones += active[i]->count;
+    log_info("tmpl: %u zones from %u templates in %s", num_zones, active_count, tmpl_dir);
+}
+
+static void unload_zones(void) {
+    if(active_count) {
+        ztree_txn_start();
+        for(unsigned i = 0; i < active_count; i++)
+            for(unsigned j = 0; j < active[i]->count; j++)
+                ztree_txn_update(active[i]->zones[j], NULL);
+        ztree_txn_end();
+        for(unsigned i = 0; i < active_count; i++)
+            tmpl_free(active[i]);
+    }
+    free(active);
+    active = NULL;
+    active_count = 0;
+}
+
+// XXX check_only could be used to optimize for the checkconf case,
+//   so long as the optimization doesn't change the validity of the check.
+void zsrc_tmpl_load_zones(const bool check_only V_UNUSED) {
+    tmpl_dir = gdnsd_resolve_path_cfg("templates/", NULL);
+    zsrc_tmpl_sync_zones(true);
+    gdnsd_atexit_debug(unload_zones);
+}
+
+// called within our thread/loop to take sighup action
+F_NONNULL
+static void sighup_cb(struct ev_loop* loop V_UNUSED, ev_async* w V_UNUSED, int revents V_UNUSED) {
+    dmn_assert(loop); dmn_assert(w);
+    log_info("tmpl: received SIGHUP notification, scanning for changes...");
+    zsrc_tmpl_sync_zones(false);
+}
+
+// called from main thread to feed ev_async
+void zsrc_tmpl_sighup(void) {
+    dmn_assert(zones_loop); dmn_assert(sighup_waker);
+    ev_async_send(zones_loop, sighup_waker);
+}
+
+void zsrc_tmpl_runtime_init(struct ev_loop* loop) {
+    dmn_assert(loop);
+
+    zones_loop = loop;
+    sighup_waker = malloc(sizeof(ev_async));
+    ev_async_init(sighup_waker, sighup_cb);
+    ev_async_start(loop, sighup_waker);
+}
@@ -20,12 +20,16 @@
 #include "ztree.h"
 
 #include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
 
 #include "main.h"
+#include "conf.h"
 #include "gdnsd/dname.h"
 #include "gdnsd/log.h"
 #include "gdnsd/misc.h"
 #include "gdnsd/prcu-priv.h"
+#include "gdnsd/stats.h"
 
 // The tree data structure that will hold the zone_t's
 struct _ztree_struct;
@@ -59,17 +63,184 @@ static ztree_t* ztree_root = NULL;
 // alternate, temporary root pointer for transactions
 static ztree_t* new_root = NULL;
 
+// The zone apex filter is a register-blocked bloom filter over the
+//   set of zone apex names present in the ztree.  Each apex sets 3 bits
+//   within a single 64-bit word, so a runtime probe for one suffix of
+//   a query name costs exactly one memory read.  It's rebuilt from
+//   scratch whenever the set of zones changes and published alongside
+//   the tree under the same prcu update, so it is always a superset
+//   of the zones visible to readers.
+// Alongside the filter is an exact index of the apex nodes by the same
+//   suffix hashes, which lets readers find the zone for a name with one
+//   probe per candidate suffix instead of descending the tree a label
+//   at a time.  Only label counts that actually have an apex are probed.
+typedef struct {
+    uint32_t hash;       // zfilter_hash() of the apex name
+    const ztree_t* node; // apex node, its zones are checked at lookup
+} zapex_t;
+
+typedef struct {
+    uint64_t* words;
+    unsigned mask;       // word count - 1
+    unsigned min_labels; // label count range of apex names,
+    unsigned max_labels; //   suffixes outside this range can't match
+    bool match_all;      // root zone present, no rejection possible
+    const ztree_t* root_apex; // root node, iff match_all
+    zapex_t* apexes;     // open-addressed index of apex nodes
+    unsigned apex_mask;  // apexes slot count - 1
+    uint64_t depths[2];  // bit per label count (1-127) with an apex
+} zfilter_t;
+
+static zfilter_t* zfilter = NULL;
+
+// Size of the current filter in bytes, for statio
+static stats_t zfilter_bytes;
+
+/****** deferred reclamation ********/
+
+// Storage unpublished from the runtime data (replaced zones, old ztree
+//   nodes and filters) can't be freed until the dnsio threads have
+//   passed a grace period.  Rather than stalling the zones thread on
+//   a synchronize for every update, it's queued here and a background
+//   reclaimer thread frees it in batches, one grace period per batch.
+
+typedef struct _reclaim_struct reclaim_t;
+struct _reclaim_struct {
+    void (*func)(void*);
+    void* ptr;
+    size_t bytes;
+    reclaim_t* next;
+};
+
+static pthread_mutex_t reclaim_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reclaim_cond = PTHREAD_COND_INITIALIZER;
+static reclaim_t* reclaim_head = NULL;
+static size_t reclaim_pending = 0;
+static bool reclaim_running = false;
+static bool reclaim_stopping = false;
+static bool reclaim_started = false;
+static pthread_t reclaim_threadid;
+
+// Bytes queued for the reclaimer, for statio
+static stats_t reclaim_bytes;
+
+// Called from the updater after gdnsd_prcu_upd_unlock_nosync() to
+//   arrange for func(ptr) to be called once no reader can still hold
+//   a reference to ptr.  Before the reclaimer is running, this
+//   simply synchronizes and calls func(ptr) directly.
+F_NONNULLX(1)
+static void ztree_defer(void (*func)(void*), void* ptr, size_t bytes) {
+    dmn_assert(func);
+    if(!ptr)
+        return;
+
+    pthread_mutex_lock(&reclaim_lock);
+    if(!reclaim_running) {
+        pthread_mutex_unlock(&reclaim_lock);
+        gdnsd_prcu_synchronize();
+        func(ptr);
+        return;
+    }
+    reclaim_t* r = malloc(sizeof(reclaim_t));
+    r->func = func;
+    r->ptr = ptr;
+    r->bytes = bytes;
+    r->next = reclaim_head;
+    reclaim_head = r;
+    reclaim_pending += bytes;
+    stats_own_set(&reclaim_bytes, reclaim_pending);
+    pthread_cond_signal(&reclaim_cond);
+    pthread_mutex_unlock(&reclaim_lock);
+}
+
+static size_t reclaim_run(reclaim_t* r) {
+    size_t bytes = 0;
+    while(r) {
+        reclaim_t* next = r->next;
+        r->func(r->ptr);
+        bytes += r->bytes;
+        free(r);
+        r = next;
+    }
+    return bytes;
+}
+
+static void* ztree_reclaim_runtime(void* unused V_UNUSED) {
+    gdnsd_thread_setname("gdnsd-reclaim");
+
+    pthread_mutex_lock(&reclaim_lock);
+    reclaim_running = true;
+    while(1) {
+        while(!reclaim_head && !reclaim_stopping)
+            pthread_cond_wait(&reclaim_cond, &reclaim_lock);
+        if(!reclaim_head)
+            break;
+        reclaim_t* batch = reclaim_head;
+        reclaim_head = NULL;
+        pthread_mutex_unlock(&reclaim_lock);
+
+        gdnsd_prcu_synchronize();
+        const size_t done = reclaim_run(batch);
+
+        pthread_mutex_lock(&reclaim_lock);
+        reclaim_pending -= done;
+        stats_own_set(&reclaim_bytes, reclaim_pending);
+    }
+
+    // Any later ztree_defer() synchronizes and frees inline
+    reclaim_running = false;
+    pthread_mutex_unlock(&reclaim_lock);
+    return NULL;
+}
+
+void ztree_reclaim_start(void) {
+    dmn_assert(!reclaim_started);
+    int pthread_err = pthread_create(&reclaim_threadid, NULL, &ztree_reclaim_runtime, NULL);
+    if(pthread_err)
+        log_fatal("pthread_create() of zone reclaimer thread failed: %s", dmn_logf_strerror(pthread_err));
+    reclaim_started = true;
+}
+
+size_t ztree_reclaim_bytes(void) {
+    return stats_get(&reclaim_bytes);
+}
+
 /****** zone_t code ********/
 
 void zone_delete(zone_t* zone) {
     dmn_assert(zone);
-    if(zone->root)
+    dmn_assert(zone->refs);
+    if(__sync_sub_and_fetch(&zone->refs, 1))
+        return;
+    if(zone->tmpl) {
+        // the frozen tree and index belong to the template
+        zone_t* tmpl = zone->tmpl;
+        free((uint8_t*)zone->dname);
+        free(zone->src);
+        free(zone);
+        zone_delete(tmpl);
+        return;
+    }
+    if(zone->froot)
+        ltree_destroy_frozen(zone->froot);
+    else if(zone->root)
         ltree_destroy(zone->root);
     lta_destroy(zone->arena);
+    free((uint8_t*)zone->dname);
     free(zone->src);
     free(zone);
 }
 
+static void zone_delete_cb(void* zone) {
+    zone_delete(zone);
+}
+
+void zone_retire(zone_t* zone) {
+    dmn_assert(zone);
+    const size_t bytes = sizeof(zone_t) + (zone->arena ? lta_size(zone->arena) : 0);
+    ztree_defer(zone_delete_cb, zone, bytes);
+}
+
 zone_t* zone_new(const char* zname, const char* source) {
     dmn_assert(zname);
 
@@ -92,14 +263,63 @@ zone_t* zone_new(const char* zname, const char* source) {
 
     zone_t* z = calloc(1, sizeof(zone_t));
     z->arena = lta_new();
-    z->dname = lta_dnamedup(z->arena, dname);
+    z->dname = dname_dup(dname, true);
     z->hash = dname_hash(z->dname);
     z->src = strdup(source);
+    z->minimal_responses = conf_zone_minimal_responses(z->dname);
+    z->any_mode = conf_zone_any_mode(z->dname);
+    z->refs = 1;
     ltree_init_zone(z);
 
     return z;
 }
 
+zone_t* zone_new_attached(const char* zname, const char* source, zone_t* tmpl) {
+    dmn_assert(zname); dmn_assert(source); dmn_assert(tmpl);
+    dmn_assert(tmpl->froot);
+    dmn_assert(!tmpl->tmpl);
+    dmn_assert(!dname_cmp(tmpl->dname, ZONE_TMPL_ORIGIN));
+
+    uint8_t dname[256];
+    dname_status_t status = dname_from_string(dname, (const uint8_t*)zname, strlen(zname));
+
+    if(status == DNAME_INVALID) {
+        log_err("Zone name '%s' is illegal", zname);
+        return NULL;
+    }
+
+    if(dname_iswild(dname)) {
+        log_err("Zone '%s': Wildcard zone names not allowed", logf_dname(dname));
+        return NULL;
+    }
+
+    if(status == DNAME_PARTIAL)
+        dname_terminate(dname);
+
+    // Every RHS dname from the template must still fit once rewritten
+    if(*dname + tmpl->tmpl_rhs_max > 255) {
+        log_err("Zone '%s': name too long for the data of template %s", logf_dname(dname), tmpl->src);
+        return NULL;
+    }
+
+    zone_t* z = calloc(1, sizeof(zone_t));
+    z->dname = dname_dup(dname, true);
+    z->hash = dname_hash(z->dname);
+    z->src = strdup(source);
+    z->serial = tmpl->serial;
+    z->mtime = tmpl->mtime;
+    z->minimal_responses = conf_zone_minimal_responses(z->dname);
+    z->any_mode = conf_zone_any_mode(z->dname);
+    z->froot = tmpl->froot;
+    z->nindex = tmpl->nindex;
+    z->tmpl = tmpl;
+    z->refs = 1;
+    // atomic, as the reclaimer may be dropping refs on tmpl concurrently
+    __sync_fetch_and_add(&tmpl->refs, 1);
+
+    return z;
+}
+
 bool zone_finalize(zone_t* zone) {
     lta_close(zone->arena);
     return ltree_postproc_zone(zone);
@@ -140,6 +360,192 @@ static inline unsigned label_hash(const uint8_t* label) {
     return gdnsd_lookup2((const char*)label, len);
 }
 
+/******* zone apex filter code *********/
+
+// Hash of a suffix dname, chained on from the hash of its parent
+//   (the root's is zero), so that a reader can hash all suffixes of
+//   a name in one pass over its labels.
+F_NONNULL F_PURE
+static inline uint32_t zfilter_hash(const uint32_t parent, const uint8_t* label) {
+    dmn_assert(label);
+    return ((parent << 7) | (parent >> 25)) ^ (parent * 0x9E3779B1U) ^ label_hash(label);
+}
+
+// 3 bits within the word selected by the low bits of the hash
+F_CONST
+static inline uint64_t zfilter_bits(const uint32_t hash) {
+    const uint32_t h2 = hash * 0x85EBCA6BU;
+    return (1ULL << (h2 >> 26))
+         | (1ULL << ((h2 >> 20) & 63))
+         | (1ULL << ((h2 >> 14) & 63));
+}
+
+// count apex nodes, treating "pending" as if its zones
+//   were "pending_zones" (for the non-txn update path)
+F_NONNULLX(1)
+static unsigned zfilter_count(const ztree_t* zt, const ztree_t* pending, const zone_t* const* pending_zones) {
+    dmn_assert(zt);
+    const bool apex = (zt == pending) ? !!pending_zones : !!zt->zones;
+    unsigned rv = apex ? 1 : 0;
+    const ztchildren_t* ztc = zt->children;
+    if(ztc)
+        for(unsigned i = 0; i < ztc->alloc; i++)
+            if(ztc->store[i])
+                rv += zfilter_count(ztc->store[i], pending, pending_zones);
+    return rv;
+}
+
+F_NONNULLX(1,2)
+static void zfilter_fill(zfilter_t* zf, const ztree_t* zt, const uint32_t hash, const unsigned depth, const ztree_t* pending, const zone_t* const* pending_zones) {
+    dmn_assert(zf); dmn_assert(zt);
+    const bool apex = (zt == pending) ? !!pending_zones : !!zt->zones;
+    if(apex) {
+        if(!depth) {
+            zf->match_all = true;
+            zf->root_apex = zt;
+        }
+        else {
+            zf->words[hash & zf->mask] |= zfilter_bits(hash);
+            if(depth < zf->min_labels)
+                zf->min_labels = depth;
+            if(depth > zf->max_labels)
+                zf->max_labels = depth;
+            zf->depths[depth >> 6] |= 1ULL << (depth & 63);
+            unsigned slot = hash & zf->apex_mask;
+            unsigned jmpby = 1;
+            while(zf->apexes[slot].node)
+                slot = (slot + jmpby++) & zf->apex_mask;
+            zf->apexes[slot].hash = hash;
+            zf->apexes[slot].node = zt;
+        }
+    }
+    const ztchildren_t* ztc = zt->children;
+    if(ztc) {
+        for(unsigned i = 0; i < ztc->alloc; i++) {
+            const ztree_t* child = ztc->store[i];
+            if(child)
+                zfilter_fill(zf, child, zfilter_hash(hash, child->label), depth + 1, pending, pending_zones);
+        }
+    }
+}
+
+// Builds a new filter for the tree at "root".  Sized at 2 words per
+//   apex (~32 bits/key), which keeps false positives well under 0.1%.
+//   The apex index is kept at or under 50% load.
+F_NONNULLX(1)
+static zfilter_t* zfilter_build(const ztree_t* root, const ztree_t* pending, const zone_t* const* pending_zones) {
+    dmn_assert(root);
+
+    const unsigned count = zfilter_count(root, pending, pending_zones);
+    unsigned nwords = 1;
+    while(nwords < (count << 1))
+        nwords <<= 1;
+
+    zfilter_t* zf = calloc(1, sizeof(zfilter_t));
+    zf->words = calloc(nwords, sizeof(uint64_t));
+    zf->mask = nwords - 1;
+    zf->min_labels = UINT_MAX;
+    zf->apexes = calloc(nwords, sizeof(zapex_t));
+    zf->apex_mask = nwords - 1;
+    zfilter_fill(zf, root, 0, 0, pending, pending_zones);
+
+    stats_own_set(&zfilter_bytes, nwords * (sizeof(uint64_t) + sizeof(zapex_t)));
+    return zf;
+}
+
+F_NONNULL
+static void zfilter_destroy(zfilter_t* zf) {
+    dmn_assert(zf);
+    free(zf->apexes);
+    free(zf->words);
+    free(zf);
+}
+
+static void zfilter_destroy_cb(void* zf) {
+    zfilter_destroy(zf);
+}
+
+// Bytes held by a filter, for reclaim accounting
+F_NONNULL F_PURE
+static size_t zfilter_size(const zfilter_t* zf) {
+    dmn_assert(zf);
+    return sizeof(zfilter_t) + (zf->apex_mask + 1U) * sizeof(zapex_t)
+        + (zf->mask + 1U) * sizeof(uint64_t);
+}
+
+// Looks up the zone at the apex with the given hash, which must be
+//   named exactly "suffix" (a suffix of a full dname, "len" bytes
+//   including the terminal label).
+F_NONNULL
+static zone_t* zfilter_probe(const zfilter_t* zf, const uint32_t hash, const uint8_t* suffix, const unsigned len) {
+    dmn_assert(zf); dmn_assert(suffix);
+
+    unsigned slot = hash & zf->apex_mask;
+    unsigned jmpby = 1;
+    const zapex_t* entry;
+    while((entry = &zf->apexes[slot])->node) {
+        if(entry->hash == hash) {
+            zone_t* z = ztree_reader_get_zone(entry->node);
+            if(z && *z->dname == len && !memcmp(z->dname + 1, suffix, len))
+                return z;
+        }
+        slot = (slot + jmpby++) & zf->apex_mask;
+    }
+
+    return NULL;
+}
+
+// Reader-side lookup of the zone for the name in lstack.  Suffixes are
+//   probed from the shortest, as the parent zone takes precedence over
+//   any subzone, and only at label counts which have an apex and pass
+//   the filter.  On success, *depth_out is the label count of the
+//   apex.  *filtered_out is set if the filter alone ruled out every
+//   suffix.
+F_NONNULL
+static zone_t* zfilter_find_zone(const zfilter_t* zf, const uint8_t* dname, const uint8_t** lstack, const unsigned lcount, unsigned* depth_out, bool* filtered_out) {
+    dmn_assert(zf); dmn_assert(dname); dmn_assert(lstack);
+    dmn_assert(depth_out); dmn_assert(filtered_out);
+
+    bool passed = zf->match_all;
+    if(zf->match_all) {
+        zone_t* z = ztree_reader_get_zone(zf->root_apex);
+        if(z) {
+            *depth_out = 0;
+            *filtered_out = false;
+            return z;
+        }
+    }
+
+    const uint8_t* dname_end = dname + 1 + *dname;
+    const unsigned maxd = lcount < zf->max_labels ? lcount : zf->max_labels;
+    uint32_t hash = 0;
+    for(unsigned depth = 1; depth <= maxd; depth++) {
+        const uint8_t* label = lstack[lcount - depth];
+        hash = zfilter_hash(hash, label);
+        if(depth < zf->min_labels || !(zf->depths[depth >> 6] & (1ULL << (depth & 63))))
+            continue;
+        const uint64_t bits = zfilter_bits(hash);
+        if((zf->words[hash & zf->mask] & bits) != bits)
+            continue;
+        passed = true;
+        zone_t* z = zfilter_probe(zf, hash, label, dname_end - label);
+        if(z) {
+            *depth_out = depth;
+            *filtered_out = false;
+            return z;
+        }
+    }
+
+    *filtered_out = !passed;
+    return NULL;
+}
+
+unsigned ztree_filter_bytes(void) {
+    return stats_get(&zfilter_bytes);
+}
+
+/******* ztree code, continued *********/
+
 // search the children of one node for a given label
 F_NONNULL
 static ztree_t* ztree_node_find_child(ztree_t* node, const uint8_t* label, const bool reader) {
@@ -178,13 +584,25 @@ static ztree_t* ztree_node_find_child(ztree_t* node, const uint8_t* label, const
 // "dname" can be any legal FQDN.  This returns the zone_t that
 //   logically contains this dname, IFF one exists, for runtime
 //   lookup purposes
-zone_t* ztree_find_zone_for(const uint8_t* dname, unsigned* auth_depth_out) {
-    dmn_assert(dname); dmn_assert(auth_depth_out);
+zone_t* ztree_find_zone_for(const uint8_t* dname, unsigned* auth_depth_out, bool* filtered_out) {
+    dmn_assert(dname); dmn_assert(auth_depth_out); dmn_assert(filtered_out);
 
     zone_t* rv = NULL;
 
     const uint8_t* lstack[127];
     unsigned lcount = dname_to_lstack(dname, lstack);
+
+    const zfilter_t* zf = gdnsd_prcu_rdr_deref(zfilter);
+    if(likely(zf)) {
+        unsigned depth;
+        rv = zfilter_find_zone(zf, dname, lstack, lcount, &depth, filtered_out);
+        if(rv)
+            *auth_depth_out = depth ? (unsigned)(lstack[lcount - depth] - dname - 1) : (unsigned)(*dname - 1);
+        return rv;
+    }
+    *filtered_out = false;
+
+    // no filter is published until the first zone update
     ztree_t* current = gdnsd_prcu_rdr_deref(ztree_root);
     while(current && !(rv = ztree_reader_get_zone(current)) && lcount)
         current = ztree_node_find_child(current, lstack[--lcount], true);
@@ -199,6 +617,12 @@ zone_t* ztree_find_zone_for(const uint8_t* dname, unsigned* auth_depth_out) {
     return rv;
 }
 
+static void ztchildren_free_cb(void* p) {
+    ztchildren_t* children = p;
+    free(children->store);
+    free(children);
+}
+
 // Doubles the size of the childtable in a ztree node,
 //   or initializes to 16 slots.
 // XXX should we prune empty subtrees during grow?
@@ -236,9 +660,9 @@ static void ztree_node_check_grow(ztree_t* node) {
         }
         gdnsd_prcu_upd_lock();
         gdnsd_prcu_upd_assign(node->children, new_children);
-        gdnsd_prcu_upd_unlock();
-        free(old_children->store);
-        free(old_children);
+        gdnsd_prcu_upd_unlock_nosync();
+        ztree_defer(ztchildren_free_cb, old_children,
+            sizeof(ztchildren_t) + old_children->alloc * sizeof(ztree_t*));
     }
 }
 
@@ -291,7 +715,24 @@ static void ztree_leak_warn(ztree_t* node) {
 }
 
 static void ztree_atexit(void) {
+    // The reclaimer may be mid-batch, so stop and join it before
+    //   draining whatever it hasn't picked up yet
+    if(reclaim_started) {
+        pthread_mutex_lock(&reclaim_lock);
+        reclaim_stopping = true;
+        pthread_cond_signal(&reclaim_cond);
+        pthread_mutex_unlock(&reclaim_lock);
+        pthread_join(reclaim_threadid, NULL);
+        reclaim_started = false;
+    }
+    pthread_mutex_lock(&reclaim_lock);
+    reclaim_t* leftover = reclaim_head;
+    reclaim_head = NULL;
+    pthread_mutex_unlock(&reclaim_lock);
+    reclaim_run(leftover);
     ztree_leak_warn(ztree_root);
+    if(zfilter)
+        zfilter_destroy(zfilter);
     gdnsd_prcu_destroy_lock();
 }
 
@@ -492,29 +933,54 @@ static void _ztree_update(ztree_t* root, zone_t* z_old, zone_t* z_new, const boo
         }
     }
 
-    // swap lists and free
+    // swap lists and free, and outside of a txn publish a
+    //   new apex filter with the new list in the same update,
+    //   deferring the old list and filter to the reclaimer
     if(in_txn) {
         this_zt->zones = new_list;
+        if(old_list)
+            free(old_list);
     }
     else {
+        zfilter_t* old_filter = zfilter;
+        zfilter_t* new_filter = zfilter_build(root, this_zt, (const zone_t* const*)new_list);
         gdnsd_prcu_upd_lock();
         gdnsd_prcu_upd_assign(this_zt->zones, new_list);
-        gdnsd_prcu_upd_unlock();
+        gdnsd_prcu_upd_assign(zfilter, new_filter);
+        gdnsd_prcu_upd_unlock_nosync();
+        if(old_filter)
+            ztree_defer(zfilter_destroy_cb, old_filter, zfilter_size(old_filter));
+        ztree_defer(free, old_list, 0);
+    }
+}
+
+// As _ztree_update(), also profiling the publish phase of z_new
+F_NONNULLX(1)
+static void ztree_update_prof(ztree_t* root, zone_t* z_old, zone_t* z_new, const bool in_txn) {
+    dmn_assert(root);
+
+    if(!z_new) {
+        _ztree_update(root, z_old, NULL, in_txn);
+        return;
     }
-    if(old_list)
-        free(old_list);
+
+    zprof_mark_t mark;
+    zprof_mark(&mark);
+    _ztree_update(root, z_old, z_new, in_txn);
+    zprof_add(&z_new->prof, ZPROF_PUBLISH, &mark);
+    zprof_record(z_new->dname, z_new->src, &z_new->prof);
 }
 
 void ztree_update(zone_t* z_old, zone_t* z_new) {
     dmn_assert(ztree_root);
     dmn_assert(!new_root); // no txn currently ongoing
-    _ztree_update(ztree_root, z_old, z_new, false);
+    ztree_update_prof(ztree_root, z_old, z_new, false);
 }
 
 void ztree_txn_update(zone_t* z_old, zone_t* z_new) {
     dmn_assert(ztree_root);
     dmn_assert(new_root); // pending txn
-    _ztree_update(new_root, z_old, z_new, true);
+    ztree_update_prof(new_root, z_old, z_new, true);
 }
 
 // clones share linked label and zone values, but
@@ -572,6 +1038,10 @@ static void ztree_destroy_clone(ztree_t* ztclone) {
     free(ztclone);
 }
 
+static void ztree_destroy_clone_cb(void* ztclone) {
+    ztree_destroy_clone(ztclone);
+}
+
 void ztree_txn_start(void) {
     dmn_assert(ztree_root);
     dmn_assert(!new_root); // no txn currently ongoing
@@ -591,10 +1061,15 @@ void ztree_txn_end(void) {
     dmn_assert(ztree_root);
     dmn_assert(new_root);
     ztree_t* old_root = ztree_root;
+    zfilter_t* old_filter = zfilter;
+    zfilter_t* new_filter = zfilter_build(new_root, NULL, NULL);
     gdnsd_prcu_upd_lock();
     gdnsd_prcu_upd_assign(ztree_root, new_root);
-    gdnsd_prcu_upd_unlock();
-    ztree_destroy_clone(old_root);
+    gdnsd_prcu_upd_assign(zfilter, new_filter);
+    gdnsd_prcu_upd_unlock_nosync();
+    ztree_defer(ztree_destroy_clone_cb, old_root, 0);
+    if(old_filter)
+        ztree_defer(zfilter_destroy_cb, old_filter, zfilter_size(old_filter));
     new_root = NULL;
     log_info("Multi-zone update transaction committed");
 }
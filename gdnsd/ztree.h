@@ -27,6 +27,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include "ltarena.h"
+#include "zprof.h"
 
 // high-res mtime stuff, for zsrc_*.c to use internally...
 #if defined HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
@@ -53,18 +54,40 @@ typedef struct _zone_struct zone_t;
 
 #include "ltree.h"
 
+// How ANY queries are answered, per RFC 8482
+typedef enum {
+    ANY_MODE_FULL = 0, // every rrset at the node
+    ANY_MODE_HINFO,    // a single synthesized HINFO
+    ANY_MODE_RRSET,    // one representative rrset
+} any_mode_t;
+
 struct _zone_struct {
     unsigned hash;        // hash of dname
     unsigned serial;      // SOA serial from zone data
     uint64_t mtime;       // mod time of source as uint64_t nanoseconds unix-time
                           //    (use get_extended_mtime() above if src is struct stat!)
     char* src;            // string description of src, e.g. "rfc1035:example.com"
-    const uint8_t* dname; // zone name as a dname (stored in ->arena)
-    ltarena_t* arena;     // arena for dname/label storage
-    ltree_node_t* root;   // the zone root
+    const uint8_t* dname; // zone name as a dname (malloc'd)
+    ltarena_t* arena;     // arena for label/dname storage and the frozen tree, NULL if ->tmpl
+    ltree_node_t* root;   // the zone root during construction, NULL once frozen
+    ltree_fnode_t* froot; // the frozen zone root, which starts the frozen node block (owned by arena)
+    ltree_nindex_t* nindex; // full-name index of froot (owned by arena), NULL if disabled
+    bool minimal_responses; // omit optional authority/additional data
+    any_mode_t any_mode;    // UDP answer mode for ANY queries
+    zone_t* tmpl;         // template zone whose froot/nindex this zone shares, or NULL
+    unsigned refs;        // zone_delete() only frees at zero, templates hold one per attached zone
+    unsigned tmpl_rhs_max; // for a template, longest RHS dname prefix under ZONE_TMPL_ORIGIN
+    zprof_t prof;         // load profile, recorded when published
     zone_t* next;         // init to NULL, owned by ztree...
 };
 
+// Template zones are parsed with this placeholder origin.  Zones attached
+//   to a template share its frozen tree, and dnspacket.c rewrites any
+//   RHS dname under the placeholder origin to the query zone's name
+//   as it is encoded.
+#define ZONE_TMPL_NAME "template.invalid"
+#define ZONE_TMPL_ORIGIN ((const uint8_t*)"\022\010template\007invalid")
+
 // Singleton init
 void ztree_init(void);
 
@@ -84,6 +107,8 @@ void ztree_update(zone_t* z_old, zone_t* z_new);
 //  4) Updates will not appear for runtime until after txn_end() returns
 //  5) You cannot delete any referenced zone_t's (z_old arguments)
 //     until after txn_end() returns.
+//  6) Once a zone_t has been visible to runtime lookups, release it
+//     with zone_retire() rather than zone_delete().
 void ztree_txn_start(void);
 void ztree_txn_update(zone_t* z_old, zone_t* z_new);
 void ztree_txn_abort(void);
@@ -95,8 +120,17 @@ F_NONNULL
 zone_t* zone_new(const char* zname, const char* source);
 F_NONNULL
 bool zone_finalize(zone_t* zone);
+// Creates a zone sharing the data of "tmpl", a finalized zone named
+//   ZONE_TMPL_NAME.  The new zone holds a reference on tmpl until deleted.
+F_NONNULL
+zone_t* zone_new_attached(const char* zname, const char* source, zone_t* tmpl);
 F_NONNULL
 void zone_delete(zone_t* zone);
+// As above, but for a zone that was published in the ztree and may
+//   still be referenced by dnsio threads: the delete is deferred to
+//   the background reclaimer until after a grace period.
+F_NONNULL
+void zone_retire(zone_t* zone);
 
 // --- dnsio/dnspacket reader interfaces ---
 
@@ -107,7 +141,19 @@ void zone_delete(zone_t* zone);
 // auth_depth_out is mostly useful for dnspacket.c, it tells you
 //   how many bytes into the dname the authoritative zone name
 //   starts at.
+// filtered_out is set to true when a NULL result was determined
+//   by the zone apex filter alone, without searching the tree.
 F_NONNULL
-zone_t* ztree_find_zone_for(const uint8_t* dname, unsigned* auth_depth_out);
+zone_t* ztree_find_zone_for(const uint8_t* dname, unsigned* auth_depth_out, bool* filtered_out);
+
+// Current size of the zone apex filter in bytes, for statio
+unsigned ztree_filter_bytes(void);
+
+// Bytes of retired zones and ztree storage awaiting the reclaimer, for statio
+size_t ztree_reclaim_bytes(void);
+
+// Start the background reclaimer thread (joinable, it's stopped
+//   and joined by the debug-build atexit cleanup)
+void ztree_reclaim_start(void);
 
 #endif // GDNSD_ZTREE_H
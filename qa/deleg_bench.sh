@@ -0,0 +1,49 @@
+#!/bin/sh
+# execute from top of repo, after a normal build
+# Generates a synthetic TLD-like zone with a large number of
+#  delegations (default 1000000), each with two in-bailiwick
+#  glued nameservers and a third nameserver from a pool of 1024
+#  in-zone (but out-of-bailiwick for the delegation) hosts under
+#  "nic", and runs "gdnsd checkconf" against it.  The "Zone load profile"
+#  lines in the output give the per-phase wall/cpu times (scan,
+#  phase1, phase2, freeze, publish) for comparing postproc changes.
+# Usage: qa/deleg_bench.sh [num_delegations] [path/to/gdnsd]
+if [ ! -f $PWD/qa/gdnsd.supp ]; then
+   echo "Run this from the root of the source tree!"
+   exit 99
+fi
+NDELEG=${1:-1000000}
+GDNSD=${2:-$PWD/gdnsd/gdnsd}
+BDIR=/tmp/_gdnsd_deleg_bench
+set -e
+rm -rf $BDIR
+mkdir -p $BDIR/zones $BDIR/run $BDIR/state
+cat >$BDIR/config <<EOF
+options => {
+  run_dir = $BDIR/run
+  state_dir = $BDIR/state
+}
+EOF
+perl -e '
+    my $n = shift;
+    print "\$TTL 86400\n";
+    print "\@ SOA ns1 hostmaster 1 7200 1800 259200 900\n";
+    print "\@ NS ns1\n\@ NS ns2\n";
+    print "ns1 A 192.0.2.1\nns2 A 192.0.2.2\n";
+    for my $i (0..1023) {
+        print "h$i.nic A 198.51.100.", ($i % 254) + 1, "\n";
+    }
+    for my $i (0..($n - 1)) {
+        my $ip = join(".", 10, ($i >> 16) & 255, ($i >> 8) & 255, $i & 255);
+        print "d$i NS ns1.d$i\n";
+        print "d$i NS ns2.d$i\n";
+        print "d$i NS h", $i % 1024, ".nic\n";
+        print "ns1.d$i A $ip\n";
+        print "ns2.d$i AAAA 2001:db8::", sprintf("%x:%x", $i >> 16, $i & 65535), "\n";
+    }
+' $NDELEG >$BDIR/zones/tld
+set +e
+$GDNSD -c $BDIR checkconf 2>&1 | grep 'Zone load profile'
+RV=$?
+rm -rf $BDIR
+exit $RV
@@ -0,0 +1,74 @@
+
+# Differential test of the A/AAAA fast path: every owner name in this
+#  testdir's zone files is queried for A and AAAA (with and without a
+#  bare EDNS OPT RR, over UDP and TCP) with addr_fast_path on and then
+#  off, and the normalized responses must be identical.
+
+use _GDT ();
+use FindBin ();
+use IO::Socket::INET ();
+use Test::More tests => 7;
+
+my @edns_base = (
+    type => "OPT",
+    ednsversion => 0,
+    name => "",
+    class => 1280,
+    extendedrcode => 0,
+    ednsflags => 0,
+);
+
+my @qnames = _GDT->zonefile_owners("$FindBin::Bin/etc/zones", 1);
+push(@qnames, 'example.net.', 'www.example.net.');
+
+sub udp_query {
+    my $qpacket = shift;
+    my $sock = IO::Socket::INET->new(
+        PeerAddr => '127.0.0.1',
+        PeerPort => $_GDT::DNS_PORT,
+        Proto => 'udp',
+        Timeout => 10,
+    ) or die "Cannot create UDP socket: $!";
+    send($sock, $qpacket->data, 0);
+    my $res_raw;
+    recv($sock, $res_raw, 65535, 0);
+    close($sock);
+    return Net::DNS::Packet->new(\$res_raw, 1);
+}
+
+sub tcp_query {
+    my $qpacket = shift;
+    my $res = _GDT::get_resolver();
+    $res->usevc(1);
+    my $rpkt = $res->send($qpacket);
+    $res->usevc(0);
+    return $rpkt;
+}
+
+sub run_queries {
+    my %results;
+    foreach my $qname (@qnames) {
+        foreach my $qtype (qw/A AAAA/) {
+            foreach my $edns (0, 1) {
+                foreach my $proto (qw/udp tcp/) {
+                    my $qpacket = Net::DNS::Packet->new($qname, $qtype);
+                    $qpacket->push(additional => Net::DNS::RR->new(@edns_base))
+                        if $edns;
+                    my $rpkt = $proto eq 'udp'
+                        ? udp_query($qpacket)
+                        : tcp_query($qpacket);
+                    $results{"$qname/$qtype/$edns/$proto"} = _GDT->normalize_response($rpkt);
+                }
+            }
+        }
+    }
+    return \%results;
+}
+
+my $fast = _GDT->run_daemon_queries(queries => \&run_queries);
+my $slow = _GDT->run_daemon_queries(
+    cfg => "addr_fast_path = false\n",
+    queries => \&run_queries,
+);
+
+is_deeply($fast, $slow, 'fast path responses match general path over ' . scalar(@qnames) . ' names');
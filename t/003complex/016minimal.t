@@ -0,0 +1,59 @@
+
+# This tests minimal_responses via a per-zone override for example.com
+
+use _GDT ();
+use FindBin ();
+use File::Spec ();
+use Test::More tests => 8;
+
+_GDT->test_spawn_daemon_setup();
+{
+    my $cfg = "$_GDT::OUTDIR/etc/cfg-static";
+    open(my $fh, '>>', $cfg) or die "Cannot append to $cfg: $!";
+    print $fh "include_optional_ns = true\n";
+    print $fh "minimal_responses_zones = { example.com = true }\n";
+    close($fh);
+}
+my $pid = _GDT->test_spawn_daemon_execute();
+
+# No other-family addresses in additional, and no optional NS
+_GDT->test_dns(
+    qname => '46mix.example.com', qtype => 'A',
+    answer => [
+        '46mix.example.com 21600 A 192.0.2.200',
+        '46mix.example.com 21600 A 192.0.2.201',
+    ],
+);
+
+_GDT->test_dns(
+    qname => '46mix.example.com', qtype => 'AAAA',
+    answer => [
+        '46mix.example.com 21600 AAAA ABCD::DCBA',
+        '46mix.example.com 21600 AAAA DEAD::BEEF',
+    ],
+);
+
+# No additional addresses for MX targets
+_GDT->test_dns(
+    resopts => { usevc => 1, igntc => 0, udppacketsize => 512 },
+    qname => 'big.example.com', qtype => 'MX',
+    answer => [ map { 'big.example.com 21600 MX ' . $_ . ' asd' . ('f' x ($_ + 1)) . '.example.com' } (0..20) ],
+    stats => [qw/tcp_reqs noerror/],
+);
+
+# Referrals still carry their glue
+_GDT->test_dns(
+    qname => 'subeasy.example.com', qtype => 'A',
+    header => { aa => 0 },
+    auth => [
+        'subeasy.example.com 21600 NS subeasyns1.example.com',
+        'subeasy.example.com 21600 NS subeasyns2.example.com',
+    ],
+    addtl => [
+        'subeasyns1.example.com 21600 A 192.0.2.3',
+        'subeasyns2.example.com 21600 A 192.0.2.4',
+    ]
+);
+
+_GDT->test_stats;
+_GDT->test_kill_daemon($pid);
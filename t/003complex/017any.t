@@ -0,0 +1,57 @@
+
+# This tests the RFC 8482 qtype=ANY answer modes
+
+use _GDT ();
+use FindBin ();
+use File::Spec ();
+use Test::More tests => 7;
+
+_GDT->test_spawn_daemon_setup();
+{
+    my $cfg = "$_GDT::OUTDIR/etc/cfg-static";
+    open(my $fh, '>>', $cfg) or die "Cannot append to $cfg: $!";
+    print $fh "any_mode = hinfo\n";
+    print $fh "any_mode_zones = { example.org = rrset }\n";
+    print $fh "any_full_sources = [ \"::1/128\", \"192.0.2.0/24\" ]\n";
+    close($fh);
+}
+my $pid = _GDT->test_spawn_daemon_execute();
+
+my $mix_full = [
+    '46mix.example.com 21600 AAAA ABCD::DCBA',
+    '46mix.example.com 21600 AAAA DEAD::BEEF',
+    '46mix.example.com 21600 A 192.0.2.200',
+    '46mix.example.com 21600 A 192.0.2.201',
+];
+
+# Global hinfo mode over UDP
+_GDT->test_dns(
+    v4_only => 1,
+    qname => '46mix.example.com', qtype => 'ANY',
+    answer => '46mix.example.com 21600 HINFO "RFC8482" ""',
+);
+
+# Full answer over TCP
+_GDT->test_dns(
+    v4_only => 1,
+    resopts => { usevc => 1 },
+    qname => '46mix.example.com', qtype => 'ANY',
+    answer => $mix_full,
+    stats => [qw/tcp_reqs noerror/],
+);
+
+# Full answer for a source in any_full_sources
+_GDT->test_dns(
+    v6_only => 1,
+    qname => '46mix.example.com', qtype => 'ANY',
+    answer => $mix_full,
+);
+
+# Per-zone rrset mode
+_GDT->test_dns(
+    v4_only => 1,
+    qname => 'foo.example.org', qtype => 'ANY',
+    answer => 'foo.example.org 43201 A 192.0.2.202',
+);
+
+_GDT->test_kill_daemon($pid);
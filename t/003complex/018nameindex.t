@@ -0,0 +1,62 @@
+
+# Differential test of the per-zone full-name index: a deep ip6.arpa
+#  reverse zone (with a wildcard, a delegation with glue, a CNAME and
+#  empty non-terminals) is generated, and a mix of exact, non-existent,
+#  wildcard-matched, and delegated names is queried with
+#  zones_name_index on and then off.  The responses must be identical.
+
+use _GDT ();
+use Test::More tests => 7;
+
+my $rzone = '0.0.0.0.0.0.0.0.8.b.d.0.1.0.0.2.ip6.arpa';
+
+# relative owner => [ type, rdata ]
+my @records = (
+    (map { ["$_.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0", 'PTR', "host-$_.example.net."] } (0..9, 'a'..'f')),
+    ['*.0.0.0.0.0.0.0.1', 'PTR', 'wild.example.net.'],
+    ['5.0.0.0.0.0.0.0.1', 'PTR', 'notwild.example.net.'],
+    ['2.0.0.0.0.0.0.0', 'NS', 'ns.2.0.0.0.0.0.0.0'],
+    ['ns.2.0.0.0.0.0.0.0', 'AAAA', '2001:db8::2'],
+    ['c.0.0.0.0.0.0.0.0.0.0.0.0.0.0.3', 'CNAME', '0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0'],
+    ['d.0.0.0.0.0.0.0.0.0.0.0.0.0.0.3', 'CNAME', 'f.f.0.0.0.0.0.0.0.0.0.0.0.0.0.0'],
+);
+
+my @qnames = ("$rzone.", "www.$rzone.");
+foreach my $rec (@records) {
+    my $name = "$rec->[0].$rzone.";
+    push(@qnames, $name, "x.$name", "1.2.$name");
+}
+push(@qnames,
+    "0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.$rzone.",
+    "0.0.0.0.0.0.0.0.$rzone.",
+    "7.7.0.0.0.0.0.0.0.1.$rzone.",
+    "1.0.0.0.0.0.0.0.0.0.0.0.2.0.0.0.0.0.0.0.$rzone.",
+    "f.f.f.f.f.f.f.f.f.f.f.f.f.f.f.f.$rzone.",
+    'ns1.example.com.', 'ns1.subhard.example.com.', 'foo.subhard.example.com.',
+);
+
+sub write_rzone {
+    my $fn = "$_GDT::OUTDIR/etc/zones/$rzone";
+    open(my $fh, '>', $fn) or die "Cannot open $fn for writing: $!";
+    print $fh "\@ SOA ns1.example.net. hostmaster 1 7200 1800 259200 900\n";
+    print $fh "\@ NS ns1.example.net.\n";
+    print $fh "\@ NS ns2.example.net.\n";
+    print $fh join(' ', @$_) . "\n" foreach (@records);
+    close($fh) or die "Cannot close $fn: $!";
+}
+
+sub run_queries {
+    return _GDT->query_responses(\@qnames, [qw/PTR AAAA NS CNAME ANY/]);
+}
+
+my $indexed = _GDT->run_daemon_queries(
+    setup => \&write_rzone,
+    queries => \&run_queries,
+);
+my $descent = _GDT->run_daemon_queries(
+    setup => \&write_rzone,
+    cfg => "zones_name_index = false\n",
+    queries => \&run_queries,
+);
+
+is_deeply($indexed, $descent, 'name index responses match tree descent over ' . scalar(@qnames) . ' names');
@@ -0,0 +1,23 @@
+
+# Differential test of cross-zone interning: every owner name in this
+#  testdir's zone files is queried for a range of rrtypes with
+#  zones_intern off and then on, and the normalized responses must be
+#  identical.
+
+use _GDT ();
+use FindBin ();
+use Test::More tests => 7;
+
+my @qnames = _GDT->zonefile_owners("$FindBin::Bin/etc/zones");
+
+sub run_queries {
+    return _GDT->query_responses(\@qnames, [qw/SOA NS MX TXT SPF PTR SRV NAPTR TYPE31337/]);
+}
+
+my $plain = _GDT->run_daemon_queries(queries => \&run_queries);
+my $interned = _GDT->run_daemon_queries(
+    cfg => "zones_intern = true\n",
+    queries => \&run_queries,
+);
+
+is_deeply($interned, $plain, 'interned responses match per-zone storage over ' . scalar(@qnames) . ' names');
@@ -0,0 +1,72 @@
+
+# Differential test of template zones: the same zone data is served
+#  once from per-zone rfc1035 zonefiles, and once from a single
+#  template attached to the same zone names.  The responses for every
+#  owner name (and some non-existent ones) must be identical.
+
+use _GDT ();
+use Test::More tests => 7;
+
+my @zones = qw/parked.test a.b.parked-deeper.test/;
+
+my $tmpl = <<'EOT';
+@ SOA ns1 hostmaster 1 7200 1800 259200 900
+@ NS ns1
+@ NS ns.example.net.
+@ MX 10 mail
+@ A 192.0.2.10
+ns1 A 192.0.2.1
+mail A 192.0.2.2
+www CNAME @
+alias CNAME www
+ext CNAME www.example.net.
+_sip._tcp SRV 10 20 5060 sip
+sip AAAA 2001:db8::5
+sub NS ns.sub
+ns.sub A 192.0.2.3
+* TXT "wild"
+txt TXT "hello"
+ptr PTR www.template.invalid.
+EOT
+
+my @owners = ('', qw/ns1 mail www alias ext _sip._tcp sip sub ns.sub x.sub txt ptr nx.ptr foo bar.baz/);
+
+sub write_file {
+    my ($fn, $data) = @_;
+    open(my $fh, '>', $fn) or die "Cannot open $fn for writing: $!";
+    print $fh $data;
+    close($fh) or die "Cannot close $fn: $!";
+}
+
+sub run_queries {
+    my @qnames;
+    foreach my $zone (@zones) {
+        push(@qnames, map { $_ ? "$_.$zone." : "$zone." } @owners);
+    }
+    return _GDT->query_responses(\@qnames, [qw/A AAAA SOA NS MX TXT SRV PTR CNAME ANY/]);
+}
+
+sub setup_templated {
+    my $tdir = "$_GDT::OUTDIR/etc/templates";
+    mkdir $tdir or die "Cannot create directory $tdir: $!";
+    write_file("$tdir/parked.tmpl", $tmpl);
+    write_file("$tdir/parked.zones", "# parked domains\n" . join("\n", @zones, $zones[0]) . "\n");
+}
+
+sub setup_zonefiles {
+    foreach my $zone (@zones) {
+        (my $data = $tmpl) =~ s/template\.invalid\./$zone./g;
+        write_file("$_GDT::OUTDIR/etc/zones/$zone", $data);
+    }
+}
+
+my $zonefiles = _GDT->run_daemon_queries(
+    setup => \&setup_zonefiles,
+    queries => \&run_queries,
+);
+my $templated = _GDT->run_daemon_queries(
+    setup => \&setup_templated,
+    queries => \&run_queries,
+);
+
+is_deeply($templated, $zonefiles, 'template zone responses match per-zone zonefiles over ' . scalar(keys %$zonefiles) . ' queries');
@@ -0,0 +1,36 @@
+
+# Differential test of the compiled zone snapshot: the zones are served
+#  once after parsing the zonefiles, then "gdnsd compile-zones" is run
+#  and the daemon restarted, so that every zonefile is replayed from the
+#  snapshot instead.  The responses for every owner name in the
+#  zonefiles (and some non-existent ones) must be identical.
+
+use _GDT ();
+use FindBin ();
+use Test::More tests => 8;
+
+my @qnames = _GDT->zonefile_owners("$FindBin::Bin/etc/zones", 1);
+
+sub run_queries {
+    return _GDT->query_responses(\@qnames, [qw/A AAAA SOA NS MX TXT SRV NAPTR PTR CNAME ANY/]);
+}
+
+_GDT->test_spawn_daemon_setup();
+my $pid = _GDT->test_spawn_daemon_execute();
+my $parsed = run_queries();
+_GDT->test_kill_daemon($pid);
+
+my $compile_cmd = "$_GDT::GDNSD_BIN -c $_GDT::OUTDIR/etc compile-zones >$_GDT::OUTDIR/compile.out 2>&1";
+$compile_cmd = "$_GDT::TEST_RUNNER $compile_cmd" if $_GDT::TEST_RUNNER;
+ok(!system($compile_cmd), 'compile-zones succeeded');
+
+$pid = _GDT->test_spawn_daemon_execute();
+my $replayed = run_queries();
+_GDT->test_kill_daemon($pid);
+
+my $daemon_out = "$_GDT::OUTDIR/gdnsd.out";
+open(my $out_fh, '<', $daemon_out) or die "Cannot open $daemon_out for reading: $!";
+ok(scalar(grep { /rfc1035: 3 zonefiles were loaded from the zone snapshot/ } <$out_fh>), 'all zonefiles were loaded from the snapshot');
+close($out_fh);
+
+is_deeply($replayed, $parsed, 'snapshot zone responses match parsed zonefiles over ' . scalar(keys %$parsed) . ' queries');
@@ -0,0 +1,30 @@
+
+# Zone load profiling: the profile of the initial load is logged,
+#  and is reported in the JSON stats output.
+
+use _GDT ();
+use FindBin ();
+use LWP::UserAgent ();
+use Test::More tests => 4;
+
+my $pid = _GDT->test_spawn_daemon();
+
+_GDT->test_log_output([
+    'Zone load profile: 3 zone loads took',
+    'Zone load profile: wall time histogram:',
+    'Zone load profile: slowest #1: zone ',
+]);
+
+my $ua = LWP::UserAgent->new(
+    protocols_allowed => ['http'],
+    requests_redirectable => [],
+    timeout => 3,
+);
+my $response = $ua->get("http://127.0.0.1:${_GDT::HTTP_PORT}/json");
+my $content = $response ? $response->content : '';
+ok($content =~ /"zone_loads": \{\s*"count": 3,/s
+    && $content =~ /"slowest": \[\s*\{ "zone": "[^"]+", "source": "rfc1035:/s,
+    'JSON stats report the zone load profile')
+    or diag("JSON stats output was: $content");
+
+_GDT->test_kill_daemon($pid);
@@ -0,0 +1,60 @@
+
+# Several zonefiles changed together are applied to runtime as a
+#   single batched multi-zone transaction.
+
+use _GDT ();
+use FindBin ();
+use File::Spec ();
+use Test::More tests => 9;
+
+# slow-start on slow-fs for change detection accuracy
+delete $ENV{GDNSD_TESTSUITE_NO_ZONEFILE_MODS};
+
+my $pid = _GDT->test_spawn_daemon();
+
+# example.com exists from the start
+_GDT->test_dns(
+    qname => 'ns1.example.com', qtype => 'A',
+    answer => 'ns1.example.com 86400 A 192.0.2.1',
+);
+
+# create example.org and update example.com at the same time
+_GDT->insert_altzone('example.org', 'example.org');
+_GDT->insert_altzone('example.com-2', 'example.com');
+_GDT->send_sighup_unless_inotify();
+_GDT->test_log_output([
+    'Multi-zone update transaction starting',
+    'Zone example.org.: source rfc1035:example.org with serial 1 loaded as authoritative',
+    'Zone example.com.: source rfc1035:example.com updated to serial 2 from serial 1, continues to be authoritative',
+    'Multi-zone update transaction committed',
+]);
+_GDT->test_dns(
+    qname => 'ns1.example.org', qtype => 'A',
+    answer => 'ns1.example.org 86400 A 192.0.2.3',
+);
+_GDT->test_dns(
+    qname => 'ns1.example.com', qtype => 'A',
+    answer => 'ns1.example.com 86400 A 192.0.2.12',
+);
+
+# delete example.org and update example.com again, together
+_GDT->delete_altzone('example.org');
+_GDT->insert_altzone('example.com-3', 'example.com');
+_GDT->send_sighup_unless_inotify();
+_GDT->test_log_output([
+    'Multi-zone update transaction starting',
+    'Zone example.org.: authoritative source rfc1035:example.org with serial 1 removed (zone no longer exists)',
+    'Zone example.com.: source rfc1035:example.com updated to serial 3 from serial 2, continues to be authoritative',
+    'Multi-zone update transaction committed',
+]);
+_GDT->test_dns(
+    qname => 'example.org', qtype => 'A',
+    header => { rcode => 'REFUSED', aa => 0 },
+    stats => [qw/udp_reqs refused/],
+);
+_GDT->test_dns(
+    qname => 'ns1.example.com', qtype => 'A',
+    answer => 'ns1.example.com 86400 A 192.0.2.13',
+);
+
+_GDT->test_kill_daemon($pid);
@@ -0,0 +1,89 @@
+
+# Changes in a zone journal (".example.com.journal") are applied on
+#   top of the zonefile's records.  The journal must add an SOA with a
+#   serial newer than the zonefile's, and once the zonefile has been
+#   updated past it, the stale journal is ignored.
+
+use _GDT ();
+use FindBin ();
+use File::Spec ();
+use Test::More tests => 10;
+
+# slow-start on slow-fs for change detection accuracy
+delete $ENV{GDNSD_TESTSUITE_NO_ZONEFILE_MODS};
+
+my $zonefile = "$_GDT::OUTDIR/etc/zones/example.com";
+my $journal = "$_GDT::OUTDIR/etc/zones/.example.com.journal";
+
+sub write_file {
+    my ($fn, $data) = @_;
+    open(my $fh, '>', "$fn.tmp") or die "Cannot open $fn.tmp for writing: $!";
+    print $fh $data;
+    close($fh) or die "Cannot close $fn.tmp: $!";
+    rename("$fn.tmp", $fn) or die "Cannot rename $fn.tmp: $!";
+}
+
+my $pid = _GDT->test_spawn_daemon();
+
+_GDT->test_dns(
+    qname => 'ns2.example.com', qtype => 'A',
+    answer => 'ns2.example.com 86400 A 192.0.2.2',
+);
+
+write_file($journal, <<'EOT');
+$DELETE
+ns2 300 A 192.0.2.2
+$ADD
+@ SOA ns1 hostmaster 2 7200 1800 259200 900
+ns2 A 192.0.2.22
+new A 192.0.2.99
+EOT
+_GDT->send_sighup_unless_inotify();
+_GDT->test_log_output(
+    'Zone example.com.: source rfc1035:example.com updated to serial 2 from serial 1, continues to be authoritative',
+);
+_GDT->test_dns(
+    qname => 'ns2.example.com', qtype => 'A',
+    answer => 'ns2.example.com 86400 A 192.0.2.22',
+);
+_GDT->test_dns(
+    qname => 'new.example.com', qtype => 'A',
+    answer => 'new.example.com 86400 A 192.0.2.99',
+);
+
+# merge the journal into the zonefile with a newer serial, leaving
+#   the journal in place
+write_file($zonefile, <<'EOT');
+@ SOA ns1 hostmaster 3 7200 1800 259200 900
+@ NS ns1
+@ NS ns2
+ns1 A 192.0.2.1
+ns2 A 192.0.2.22
+new A 192.0.2.99
+merged A 192.0.2.100
+EOT
+_GDT->send_sighup_unless_inotify();
+_GDT->test_log_output([
+    'rfc1035: Zone example.com.: ignoring zone journal with SOA serial 2, which is not newer than the zonefile\'s serial 3',
+    'Zone example.com.: source rfc1035:example.com updated to serial 3 from serial 2, continues to be authoritative',
+]);
+_GDT->test_dns(
+    qname => 'merged.example.com', qtype => 'A',
+    answer => 'merged.example.com 86400 A 192.0.2.100',
+);
+
+# a journal which doesn't add an SOA is rejected, and the zone stays as-is
+write_file($journal, <<'EOT');
+$ADD
+bad A 192.0.2.66
+EOT
+_GDT->send_sighup_unless_inotify();
+_GDT->test_log_output(
+    'rfc1035: Zone example.com.: zone journal does not add an SOA record',
+);
+_GDT->test_dns(
+    qname => 'ns2.example.com', qtype => 'A',
+    answer => 'ns2.example.com 86400 A 192.0.2.22',
+);
+
+_GDT->test_kill_daemon($pid);
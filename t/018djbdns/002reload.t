@@ -0,0 +1,70 @@
+
+# On SIGHUP, only djbdns zones whose records changed are rebuilt
+#   and swapped into runtime, while unchanged zones are kept as-is.
+
+use _GDT ();
+use FindBin ();
+use File::Spec ();
+use Test::More tests => 11;
+
+my $netfile = "$_GDT::OUTDIR/etc/djbdns/net";
+
+sub write_net {
+    my $data = shift;
+    open(my $fh, '>', "$netfile.tmp") or die "Cannot open $netfile.tmp for writing: $!";
+    print $fh $data;
+    close($fh) or die "Cannot close $netfile.tmp: $!";
+    rename("$netfile.tmp", $netfile) or die "Cannot rename $netfile.tmp: $!";
+}
+
+my $net_head = <<'EOT';
+Zexample.net:a.ns.example.net:hostmaster.example.net:1::::::86400
+&example.net:192.0.2.3:a.ns.example.net.:86400
+EOT
+
+_GDT->test_spawn_daemon_setup();
+write_net($net_head . "+www.example.net:192.0.2.50:86400\n");
+my $pid = _GDT->test_spawn_daemon_execute();
+
+_GDT->test_log_output('(2 new or changed, 0 removed)');
+_GDT->test_dns(
+    qname => 'www.example.net', qtype => 'A',
+    answer => 'www.example.net 86400 A 192.0.2.50',
+);
+
+# change only example.net
+write_net($net_head . "+www.example.net:192.0.2.51:86400\n");
+kill(1, $pid) or die "Cannot send SIGHUP to gdnsd at pid $pid";
+_GDT->test_log_output('(1 new or changed, 0 removed)');
+_GDT->test_dns(
+    qname => 'www.example.net', qtype => 'A',
+    answer => 'www.example.net 86400 A 192.0.2.51',
+);
+_GDT->test_dns(
+    qname => 'foo.example.com', qtype => 'A',
+    answer => 'foo.example.com 86400 A 192.0.2.100',
+    auth => [
+        'example.com 86400 NS a.ns.example.com',
+        'example.com 86400 NS b.ns.example.com',
+    ],
+    addtl => [
+        'a.ns.example.com 86400 A 192.0.2.1',
+        'b.ns.example.com 86400 A 192.0.2.2',
+    ],
+);
+
+# no changes at all
+kill(1, $pid) or die "Cannot send SIGHUP to gdnsd at pid $pid";
+_GDT->test_log_output('(0 new or changed, 0 removed)');
+
+# remove example.net
+unlink($netfile) or die "Cannot unlink $netfile: $!";
+kill(1, $pid) or die "Cannot send SIGHUP to gdnsd at pid $pid";
+_GDT->test_log_output('(0 new or changed, 1 removed)');
+_GDT->test_dns(
+    qname => 'www.example.net', qtype => 'A',
+    header => { rcode => 'REFUSED', aa => 0 },
+    stats => [qw/udp_reqs refused/],
+);
+
+_GDT->test_kill_daemon($pid);
@@ -0,0 +1,31 @@
+
+# Zone load profiling of djbdns zones: every zone found in one
+#   djbdns file shares a source name, and each must still get its
+#   own entry in the slowest-zones list.
+
+use _GDT ();
+use FindBin ();
+use File::Spec ();
+use Test::More tests => 4;
+
+my $netfile = "$_GDT::OUTDIR/etc/djbdns/net";
+
+_GDT->test_spawn_daemon_setup();
+open(my $fh, '>', $netfile) or die "Cannot open $netfile for writing: $!";
+print $fh <<'EOT';
+Zexample.net:a.ns.example.net:hostmaster.example.net:1::::::86400
+&example.net:192.0.2.3:a.ns.example.net.:86400
+Zexample.org:a.ns.example.org:hostmaster.example.org:1::::::86400
+&example.org:192.0.2.4:a.ns.example.org.:86400
+EOT
+close($fh) or die "Cannot close $netfile: $!";
+my $pid = _GDT->test_spawn_daemon_execute();
+
+_GDT->test_log_output([
+    'Zone load profile: 3 zone loads took',
+    'zone example.com. source djb:',
+    'zone example.net. source djb:',
+    'zone example.org. source djb:',
+]);
+
+_GDT->test_kill_daemon($pid);
@@ -639,6 +639,92 @@ sub get_resolver6 {
     );
 }
 
+##### START DIFFERENTIAL TEST STUFF
+# For tests which compare the responses of daemon runs that must
+#  answer identically, e.g. with some optimization on and then off.
+
+# Returns the owner names (as FQDNs) found in the zonefiles in $zdir.
+#  Names with address limits are skipped, as the subset returned is
+#  random.  With $with_nx, two non-existent names per zone are added.
+sub zonefile_owners {
+    my ($class, $zdir, $with_nx) = @_;
+
+    my @qnames;
+    opendir(my $dh, $zdir) or die "Cannot opendir $zdir: $!";
+    foreach my $zone (sort grep { !/^\./ } readdir($dh)) {
+        my %seen;
+        open(my $fh, '<', "$zdir/$zone") or die "Cannot open $zdir/$zone: $!";
+        while(<$fh>) {
+            next unless /^([-A-Za-z0-9_.*@]+)\s/;
+            my $name = $1;
+            next if $name =~ /limit/i;
+            if($name eq '@') { $name = "$zone." }
+            elsif($name !~ /\.$/) { $name = "$name.$zone." }
+            next unless $name =~ /\Q$zone\E\.$/i;
+            push(@qnames, $name) unless $seen{lc $name}++;
+        }
+        close($fh);
+        push(@qnames, "nonexistent.$zone.", "foo.nonexistent.$zone.")
+            if $with_nx;
+    }
+    closedir($dh);
+
+    return @qnames;
+}
+
+# Returns a response packet as a string of its rcode, header flags and
+#  section counts, and the sorted RRs of each section.
+sub normalize_response {
+    my ($class, $rpkt) = @_;
+    return 'NO RESPONSE' unless $rpkt;
+    my $hdr = $rpkt->header;
+    my $rv = join(',',
+        $hdr->rcode, $hdr->aa, $hdr->tc,
+        $hdr->ancount, $hdr->nscount, $hdr->arcount
+    );
+    foreach my $section (qw/answer authority additional/) {
+        $rv .= "\n$section:\n" . join("\n", sort map { $_->string } $rpkt->$section);
+    }
+    return $rv;
+}
+
+# Queries every name in @$qnames for every type in @$qtypes, and returns
+#  a hashref of "qname/qtype" => normalize_response()
+sub query_responses {
+    my ($class, $qnames, $qtypes) = @_;
+    my %results;
+    my $res = get_resolver();
+    foreach my $qname (@$qnames) {
+        foreach my $qtype (@$qtypes) {
+            my $rpkt = $res->send(Net::DNS::Packet->new($qname, $qtype));
+            $results{"$qname/$qtype"} = $class->normalize_response($rpkt);
+        }
+    }
+    return \%results;
+}
+
+# Runs the daemon once and returns the result of $args{queries}->()
+#  against it.  $args{setup}, if any, is called after the standard
+#  setup, and $args{cfg}, if any, is appended to the static config.
+#  This counts as 3 tests.
+sub run_daemon_queries {
+    my ($class, %args) = @_;
+
+    $class->test_spawn_daemon_setup();
+    $args{setup}->() if $args{setup};
+    if($args{cfg}) {
+        my $cfg = "$OUTDIR/etc/cfg-static";
+        open(my $fh, '>>', $cfg) or die "Cannot append to $cfg: $!";
+        print $fh $args{cfg};
+        close($fh) or die "Cannot close $cfg: $!";
+    }
+    my $pid = $class->test_spawn_daemon_execute();
+    my $results = $args{queries}->();
+    $class->test_kill_daemon($pid);
+
+    return $results;
+}
+
 # Creates a new Net::DNS::Packet which is a query response,
 #  to compare with the real server response for correctness.
 #  Args are: { headerparam => value }, $question, [ answers ], [ auths ], [ addtl ]